@@ -32,12 +32,21 @@ VERSION: 0.6.66
 #define CHESS_HPP
 
 
-#include <functional>
 #include <utility>
 
 
 #include <cstdint>
 
+// Slider attacks are indexed with BMI2 PEXT instead of the magic multiplication when the target
+// has it, e.g. -march=native on Haswell, Zen 3 or newer. Both index the same tables. Define
+// CHESS_NO_PEXT to keep the magics, PEXT is microcoded and slow on Zen 1 and Zen 2.
+#if defined(__BMI2__) && !defined(CHESS_NO_PEXT)
+#    include <immintrin.h>
+#    define CHESS_USE_PEXT 1
+#else
+#    define CHESS_USE_PEXT 0
+#endif
+
 
 #if __cplusplus >= 202002L
 #    include <bit>
@@ -640,28 +649,35 @@ class attacks {
         Bitboard *attacks;
         U64 shift;
 
-        U64 operator()(Bitboard b) const { return (((b & mask)).getBits() * magic) >> shift; }
+        U64 operator()(Bitboard b) const {
+#if CHESS_USE_PEXT
+            return _pext_u64(b.getBits(), mask);
+#else
+            return (((b & mask)).getBits() * magic) >> shift;
+#endif
+        }
     };
 
-    /// @brief Slow function to calculate bishop attacks
+    /// @brief Returns the squares from sq (exclusive) to the edge of the board in a given direction
+    /// @tparam direction
     /// @param sq
-    /// @param occupied
     /// @return
-    [[nodiscard]] static Bitboard bishopAttacks(Square sq, Bitboard occupied);
+    template <Direction direction>
+    [[nodiscard]] static constexpr Bitboard ray(Square sq) noexcept;
 
-    /// @brief Slow function to calculate rook attacks
-    /// @param sq
+    /// @brief Returns the attacks along four rays, each up to and including its first blocker.
+    /// The first two rays have to point towards h8, the last two towards a1.
+    /// @param rays
     /// @param occupied
     /// @return
-    [[nodiscard]] static Bitboard rookAttacks(Square sq, Bitboard occupied);
+    [[nodiscard]] static Bitboard rayAttacks(const Bitboard (&rays)[4], Bitboard occupied) noexcept;
 
     /// @brief Initializes the magic bitboard tables for sliding pieces
     /// @param sq
     /// @param table
     /// @param magic
-    /// @param attacks
-    static void initSliders(Square sq, Magic table[], U64 magic,
-                            const std::function<Bitboard(Square, Bitboard)> &attacks);
+    /// @param rays
+    static void initSliders(Square sq, Magic table[], U64 magic, const Bitboard (&rays)[4]);
 
     // clang-format off
     // pre-calculated lookup table for pawn attacks
@@ -855,6 +871,9 @@ class attacks {
     /// @brief [Internal Usage] Initializes the attacks for the bishop and rook. Called once at
     /// startup.
     static inline void initAttacks();
+
+   private:
+    static const bool SlidersInitialized;
 };
 }  // namespace chess
 
@@ -1196,9 +1215,9 @@ inline std::ostream &operator<<(std::ostream &os, const Move &move) {
 }
 }  // namespace chess
 
+#include <cstddef>
 
 
-#include <cstddef>
 #include <iterator>
 #include <stdexcept>
 
@@ -1318,21 +1337,62 @@ enum PieceGenType {
 
 class Board;
 
+template <typename Derived, std::size_t MaxPly>
+class BasicPosition;
+
 class movegen {
    public:
     enum class MoveGenType : std::uint8_t { ALL, CAPTURE, QUIET };
 
     /// @brief Generates all legal moves for a position.
     /// @tparam mt
+    /// @tparam BoardType Board or BasicPosition
     /// @param movelist
     /// @param board
-    template <MoveGenType mt = MoveGenType::ALL>
-    void static legalmoves(Movelist &movelist, const Board &board,
+    template <MoveGenType mt = MoveGenType::ALL, typename BoardType>
+    void static legalmoves(Movelist &movelist, const BoardType &board,
                            int pieces = PieceGenType::PAWN | PieceGenType::KNIGHT | PieceGenType::BISHOP |
                                         PieceGenType::ROOK | PieceGenType::QUEEN | PieceGenType::KING);
 
+    /// @brief Generates all pseudo-legal moves for a position, moves that may leave the own king in
+    /// check. They are meant to be checked with board.isLegal(move) right before they are played.
+    /// @tparam mt
+    /// @tparam BoardType Board or BasicPosition
+    /// @param movelist
+    /// @param board
+    template <MoveGenType mt = MoveGenType::ALL, typename BoardType>
+    void static pseudolegalmoves(Movelist &movelist, const BoardType &board,
+                                 int pieces = PieceGenType::PAWN | PieceGenType::KNIGHT | PieceGenType::BISHOP |
+                                              PieceGenType::ROOK | PieceGenType::QUEEN | PieceGenType::KING);
+
+    /// @brief Checks if the side to move has a legal move, stops at the first one it finds.
+    /// Cheaper than generating all legal moves to see if the movelist is empty.
+    /// @tparam BoardType Board or BasicPosition
+    /// @param board
+    /// @return
+    template <typename BoardType>
+    [[nodiscard]] static bool hasLegalMove(const BoardType &board);
+
+    /// @brief Counts the legal moves of the side to move, from the popcounts of their destination
+    /// squares instead of writing them to a movelist.
+    /// @tparam BoardType Board or BasicPosition
+    /// @param board
+    /// @return
+    template <typename BoardType>
+    [[nodiscard]] static int countLegalMoves(const BoardType &board);
+
+    /// @brief Returns the pieces of a color attacking a square, sliders see through the given occupancy,
+    /// e.g. the one after a move to see if it leaves the king in check.
+    /// @param board
+    /// @param color Attacker Color
+    /// @param sq
+    /// @param occupied
+    /// @return
+    template <typename BoardType>
+    [[nodiscard]] static Bitboard attackers(const BoardType &board, Color color, Square sq, Bitboard occupied);
+
    private:
-    static auto init_squares_between();
+    static constexpr std::array<std::array<Bitboard, 64>, 64> init_squares_between();
     static const std::array<std::array<Bitboard, 64>, 64> SQUARES_BETWEEN_BB;
 
     /// @brief Generate the checkmask.
@@ -1342,8 +1402,8 @@ class movegen {
     /// @param sq
     /// @param double_check
     /// @return
-    template <Color::underlying c>
-    [[nodiscard]] static Bitboard checkMask(const Board &board, Square sq, int &double_check);
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static Bitboard checkMask(const BoardType &board, Square sq, int &double_check);
 
     /// @brief Generate the pin mask for horizontal and vertical pins.
     /// Returns a bitboard where the ray between the king and the pinner is set.
@@ -1353,8 +1413,8 @@ class movegen {
     /// @param occ_enemy
     /// @param occ_us
     /// @return
-    template <Color::underlying c>
-    [[nodiscard]] static Bitboard pinMaskRooks(const Board &board, Square sq, Bitboard occ_enemy, Bitboard occ_us);
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static Bitboard pinMaskRooks(const BoardType &board, Square sq, Bitboard occ_enemy, Bitboard occ_us);
 
     /// @brief Generate the pin mask for diagonal pins.
     /// Returns a bitboard where the ray between the king and the pinner is set.
@@ -1364,16 +1424,38 @@ class movegen {
     /// @param occ_enemy
     /// @param occ_us
     /// @return
-    template <Color::underlying c>
-    [[nodiscard]] static Bitboard pinMaskBishops(const Board &board, Square sq, Bitboard occ_enemy, Bitboard occ_us);
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static Bitboard pinMaskBishops(const BoardType &board, Square sq, Bitboard occ_enemy, Bitboard occ_us);
 
-    /// @brief Returns the squares that are attacked by the enemy
+    /// @brief Returns the squares that are attacked by color c
     /// @tparam c
     /// @param board
-    /// @param enemy_empty
+    /// @param occupied Occupancy the sliders see
     /// @return
-    template <Color::underlying c>
-    [[nodiscard]] static Bitboard seenSquares(const Board &board, Bitboard enemy_empty);
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static Bitboard seenSquares(const BoardType &board, Bitboard occupied);
+
+    /// @brief Destination squares of the pawn moves, promotions included, and the pawns that
+    /// may capture en passant.
+    struct PawnTargets {
+        Bitboard left;
+        Bitboard right;
+        Bitboard single_push;
+        Bitboard double_push;
+        Bitboard pawns_lr;
+    };
+
+    /// @brief Generate the destination squares of the pawn moves.
+    /// @tparam c
+    /// @param board
+    /// @param pin_d
+    /// @param pin_hv
+    /// @param checkmask
+    /// @param occ_enemy
+    /// @return
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static PawnTargets pawnTargets(const BoardType &board, Bitboard pin_d, Bitboard pin_hv,
+                                                 Bitboard checkmask, Bitboard occ_enemy);
 
     /// @brief Generate pawn moves.
     /// @tparam c
@@ -1384,11 +1466,12 @@ class movegen {
     /// @param pin_hv
     /// @param checkmask
     /// @param occ_enemy
-    template <Color::underlying c, MoveGenType mt>
-    static void generatePawnMoves(const Board &board, Movelist &moves, Bitboard pin_d, Bitboard pin_hv,
+    template <Color::underlying c, MoveGenType mt, typename BoardType>
+    static void generatePawnMoves(const BoardType &board, Movelist &moves, Bitboard pin_d, Bitboard pin_hv,
                                   Bitboard checkmask, Bitboard occ_enemy);
 
-    [[nodiscard]] static std::array<Move, 2> generateEPMove(const Board &board, Bitboard checkmask, Bitboard pin_d,
+    template <typename BoardType>
+    [[nodiscard]] static std::array<Move, 2> generateEPMove(const BoardType &board, Bitboard checkmask, Bitboard pin_d,
                                                             Bitboard pawns_lr, Square ep, Color c);
 
     /// @brief Generate knight moves.
@@ -1436,8 +1519,8 @@ class movegen {
     /// @param seen
     /// @param pinHV
     /// @return
-    template <Color::underlying c, MoveGenType mt>
-    [[nodiscard]] static Bitboard generateCastleMoves(const Board &board, Square sq, Bitboard seen, Bitboard pinHV);
+    template <Color::underlying c, MoveGenType mt, typename BoardType>
+    [[nodiscard]] static Bitboard generateCastleMoves(const BoardType &board, Square sq, Bitboard seen, Bitboard pinHV);
 
     template <typename T>
     static void whileBitboardAdd(Movelist &movelist, Bitboard mask, T func);
@@ -1447,10 +1530,49 @@ class movegen {
     /// @tparam mt
     /// @param movelist
     /// @param board
-    template <Color::underlying c, MoveGenType mt>
-    static void legalmoves(Movelist &movelist, const Board &board, int pieces);
+    template <Color::underlying c, MoveGenType mt, typename BoardType>
+    static void legalmoves(Movelist &movelist, const BoardType &board, int pieces);
+
+    /// @brief Counts the legal moves for a position
+    /// @tparam c
+    /// @tparam stop_at_first Returns as soon as a legal move was found
+    /// @param board
+    /// @return
+    template <Color::underlying c, bool stop_at_first = false, typename BoardType>
+    [[nodiscard]] static int countLegalMoves(const BoardType &board);
+
+    /// @brief Checks if there is a legal move for a position
+    /// @tparam c
+    /// @param board
+    /// @return
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static bool hasLegalMove(const BoardType &board);
+
+    /// @brief all pseudo-legal moves for a position
+    /// @tparam c
+    /// @tparam mt
+    /// @param movelist
+    /// @param board
+    template <Color::underlying c, MoveGenType mt, typename BoardType>
+    static void pseudolegalmoves(Movelist &movelist, const BoardType &board, int pieces);
+
+    /// @brief Computes the checkers and the pin masks of the side to move (see Board::AttackInfo).
+    /// @param board
+    /// @param info
+    template <typename BoardType, typename AttackInfo>
+    static void checkInfo(const BoardType &board, AttackInfo &info);
+
+    /// @brief Checks if a pseudo-legal move of the side to move is legal.
+    /// @param board
+    /// @param move
+    /// @return
+    template <typename BoardType>
+    [[nodiscard]] static bool isLegal(const BoardType &board, Move move);
 
     friend class Board;
+
+    template <typename Derived, std::size_t MaxPly>
+    friend class BasicPosition;
 };
 
 }  // namespace chess
@@ -1666,6 +1788,9 @@ class Zobrist {
 
    public:
     friend class Board;
+
+    template <typename Derived, std::size_t MaxPly>
+    friend class BasicPosition;
 };
 
 }  // namespace chess
@@ -1746,21 +1871,43 @@ class Board {
         std::array<std::array<File, 2>, 2> rooks;
     };
 
+    /// @brief Checkers, pins and attacked squares of a position. Each part is computed on first use
+    /// and saved with the position's state, so unmakeMove() restores it instead of recomputing it.
+    struct AttackInfo {
+        enum Valid : std::uint8_t { CHECKS = 1, ATTACKED_WHITE = 2, ATTACKED_BLACK = 4 };
+
+        // pieces giving check to the side to move
+        Bitboard checkers;
+        // rays between the king of the side to move and the enemy sliders pinning a piece to it
+        Bitboard pin_hv;
+        Bitboard pin_d;
+        // squares attacked by each color
+        std::array<Bitboard, 2> attacked;
+
+        std::uint8_t valid = 0;
+    };
+
    private:
     struct State {
         U64 hash;
+        U64 pawn_key;
+        U64 material_key;
         CastlingRights castling;
         Square enpassant;
         uint8_t half_moves;
         Piece captured_piece;
+        AttackInfo info;
 
-        State(const U64 &hash, const CastlingRights &castling, const Square &enpassant, const uint8_t &half_moves,
-              const Piece &captured_piece)
+        State(const U64 &hash, const U64 &pawn_key, const U64 &material_key, const CastlingRights &castling,
+              const Square &enpassant, const uint8_t &half_moves, const Piece &captured_piece, const AttackInfo &info)
             : hash(hash),
+              pawn_key(pawn_key),
+              material_key(material_key),
               castling(castling),
               enpassant(enpassant),
               half_moves(half_moves),
-              captured_piece(captured_piece) {}
+              captured_piece(captured_piece),
+              info(info) {}
     };
 
     enum class PrivateCtor { CREATE };
@@ -1919,7 +2066,8 @@ class Board {
         // Validate side to move
         assert((at(move.from()) < Piece::BLACKPAWN) == (stm_ == Color::WHITE));
 
-        prev_states_.emplace_back(key_, cr_, ep_sq_, hfm_, captured);
+        prev_states_.emplace_back(key_, pawn_key_, material_key_, cr_, ep_sq_, hfm_, captured, info_);
+        info_.valid = 0;
 
         hfm_++;
         plies_++;
@@ -1932,6 +2080,9 @@ class Board {
 
             hfm_ = 0;
             key_ ^= Zobrist::piece(captured, move.to());
+            material_key_ ^= Zobrist::piece(captured, Square(pieces(captured.type(), ~stm_).count()));
+
+            if (captured.type() == PieceType::PAWN) pawn_key_ ^= Zobrist::piece(captured, move.to());
 
             // remove castling rights if rook is captured
             if (captured.type() == PieceType::ROOK && Rank::back_rank(move.to().rank(), ~stm_)) {
@@ -2056,6 +2207,9 @@ class Board {
             placePiece(piece_prom, move.to());
 
             key_ ^= Zobrist::piece(piece_pawn, move.from()) ^ Zobrist::piece(piece_prom, move.to());
+            pawn_key_ ^= Zobrist::piece(piece_pawn, move.from());
+            material_key_ ^= Zobrist::piece(piece_pawn, Square(pieces(PieceType::PAWN, stm_).count())) ^
+                             Zobrist::piece(piece_prom, Square(pieces(piece_prom.type(), stm_).count() - 1));
         } else {
             assert(at(move.from()) != Piece::NONE);
             assert(at(move.to()) == Piece::NONE);
@@ -2066,6 +2220,10 @@ class Board {
             placePiece(piece, move.to());
 
             key_ ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, move.to());
+
+            if (pt == PieceType::PAWN) {
+                pawn_key_ ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, move.to());
+            }
         }
 
         if (move.typeOf() == Move::ENPASSANT) {
@@ -2076,6 +2234,8 @@ class Board {
             removePiece(piece, move.to().ep_square());
 
             key_ ^= Zobrist::piece(piece, move.to().ep_square());
+            pawn_key_ ^= Zobrist::piece(piece, move.to().ep_square());
+            material_key_ ^= Zobrist::piece(piece, Square(pieces(PieceType::PAWN, ~stm_).count()));
         }
 
         key_ ^= Zobrist::sideToMove();
@@ -2083,15 +2243,22 @@ class Board {
     }
 
     void unmakeMove(const Move move) {
-        const auto prev = prev_states_.back();
-        prev_states_.pop_back();
+        const auto &prev = prev_states_.back();
 
+        info_  = prev.info;
         ep_sq_ = prev.enpassant;
         cr_    = prev.castling;
         hfm_   = prev.half_moves;
         stm_   = ~stm_;
         plies_--;
 
+        pawn_key_     = prev.pawn_key;
+        material_key_ = prev.material_key;
+
+        const auto hash     = prev.hash;
+        const auto captured = prev.captured_piece;
+        prev_states_.pop_back();
+
         if (move.typeOf() == Move::CASTLING) {
             const bool king_side = move.to() > move.from();
 
@@ -2113,7 +2280,7 @@ class Board {
             placePiece(king, move.from());
             placePiece(rook, move.to());
 
-            key_ = prev.hash;
+            key_ = hash;
 
             return;
         } else if (move.typeOf() == Move::PROMOTION) {
@@ -2127,12 +2294,12 @@ class Board {
             removePiece(piece, move.to());
             placePiece(pawn, move.from());
 
-            if (prev.captured_piece != Piece::NONE) {
+            if (captured != Piece::NONE) {
                 assert(at(move.to()) == Piece::NONE);
-                placePiece(prev.captured_piece, move.to());
+                placePiece(captured, move.to());
             }
 
-            key_ = prev.hash;
+            key_ = hash;
             return;
         } else {
             assert(at(move.to()) != Piece::NONE);
@@ -2150,17 +2317,18 @@ class Board {
 
             assert(at(pawnTo) == Piece::NONE);
             placePiece(pawn, pawnTo);
-        } else if (prev.captured_piece != Piece::NONE) {
+        } else if (captured != Piece::NONE) {
             assert(at(move.to()) == Piece::NONE);
-            placePiece(prev.captured_piece, move.to());
+            placePiece(captured, move.to());
         }
 
-        key_ = prev.hash;
+        key_ = hash;
     }
 
     /// @brief Make a null move. (Switches the side to move)
     void makeNullMove() {
-        prev_states_.emplace_back(key_, cr_, ep_sq_, hfm_, Piece::NONE);
+        prev_states_.emplace_back(key_, pawn_key_, material_key_, cr_, ep_sq_, hfm_, Piece::NONE, info_);
+        info_.valid = 0;
 
         key_ ^= Zobrist::sideToMove();
         if (ep_sq_ != Square::underlying::NO_SQ) key_ ^= Zobrist::enpassant(ep_sq_.file());
@@ -2175,6 +2343,7 @@ class Board {
     void unmakeNullMove() {
         const auto &prev = prev_states_.back();
 
+        info_  = prev.info;
         ep_sq_ = prev.enpassant;
         cr_    = prev.castling;
         hfm_   = prev.half_moves;
@@ -2251,6 +2420,15 @@ class Board {
     /// @brief Get the current hash key of the board
     /// @return
     [[nodiscard]] U64 hash() const { return key_; }
+
+    /// @brief Get the zobrist key of the pawns only, for pawn structure tables
+    /// @return
+    [[nodiscard]] U64 pawnKey() const { return pawn_key_; }
+
+    /// @brief Get a key of the number of pieces of each kind, wherever they stand, for material
+    /// and endgame tables
+    /// @return
+    [[nodiscard]] U64 materialKey() const { return material_key_; }
     [[nodiscard]] Color sideToMove() const { return stm_; }
     [[nodiscard]] Square enpassantSq() const { return ep_sq_; }
     [[nodiscard]] CastlingRights castlingRights() const { return cr_; }
@@ -2326,10 +2504,7 @@ class Board {
     /// @brief Only call this function if isHalfMoveDraw() returns true.
     /// @return
     [[nodiscard]] std::pair<GameResultReason, GameResult> getHalfMoveDrawType() const {
-        Movelist movelist;
-        movegen::legalmoves(movelist, *this);
-
-        if (movelist.empty() && inCheck()) {
+        if (inCheck() && !movegen::hasLegalMove(*this)) {
             return {GameResultReason::CHECKMATE, GameResult::LOSE};
         }
 
@@ -2372,7 +2547,7 @@ class Board {
     }
 
     /// @brief Checks if the game is over. Returns GameResultReason::NONE if
-    /// the game is not over. This function calculates all legal moves for the
+    /// the game is not over. This function looks for a legal move in the
     /// current position to
     /// check if the game is over. If you are writing you should not use this
     /// function.
@@ -2386,10 +2561,7 @@ class Board {
 
         if (isRepetition()) return {GameResultReason::THREEFOLD_REPETITION, GameResult::DRAW};
 
-        Movelist movelist;
-        movegen::legalmoves(movelist, *this);
-
-        if (movelist.empty()) {
+        if (!movegen::hasLegalMove(*this)) {
             if (inCheck()) return {GameResultReason::CHECKMATE, GameResult::LOSE};
             return {GameResultReason::STALEMATE, GameResult::DRAW};
         }
@@ -2418,7 +2590,43 @@ class Board {
 
     /// @brief Checks if the current side to move is in check
     /// @return
-    [[nodiscard]] bool inCheck() const { return isAttacked(kingSq(stm_), ~stm_); }
+    [[nodiscard]] bool inCheck() const { return bool(checkers()); }
+
+    /// @brief Returns the pieces giving check to the side to move.
+    /// Computed on first use after the position changed.
+    /// @return
+    [[nodiscard]] Bitboard checkers() const { return attackInfo().checkers; }
+
+    /// @brief Returns the pieces of the side to move that are pinned to their king.
+    /// Computed on first use after the position changed.
+    /// @return
+    [[nodiscard]] Bitboard pinned() const {
+        const auto &info = attackInfo();
+        return (info.pin_hv | info.pin_d) & us(stm_);
+    }
+
+    /// @brief Returns the squares attacked by a color, including squares of its own pieces.
+    /// Computed on first use after the position changed.
+    /// @param color
+    /// @return
+    [[nodiscard]] Bitboard attackedBy(Color color) const {
+        const auto flag = color == Color::WHITE ? AttackInfo::ATTACKED_WHITE : AttackInfo::ATTACKED_BLACK;
+
+        if (!(info_.valid & flag)) {
+            info_.attacked[color] = color == Color::WHITE ? movegen::seenSquares<Color::WHITE>(*this, occ())
+                                                          : movegen::seenSquares<Color::BLACK>(*this, occ());
+            info_.valid |= flag;
+        }
+
+        return info_.attacked[color];
+    }
+
+    /// @brief Checks if a pseudo-legal move (see movegen::pseudolegalmoves) is legal.
+    /// Only moves of the king, of pinned pieces, en passant and moves while in check need more
+    /// than a look at the cached pins.
+    /// @param move
+    /// @return
+    [[nodiscard]] bool isLegal(const Move move) const { return movegen::isLegal(*this, move); }
 
     /// @brief Checks if the given color has at least 1 piece thats not pawn and not king
     /// @return
@@ -2698,6 +2906,7 @@ class Board {
             }
 
             board.key_ = board.zobrist();
+            board.initPieceKeys();
         }
 
         // 1:1 mapping of Piece::internal() to the compressed piece
@@ -2777,6 +2986,8 @@ class Board {
     std::array<Piece, 64> board_       = {};
 
     U64 key_           = 0ULL;
+    U64 pawn_key_      = 0ULL;
+    U64 material_key_  = 0ULL;
     CastlingRights cr_ = {};
     uint16_t plies_    = 0;
     Color stm_         = Color::WHITE;
@@ -2785,11 +2996,26 @@ class Board {
 
     bool chess960_ = false;
 
+    // see attackInfo() and attackedBy()
+    mutable AttackInfo info_ = {};
+
    private:
+    friend class movegen;
+
+    const AttackInfo &attackInfo() const {
+        if (!(info_.valid & AttackInfo::CHECKS)) {
+            movegen::checkInfo(*this, info_);
+            info_.valid |= AttackInfo::CHECKS;
+        }
+
+        return info_;
+    }
+
     /// @brief [Internal Usage]
     /// @param fen
     void setFenInternal(std::string_view fen) {
         original_fen_ = fen;
+        info_         = {};
 
         occ_bb_.fill(0ULL);
         pieces_bb_.fill(0ULL);
@@ -2909,6 +3135,28 @@ class Board {
         key_ ^= Zobrist::castling(cr_.hashIndex());
 
         assert(key_ == zobrist());
+
+        initPieceKeys();
+    }
+
+    /// @brief [Internal Usage] Regenerates the pawn and material keys from the pieces on the board.
+    void initPieceKeys() {
+        pawn_key_     = 0ULL;
+        material_key_ = 0ULL;
+
+        auto pawns = pieces(PieceType::PAWN);
+        while (pawns) {
+            const auto sq = pawns.pop();
+            pawn_key_ ^= Zobrist::piece(at(sq), sq);
+        }
+
+        // the n-th piece of a kind adds the key of square n
+        for (int p = 0; p < 12; p++) {
+            const auto piece = Piece(static_cast<Piece::underlying>(p));
+            const auto count = pieces(piece.type(), piece.color()).count();
+
+            for (int n = 0; n < count; n++) material_key_ ^= Zobrist::piece(piece, Square(n));
+        }
     }
 
     template <int N>
@@ -3076,79 +3324,39 @@ template <Color::underlying c>
     return atks & occupied;
 }
 
-/// @brief Slow function to calculate bishop attacks
+/// @brief Returns the squares from sq (exclusive) to the edge of the board in a given direction
+/// @tparam direction
 /// @param sq
-/// @param occupied
 /// @return
-[[nodiscard]] inline Bitboard attacks::bishopAttacks(Square sq, Bitboard occupied) {
-    Bitboard attacks = 0ULL;
-
-    int r, f;
-
-    int br = sq.rank();
-    int bf = sq.file();
-
-    for (r = br + 1, f = bf + 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r++, f++) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
-    }
-
-    for (r = br - 1, f = bf + 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r--, f++) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
-    }
-
-    for (r = br + 1, f = bf - 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r++, f--) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
-    }
+template <Direction direction>
+[[nodiscard]] inline constexpr Bitboard attacks::ray(Square sq) noexcept {
+    Bitboard ray;
 
-    for (r = br - 1, f = bf - 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r--, f--) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
+    for (auto b = shift<direction>(Bitboard::fromSquare(sq.index())); b != 0; b = shift<direction>(b)) {
+        ray |= b;
     }
 
-    return attacks;
+    return ray;
 }
 
-/// @brief Slow function to calculate rook attacks
-/// @param sq
+/// @brief Returns the attacks along four rays, each up to and including its first blocker.
+/// The first two rays have to point towards h8, the last two towards a1.
+/// @param rays
 /// @param occupied
 /// @return
-[[nodiscard]] inline Bitboard attacks::rookAttacks(Square sq, Bitboard occupied) {
-    Bitboard attacks = 0ULL;
-
-    int r, f;
+[[nodiscard]] inline Bitboard attacks::rayAttacks(const Bitboard (&rays)[4], Bitboard occupied) noexcept {
+    U64 attacks = 0ULL;
 
-    int rr = sq.rank();
-    int rf = sq.file();
-
-    for (r = rr + 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(rf)); r++) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(rf)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
-    }
-
-    for (r = rr - 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(rf)); r--) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(rf)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
-    }
-
-    for (f = rf + 1; Square::is_valid(static_cast<Rank>(rr), static_cast<File>(f)); f++) {
-        auto s = Square(static_cast<Rank>(rr), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
+    for (int i = 0; i < 2; i++) {
+        // the blocker closest to sq is the lowest one, without one (blockers - 1) keeps the whole ray
+        const U64 blockers = (rays[i] & occupied).getBits();
+        attacks |= rays[i].getBits() & (blockers ^ (blockers - 1));
     }
 
-    for (f = rf - 1; Square::is_valid(static_cast<Rank>(rr), static_cast<File>(f)); f--) {
-        auto s = Square(static_cast<Rank>(rr), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
+    for (int i = 2; i < 4; i++) {
+        // the blocker closest to sq is the highest one, a1 stands in for it when there is none
+        const U64 blockers = (rays[i] & occupied).getBits() | 1ULL;
+        attacks |= rays[i].getBits() & ~((1ULL << Bitboard(blockers).msb()) - 1);
     }
 
     return attacks;
@@ -3158,9 +3366,8 @@ template <Color::underlying c>
 /// @param sq
 /// @param table
 /// @param magic
-/// @param attacks
-inline void attacks::initSliders(Square sq, Magic table[], U64 magic,
-                                 const std::function<Bitboard(Square, Bitboard)> &attacks) {
+/// @param rays
+inline void attacks::initSliders(Square sq, Magic table[], U64 magic, const Bitboard (&rays)[4]) {
     // The edges of the board are not considered for the attacks
     // i.e. for the sq h7 edges will be a1-h1, a1-a8, a8-h8, ignoring the edge of the current square
     const Bitboard edges = ((Bitboard(Rank::RANK_1) | Bitboard(Rank::RANK_8)) & ~Bitboard(sq.rank())) |
@@ -3171,7 +3378,7 @@ inline void attacks::initSliders(Square sq, Magic table[], U64 magic,
     auto &table_sq = table[sq.index()];
 
     table_sq.magic = magic;
-    table_sq.mask  = (attacks(sq, occ) & ~edges).getBits();
+    table_sq.mask  = (rayAttacks(rays, occ) & ~edges).getBits();
     table_sq.shift = 64 - Bitboard(table_sq.mask).count();
 
     if (sq < 64 - 1) {
@@ -3179,7 +3386,7 @@ inline void attacks::initSliders(Square sq, Magic table[], U64 magic,
     }
 
     do {
-        table_sq.attacks[table_sq(occ)] = attacks(sq, occ);
+        table_sq.attacks[table_sq(occ)] = rayAttacks(rays, occ);
         occ                             = (occ - table_sq.mask) & table_sq.mask;
     } while (occ);
 }
@@ -3191,29 +3398,43 @@ inline void attacks::initAttacks() {
     RookTable[0].attacks   = RookAttacks;
 
     for (int i = 0; i < 64; i++) {
-        initSliders(static_cast<Square>(i), BishopTable, BishopMagics[i], bishopAttacks);
-        initSliders(static_cast<Square>(i), RookTable, RookMagics[i], rookAttacks);
+        const auto sq = static_cast<Square>(i);
+
+        const Bitboard bishop_rays[4] = {ray<Direction::NORTH_EAST>(sq), ray<Direction::NORTH_WEST>(sq),
+                                         ray<Direction::SOUTH_EAST>(sq), ray<Direction::SOUTH_WEST>(sq)};
+        const Bitboard rook_rays[4]   = {ray<Direction::NORTH>(sq), ray<Direction::EAST>(sq),
+                                         ray<Direction::SOUTH>(sq), ray<Direction::WEST>(sq)};
+
+        initSliders(sq, BishopTable, BishopMagics[i], bishop_rays);
+        initSliders(sq, RookTable, RookMagics[i], rook_rays);
     }
 }
+
+inline const bool attacks::SlidersInitialized = [] {
+    initAttacks();
+    return true;
+}();
 }  // namespace chess
 
 
 
 namespace chess {
 
-inline auto movegen::init_squares_between() {
+inline constexpr std::array<std::array<Bitboard, 64>, 64> movegen::init_squares_between() {
     std::array<std::array<Bitboard, 64>, 64> squares_between_bb{};
-    Bitboard sqs = 0;
 
-    for (Square sq1 = 0; sq1 < 64; ++sq1) {
-        for (Square sq2 = 0; sq2 < 64; ++sq2) {
-            sqs = Bitboard::fromSquare(sq1) | Bitboard::fromSquare(sq2);
-            if (sq1 == sq2)
-                squares_between_bb[sq1.index()][sq2.index()].clear();
-            else if (sq1.file() == sq2.file() || sq1.rank() == sq2.rank())
-                squares_between_bb[sq1.index()][sq2.index()] = attacks::rook(sq1, sqs) & attacks::rook(sq2, sqs);
-            else if (sq1.diagonal_of() == sq2.diagonal_of() || sq1.antidiagonal_of() == sq2.antidiagonal_of())
-                squares_between_bb[sq1.index()][sq2.index()] = attacks::bishop(sq1, sqs) & attacks::bishop(sq2, sqs);
+    // file and rank steps of the eight directions
+    constexpr int steps[8][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+    for (int sq = 0; sq < 64; ++sq) {
+        for (const auto &step : steps) {
+            Bitboard between = 0;
+
+            for (int f = sq % 8 + step[0], r = sq / 8 + step[1]; f >= 0 && f < 8 && r >= 0 && r < 8;
+                 f += step[0], r += step[1]) {
+                squares_between_bb[sq][r * 8 + f] = between;
+                between.set(r * 8 + f);
+            }
         }
     }
 
@@ -3227,8 +3448,8 @@ inline auto movegen::init_squares_between() {
 /// @param sq
 /// @param double_check
 /// @return
-template <Color::underlying c>
-[[nodiscard]] inline Bitboard movegen::checkMask(const Board &board, Square sq, int &double_check) {
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline Bitboard movegen::checkMask(const BoardType &board, Square sq, int &double_check) {
     double_check = 0;
 
     const auto opp_knight = board.pieces(PieceType::KNIGHT, ~c);
@@ -3287,8 +3508,8 @@ template <Color::underlying c>
 /// @param occ_opp
 /// @param occ_us
 /// @return
-template <Color::underlying c>
-[[nodiscard]] inline Bitboard movegen::pinMaskRooks(const Board &board, Square sq, Bitboard occ_opp, Bitboard occ_us) {
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline Bitboard movegen::pinMaskRooks(const BoardType &board, Square sq, Bitboard occ_opp, Bitboard occ_us) {
     const auto opp_rook  = board.pieces(PieceType::ROOK, ~c);
     const auto opp_queen = board.pieces(PieceType::QUEEN, ~c);
 
@@ -3313,8 +3534,8 @@ template <Color::underlying c>
 /// @param occ_opp
 /// @param occ_us
 /// @return
-template <Color::underlying c>
-[[nodiscard]] inline Bitboard movegen::pinMaskBishops(const Board &board, Square sq, Bitboard occ_opp,
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline Bitboard movegen::pinMaskBishops(const BoardType &board, Square sq, Bitboard occ_opp,
                                                       Bitboard occ_us) {
     const auto opp_bishop = board.pieces(PieceType::BISHOP, ~c);
     const auto opp_queen  = board.pieces(PieceType::QUEEN, ~c);
@@ -3332,21 +3553,13 @@ template <Color::underlying c>
     return pin_diag;
 }
 
-/// @brief Returns the squares that are attacked by the enemy
+/// @brief Returns the squares that are attacked by color c
 /// @tparam c
 /// @param board
-/// @param enemy_empty
+/// @param occupied Occupancy the sliders see
 /// @return
-template <Color::underlying c>
-[[nodiscard]] inline Bitboard movegen::seenSquares(const Board &board, Bitboard enemy_empty) {
-    auto king_sq          = board.kingSq(~c);
-    Bitboard map_king_atk = attacks::king(king_sq) & enemy_empty;
-
-    if (map_king_atk == Bitboard(0ull) && !board.chess960()) {
-        return 0ull;
-    }
-
-    auto occ     = board.occ() & ~Bitboard::fromSquare(king_sq);
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline Bitboard movegen::seenSquares(const BoardType &board, Bitboard occupied) {
     auto queens  = board.pieces(PieceType::QUEEN, c);
     auto pawns   = board.pieces(PieceType::PAWN, c);
     auto knights = board.pieces(PieceType::KNIGHT, c);
@@ -3362,12 +3575,12 @@ template <Color::underlying c>
 
     while (bishops) {
         const auto index = bishops.pop();
-        seen |= attacks::bishop(index, occ);
+        seen |= attacks::bishop(index, occupied);
     }
 
     while (rooks) {
         const auto index = rooks.pop();
-        seen |= attacks::rook(index, occ);
+        seen |= attacks::rook(index, occupied);
     }
 
     const Square index = board.kingSq(c);
@@ -3376,26 +3589,18 @@ template <Color::underlying c>
     return seen;
 }
 
-/// @brief Generate pawn moves.
+/// @brief Generate the destination squares of the pawn moves.
 /// @tparam c
-/// @tparam mt
 /// @param board
-/// @param moves
 /// @param pin_d
 /// @param pin_hv
 /// @param checkmask
 /// @param occ_opp
-template <Color::underlying c, movegen::MoveGenType mt>
-inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitboard pin_d, Bitboard pin_hv,
-                                       Bitboard checkmask, Bitboard occ_opp) {
+/// @return
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline movegen::PawnTargets movegen::pawnTargets(const BoardType &board, Bitboard pin_d, Bitboard pin_hv,
+                                                               Bitboard checkmask, Bitboard occ_opp) {
     constexpr Direction UP              = c == Color::WHITE ? Direction::NORTH : Direction::SOUTH;
-    constexpr Direction DOWN            = c == Color::WHITE ? Direction::SOUTH : Direction::NORTH;
-    constexpr Direction DOWN_LEFT       = c == Color::WHITE ? Direction::SOUTH_WEST : Direction::NORTH_EAST;
-    constexpr Direction DOWN_RIGHT      = c == Color::WHITE ? Direction::SOUTH_EAST : Direction::NORTH_WEST;
-    constexpr Bitboard RANK_B_PROMO     = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_7)]
-                                                            : attacks::MASK_RANK[static_cast<int>(Rank::RANK_2)];
-    constexpr Bitboard RANK_PROMO       = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_8)]
-                                                            : attacks::MASK_RANK[static_cast<int>(Rank::RANK_1)];
     constexpr Bitboard DOUBLE_PUSH_RANK = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_3)]
                                                             : attacks::MASK_RANK[static_cast<int>(Rank::RANK_6)];
 
@@ -3433,6 +3638,37 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
                             (attacks::shift<UP>(single_push_pinned & DOUBLE_PUSH_RANK) & ~board.occ())) &
                            checkmask;
 
+    return {l_pawns, r_pawns, single_push, double_push, pawns_lr};
+}
+
+/// @brief Generate pawn moves.
+/// @tparam c
+/// @tparam mt
+/// @param board
+/// @param moves
+/// @param pin_d
+/// @param pin_hv
+/// @param checkmask
+/// @param occ_opp
+template <Color::underlying c, movegen::MoveGenType mt, typename BoardType>
+inline void movegen::generatePawnMoves(const BoardType &board, Movelist &moves, Bitboard pin_d, Bitboard pin_hv,
+                                       Bitboard checkmask, Bitboard occ_opp) {
+    constexpr Direction DOWN        = c == Color::WHITE ? Direction::SOUTH : Direction::NORTH;
+    constexpr Direction DOWN_LEFT   = c == Color::WHITE ? Direction::SOUTH_WEST : Direction::NORTH_EAST;
+    constexpr Direction DOWN_RIGHT  = c == Color::WHITE ? Direction::SOUTH_EAST : Direction::NORTH_WEST;
+    constexpr Bitboard RANK_B_PROMO = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_7)]
+                                                        : attacks::MASK_RANK[static_cast<int>(Rank::RANK_2)];
+    constexpr Bitboard RANK_PROMO   = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_8)]
+                                                        : attacks::MASK_RANK[static_cast<int>(Rank::RANK_1)];
+
+    const auto pawns   = board.pieces(PieceType::PAWN, c);
+    const auto targets = pawnTargets<c>(board, pin_d, pin_hv, checkmask, occ_opp);
+
+    Bitboard l_pawns     = targets.left;
+    Bitboard r_pawns     = targets.right;
+    Bitboard single_push = targets.single_push;
+    Bitboard double_push = targets.double_push;
+
     if (pawns & RANK_B_PROMO) {
         Bitboard promo_left  = l_pawns & RANK_PROMO;
         Bitboard promo_right = r_pawns & RANK_PROMO;
@@ -3495,7 +3731,7 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
 
     const Square ep = board.enpassantSq();
     if (mt != MoveGenType::QUIET && ep != Square::underlying::NO_SQ) {
-        auto m = generateEPMove(board, checkmask, pin_d, pawns_lr, ep, c);
+        auto m = generateEPMove(board, checkmask, pin_d, targets.pawns_lr, ep, c);
 
         for (const auto &move : m) {
             if (move != Move::NO_MOVE) moves.add(move);
@@ -3503,7 +3739,8 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
     }
 }
 
-[[nodiscard]] inline std::array<Move, 2> movegen::generateEPMove(const Board &board, Bitboard checkmask, Bitboard pin_d,
+template <typename BoardType>
+[[nodiscard]] inline std::array<Move, 2> movegen::generateEPMove(const BoardType &board, Bitboard checkmask, Bitboard pin_d,
                                                                  Bitboard pawns_lr, Square ep, Color c) {
     assert((ep.rank() == Rank::RANK_3 && board.sideToMove() == Color::BLACK) ||
            (ep.rank() == Rank::RANK_6 && board.sideToMove() == Color::WHITE));
@@ -3628,8 +3865,8 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
 /// @param seen
 /// @param pin_hv
 /// @return
-template <Color::underlying c, movegen::MoveGenType mt>
-[[nodiscard]] inline Bitboard movegen::generateCastleMoves(const Board &board, Square sq, Bitboard seen,
+template <Color::underlying c, movegen::MoveGenType mt, typename BoardType>
+[[nodiscard]] inline Bitboard movegen::generateCastleMoves(const BoardType &board, Square sq, Bitboard seen,
                                                            Bitboard pin_hv) {
     if constexpr (mt == MoveGenType::CAPTURE) return 0ull;
     const auto rights = board.castlingRights();
@@ -3680,8 +3917,8 @@ inline void movegen::whileBitboardAdd(Movelist &movelist, Bitboard mask, T func)
 /// @tparam mt
 /// @param movelist
 /// @param board
-template <Color::underlying c, movegen::MoveGenType mt>
-inline void movegen::legalmoves(Movelist &movelist, const Board &board, int pieces) {
+template <Color::underlying c, movegen::MoveGenType mt, typename BoardType>
+inline void movegen::legalmoves(Movelist &movelist, const BoardType &board, int pieces) {
     /*
      The size of the movelist might not
      be 0! This is done on purpose since it enables
@@ -3689,19 +3926,27 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
     */
     auto king_sq = board.kingSq(c);
 
-    int double_check = 0;
-
     Bitboard occ_us  = board.us(c);
     Bitboard occ_opp = board.us(~c);
     Bitboard occ_all = occ_us | occ_opp;
 
     Bitboard opp_empty = ~occ_us;
 
-    Bitboard check_mask = checkMask<c>(board, king_sq, double_check);
-    Bitboard pin_hv     = pinMaskRooks<c>(board, king_sq, occ_opp, occ_us);
-    Bitboard pin_d      = pinMaskBishops<c>(board, king_sq, occ_opp, occ_us);
+    // checkers and pins are cached by the board, so unmakeMove() gets them back for free
+    const auto &info = board.attackInfo();
+
+    Bitboard check_mask = constants::DEFAULT_CHECKMASK;
+    Bitboard pin_hv     = info.pin_hv;
+    Bitboard pin_d      = info.pin_d;
+
+    const int double_check = std::min(info.checkers.count(), 2);
 
-    assert(double_check <= 2);
+    if (double_check == 1) {
+        const auto index = info.checkers.lsb();
+        check_mask       = SQUARES_BETWEEN_BB[king_sq.index()][index] | info.checkers;
+    } else if (double_check == 2) {
+        check_mask = 0;
+    }
 
     // Moves have to be on the checkmask
     Bitboard movable_square;
@@ -3715,7 +3960,14 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
         movable_square = ~occ_all;
 
     if (pieces & PieceGenType::KING) {
-        Bitboard seen = seenSquares<~c>(board, opp_empty);
+        Bitboard seen = 0;
+
+        // no need to know what is attacked if the king has nowhere to go
+        if (bool(attacks::king(king_sq) & opp_empty) || board.chess960()) {
+            // sliders giving check see through the king, it can't step back along their ray
+            seen = double_check ? seenSquares<~c>(board, occ_all ^ Bitboard::fromSquare(king_sq))
+                                : board.attackedBy(~c);
+        }
 
         whileBitboardAdd(movelist, Bitboard::fromSquare(king_sq),
                          [&](Square sq) { return generateKingMoves(sq, seen, movable_square); });
@@ -3772,112 +4024,403 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
     }
 }
 
-template <movegen::MoveGenType mt>
-inline void movegen::legalmoves(Movelist &movelist, const Board &board, int pieces) {
-    movelist.clear();
+/// @brief Counts the legal moves for a position
+/// @tparam c
+/// @tparam stop_at_first Returns as soon as a legal move was found
+/// @param board
+/// @return
+template <Color::underlying c, bool stop_at_first, typename BoardType>
+[[nodiscard]] inline int movegen::countLegalMoves(const BoardType &board) {
+    // Same masks as legalmoves, the destination squares are counted instead of added as moves.
+    // The king comes last, what it may not step on is the most expensive part to find out.
+    constexpr Bitboard RANK_PROMO = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_8)]
+                                                      : attacks::MASK_RANK[static_cast<int>(Rank::RANK_1)];
 
-    if (board.sideToMove() == Color::WHITE)
-        legalmoves<Color::WHITE, mt>(movelist, board, pieces);
-    else
-        legalmoves<Color::BLACK, mt>(movelist, board, pieces);
-}
+    const auto king_sq = board.kingSq(c);
 
-inline const std::array<std::array<Bitboard, 64>, 64> movegen::SQUARES_BETWEEN_BB = [] {
-    attacks::initAttacks();
-    return movegen::init_squares_between();
-}();
+    const Bitboard occ_us  = board.us(c);
+    const Bitboard occ_opp = board.us(~c);
+    const Bitboard occ_all = occ_us | occ_opp;
 
-}  // namespace chess
+    const auto &info = board.attackInfo();
 
-#include <istream>
+    Bitboard check_mask = constants::DEFAULT_CHECKMASK;
 
-namespace chess::pgn {
+    const int double_check = std::min(info.checkers.count(), 2);
 
-/// @brief Visitor interface for parsing PGN files
-/// the order of the calls is as follows:
-class Visitor {
-   public:
-    virtual ~Visitor() {};
+    if (double_check == 1) {
+        const auto index = info.checkers.lsb();
+        check_mask       = SQUARES_BETWEEN_BB[king_sq.index()][index] | info.checkers;
+    }
 
-    /// @brief When true, the current PGN will be skipped and only
-    /// endPgn will be called, this will also reset the skip flag to false.
-    /// Has to be called after startPgn.
-    /// @param skip
-    void skipPgn(bool skip) { skip_ = skip; }
-    bool skip() { return skip_; }
+    int count = 0;
 
-    /// @brief Called when a new PGN starts
-    virtual void startPgn() = 0;
+    if (double_check < 2) {
+        const Bitboard pin_hv         = info.pin_hv;
+        const Bitboard pin_d          = info.pin_d;
+        const Bitboard movable_square = ~occ_us & check_mask;
 
-    /// @brief Called for each header
-    /// @param key
-    /// @param value
-    virtual void header(std::string_view key, std::string_view value) = 0;
+        const auto pawns = pawnTargets<c>(board, pin_d, pin_hv, check_mask, occ_opp);
 
-    /// @brief Called before the first move of a game
-    virtual void startMoves() = 0;
+        count += pawns.left.count() + pawns.right.count() + pawns.single_push.count() + pawns.double_push.count();
 
-    /// @brief Called for each move of a game
-    /// @param move
-    /// @param comment
-    virtual void move(std::string_view move, std::string_view comment) = 0;
+        // a promotion is four moves
+        count += 3 * ((pawns.left & RANK_PROMO).count() + (pawns.right & RANK_PROMO).count() +
+                      (pawns.single_push & RANK_PROMO).count());
 
-    /// @brief Called when a game ends
-    virtual void endPgn() = 0;
+        const Square ep = board.enpassantSq();
+        if (ep != Square::underlying::NO_SQ) {
+            for (const auto &move : generateEPMove(board, check_mask, pin_d, pawns.pawns_lr, ep, c)) {
+                count += move != Move::NO_MOVE;
+            }
+        }
 
-   private:
-    bool skip_ = false;
-};
+        if (stop_at_first && count) return count;
 
-template <std::size_t BUFFER_SIZE =
-#if defined(__unix__) || defined(__unix) || defined(unix) || defined(__APPLE__) || defined(__MACH__)
-#    if defined(__APPLE__) || defined(__MACH__)
-              256
-#    else
-              1024
-#    endif
-#else
-              256
-#endif
-          >
-class StreamParser {
-   public:
-    StreamParser(std::istream &stream) : stream_buffer(stream) {}
+        Bitboard knights = board.pieces(PieceType::KNIGHT, c) & ~(pin_d | pin_hv);
+        while (knights) count += (generateKnightMoves(knights.pop()) & movable_square).count();
 
-    void readGames(Visitor &vis) {
-        visitor = &vis;
+        if (stop_at_first && count) return count;
 
-        if (!stream_buffer.fill()) {
-            return;
-        }
+        Bitboard bishops = board.pieces(PieceType::BISHOP, c) & ~pin_hv;
+        while (bishops) count += (generateBishopMoves(bishops.pop(), pin_d, occ_all) & movable_square).count();
 
-        stream_buffer.loop([this](char c) {
-            if (in_header) {
-                visitor->skipPgn(false);
+        if (stop_at_first && count) return count;
 
-                if (c == '[') {
-                    visitor->startPgn();
-                    pgn_end = false;
+        Bitboard rooks = board.pieces(PieceType::ROOK, c) & ~pin_d;
+        while (rooks) count += (generateRookMoves(rooks.pop(), pin_hv, occ_all) & movable_square).count();
 
-                    processHeader();
-                }
+        if (stop_at_first && count) return count;
 
-            } else if (in_body) {
-                processBody();
-            }
+        Bitboard queens = board.pieces(PieceType::QUEEN, c) & ~(pin_d & pin_hv);
+        while (queens) count += (generateQueenMoves(queens.pop(), pin_d, pin_hv, occ_all) & movable_square).count();
 
-            stream_buffer.advance();
-        });
+        if (stop_at_first && count) return count;
+    }
 
-        if (!pgn_end) {
-            onEnd();
-        }
+    Bitboard seen = 0;
+
+    if (bool(attacks::king(king_sq) & ~occ_us) || board.chess960()) {
+        seen = double_check ? seenSquares<~c>(board, occ_all ^ Bitboard::fromSquare(king_sq)) : board.attackedBy(~c);
     }
 
-   private:
-    class LineBuffer {
-       public:
-        bool empty() const noexcept { return index_ == 0; }
+    count += generateKingMoves(king_sq, seen, ~occ_us).count();
+
+    if (!double_check && Square::back_rank(king_sq, c) && board.castlingRights().has(c)) {
+        count += generateCastleMoves<c, MoveGenType::ALL>(board, king_sq, seen, info.pin_hv).count();
+    }
+
+    return count;
+}
+
+/// @brief Checks if there is a legal move for a position
+/// @tparam c
+/// @param board
+/// @return
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline bool movegen::hasLegalMove(const BoardType &board) {
+    return countLegalMoves<c, true>(board) != 0;
+}
+
+/// @brief all pseudo-legal moves for a position
+/// @tparam c
+/// @tparam mt
+/// @param movelist
+/// @param board
+template <Color::underlying c, movegen::MoveGenType mt, typename BoardType>
+inline void movegen::pseudolegalmoves(Movelist &movelist, const BoardType &board, int pieces) {
+    // Same as legalmoves without the check and pin masks and the squares seen by the enemy,
+    // isLegal() takes care of those.
+    auto king_sq = board.kingSq(c);
+
+    Bitboard occ_us  = board.us(c);
+    Bitboard occ_opp = board.us(~c);
+    Bitboard occ_all = occ_us | occ_opp;
+
+    Bitboard movable_square;
+
+    if (mt == MoveGenType::ALL)
+        movable_square = ~occ_us;
+    else if (mt == MoveGenType::CAPTURE)
+        movable_square = occ_opp;
+    else  // QUIET moves
+        movable_square = ~occ_all;
+
+    if (pieces & PieceGenType::KING) {
+        whileBitboardAdd(movelist, Bitboard::fromSquare(king_sq),
+                         [&](Square sq) { return generateKingMoves(sq, 0, movable_square); });
+
+        if (Square::back_rank(king_sq, c) && board.castlingRights().has(c)) {
+            Bitboard moves_bb = generateCastleMoves<c, mt>(board, king_sq, 0, 0);
+            while (moves_bb) {
+                Square to = moves_bb.pop();
+                movelist.add(Move::make<Move::CASTLING>(king_sq, to));
+            }
+        }
+    }
+
+    if (pieces & PieceGenType::PAWN) {
+        generatePawnMoves<c, mt>(board, movelist, 0, 0, constants::DEFAULT_CHECKMASK, occ_opp);
+    }
+
+    if (pieces & PieceGenType::KNIGHT) {
+        whileBitboardAdd(movelist, board.pieces(PieceType::KNIGHT, c),
+                         [&](Square sq) { return generateKnightMoves(sq) & movable_square; });
+    }
+
+    if (pieces & PieceGenType::BISHOP) {
+        whileBitboardAdd(movelist, board.pieces(PieceType::BISHOP, c),
+                         [&](Square sq) { return generateBishopMoves(sq, 0, occ_all) & movable_square; });
+    }
+
+    if (pieces & PieceGenType::ROOK) {
+        whileBitboardAdd(movelist, board.pieces(PieceType::ROOK, c),
+                         [&](Square sq) { return generateRookMoves(sq, 0, occ_all) & movable_square; });
+    }
+
+    if (pieces & PieceGenType::QUEEN) {
+        whileBitboardAdd(movelist, board.pieces(PieceType::QUEEN, c),
+                         [&](Square sq) { return generateQueenMoves(sq, 0, 0, occ_all) & movable_square; });
+    }
+}
+
+/// @brief Returns the pieces of a color attacking a square, sliders see through the given occupancy.
+/// @param board
+/// @param color Attacker Color
+/// @param sq
+/// @param occupied
+/// @return
+template <typename BoardType>
+[[nodiscard]] inline Bitboard movegen::attackers(const BoardType &board, Color color, Square sq, Bitboard occupied) {
+    const auto queens = board.pieces(PieceType::QUEEN, color);
+
+    auto atks = attacks::pawn(~color, sq) & board.pieces(PieceType::PAWN, color);
+    atks |= attacks::knight(sq) & board.pieces(PieceType::KNIGHT, color);
+    atks |= attacks::bishop(sq, occupied) & (board.pieces(PieceType::BISHOP, color) | queens);
+    atks |= attacks::rook(sq, occupied) & (board.pieces(PieceType::ROOK, color) | queens);
+    atks |= attacks::king(sq) & board.pieces(PieceType::KING, color);
+
+    return atks;
+}
+
+/// @brief Computes the checkers and the pin masks of the side to move (see Board::AttackInfo).
+/// @param board
+/// @param info
+template <typename BoardType, typename AttackInfo>
+inline void movegen::checkInfo(const BoardType &board, AttackInfo &info) {
+    const auto c       = board.sideToMove();
+    const auto king_sq = board.kingSq(c);
+    const auto occ_us  = board.us(c);
+    const auto occ_opp = board.us(~c);
+
+    info.checkers = attackers(board, ~c, king_sq, board.occ());
+
+    if (c == Color::WHITE) {
+        info.pin_hv = pinMaskRooks<Color::WHITE>(board, king_sq, occ_opp, occ_us);
+        info.pin_d  = pinMaskBishops<Color::WHITE>(board, king_sq, occ_opp, occ_us);
+    } else {
+        info.pin_hv = pinMaskRooks<Color::BLACK>(board, king_sq, occ_opp, occ_us);
+        info.pin_d  = pinMaskBishops<Color::BLACK>(board, king_sq, occ_opp, occ_us);
+    }
+}
+
+/// @brief Checks if a pseudo-legal move of the side to move is legal.
+/// @param board
+/// @param move
+/// @return
+template <typename BoardType>
+[[nodiscard]] inline bool movegen::isLegal(const BoardType &board, const Move move) {
+    const auto c        = board.sideToMove();
+    const auto king_sq  = board.kingSq(c);
+    const auto from     = move.from();
+    const auto checkers = board.checkers();
+
+    if (move.typeOf() == Move::CASTLING) {
+        if (checkers) return false;
+
+        const bool king_side = move.to() > from;
+        const auto king_to   = Square::castling_king_square(king_side, c);
+        const auto rook_to   = Square::castling_rook_square(king_side, c);
+
+        // the king may not pass an attacked square, seen as if it had already left its square
+        const auto occ = board.occ() ^ Bitboard::fromSquare(from);
+        auto path      = SQUARES_BETWEEN_BB[from.index()][king_to.index()] | Bitboard::fromSquare(king_to);
+
+        while (path) {
+            if (attackers(board, ~c, path.pop(), occ)) return false;
+        }
+
+        // and the rook may not have been shielding it, e.g. in chess960 with a slider behind it
+        const auto occ_after =
+            (occ ^ Bitboard::fromSquare(move.to())) | Bitboard::fromSquare(king_to) | Bitboard::fromSquare(rook_to);
+
+        return !attackers(board, ~c, king_to, occ_after);
+    }
+
+    if (from == king_sq) {
+        return !attackers(board, ~c, move.to(), board.occ() ^ Bitboard::fromSquare(from));
+    }
+
+    // the common case, neither in check nor pinned
+    if (!checkers && !(board.pinned() & Bitboard::fromSquare(from)) && move.typeOf() != Move::ENPASSANT) return true;
+
+    // play the move on the occupancy, the captured piece no longer attacks
+    auto captured = Bitboard::fromSquare(move.to());
+    auto occ      = (board.occ() ^ Bitboard::fromSquare(from)) | captured;
+
+    if (move.typeOf() == Move::ENPASSANT) {
+        captured = Bitboard::fromSquare(move.to().ep_square());
+        occ ^= captured;
+    }
+
+    return !(attackers(board, ~c, king_sq, occ) & ~captured);
+}
+
+template <movegen::MoveGenType mt, typename BoardType>
+inline void movegen::legalmoves(Movelist &movelist, const BoardType &board, int pieces) {
+    movelist.clear();
+
+    if (board.sideToMove() == Color::WHITE)
+        legalmoves<Color::WHITE, mt>(movelist, board, pieces);
+    else
+        legalmoves<Color::BLACK, mt>(movelist, board, pieces);
+}
+
+template <movegen::MoveGenType mt, typename BoardType>
+inline void movegen::pseudolegalmoves(Movelist &movelist, const BoardType &board, int pieces) {
+    movelist.clear();
+
+    if (board.sideToMove() == Color::WHITE)
+        pseudolegalmoves<Color::WHITE, mt>(movelist, board, pieces);
+    else
+        pseudolegalmoves<Color::BLACK, mt>(movelist, board, pieces);
+}
+
+template <typename BoardType>
+[[nodiscard]] inline bool movegen::hasLegalMove(const BoardType &board) {
+    if (board.sideToMove() == Color::WHITE)
+        return hasLegalMove<Color::WHITE>(board);
+    else
+        return hasLegalMove<Color::BLACK>(board);
+}
+
+template <typename BoardType>
+[[nodiscard]] inline int movegen::countLegalMoves(const BoardType &board) {
+    if (board.sideToMove() == Color::WHITE)
+        return countLegalMoves<Color::WHITE>(board);
+    else
+        return countLegalMoves<Color::BLACK>(board);
+}
+
+inline constexpr std::array<std::array<Bitboard, 64>, 64> movegen::SQUARES_BETWEEN_BB = init_squares_between();
+
+}  // namespace chess
+
+#include <exception>
+#include <fstream>
+#include <istream>
+#include <thread>
+
+#if defined(__unix__) || defined(__unix) || defined(unix) || defined(__APPLE__) || defined(__MACH__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    define CHESS_PGN_MMAP
+#endif
+
+namespace chess::pgn {
+
+/// @brief Visitor interface for parsing PGN files
+/// the order of the calls is as follows:
+class Visitor {
+   public:
+    virtual ~Visitor() {};
+
+    /// @brief When true, the current PGN will be skipped and only
+    /// endPgn will be called, this will also reset the skip flag to false.
+    /// Has to be called after startPgn.
+    /// @param skip
+    void skipPgn(bool skip) { skip_ = skip; }
+    bool skip() { return skip_; }
+
+    /// @brief Called when a new PGN starts
+    virtual void startPgn() = 0;
+
+    /// @brief Called for each header
+    /// @param key
+    /// @param value
+    virtual void header(std::string_view key, std::string_view value) = 0;
+
+    /// @brief Called before the first move of a game
+    virtual void startMoves() = 0;
+
+    /// @brief Called for each move of a game
+    /// @param move
+    /// @param comment
+    virtual void move(std::string_view move, std::string_view comment) = 0;
+
+    /// @brief Called when a game ends
+    virtual void endPgn() = 0;
+
+   private:
+    bool skip_ = false;
+};
+
+template <std::size_t BUFFER_SIZE =
+#if defined(__unix__) || defined(__unix) || defined(unix) || defined(__APPLE__) || defined(__MACH__)
+#    if defined(__APPLE__) || defined(__MACH__)
+              256
+#    else
+              1024
+#    endif
+#else
+              256
+#endif
+          >
+class StreamParser {
+   public:
+    StreamParser(std::istream &stream) : stream_buffer(stream) {}
+
+    /// @brief Parses a PGN that is already in memory, e.g. a MappedFile, without copying it.
+    /// The data has to outlive the parser.
+    /// @param pgn
+    explicit StreamParser(std::string_view pgn) : stream_buffer(pgn) {}
+
+    void readGames(Visitor &vis) {
+        visitor = &vis;
+
+        if (!stream_buffer.fill()) {
+            return;
+        }
+
+        stream_buffer.loop([this](char c) {
+            if (in_header) {
+                visitor->skipPgn(false);
+
+                if (c == '[') {
+                    visitor->startPgn();
+                    pgn_end = false;
+
+                    processHeader();
+                }
+
+            } else if (in_body) {
+                processBody();
+            }
+
+            stream_buffer.advance();
+        });
+
+        if (!pgn_end) {
+            onEnd();
+        }
+    }
+
+   private:
+    class LineBuffer {
+       public:
+        bool empty() const noexcept { return index_ == 0; }
 
         void clear() noexcept { index_ = 0; }
 
@@ -3906,10 +4449,12 @@ class StreamParser {
     class StreamBuffer {
        private:
         static constexpr std::size_t N = BUFFER_SIZE;
-        using BufferType               = std::array<char, N * N>;
 
        public:
-        StreamBuffer(std::istream &stream) : stream_(stream) {}
+        StreamBuffer(std::istream &stream) : stream_(&stream), storage_(N * N), buffer_(storage_.data()) {}
+
+        // the whole input is a single buffer, which the first fill() hands out
+        explicit StreamBuffer(std::string_view data) : buffer_(data.data()), size_(data.size()) {}
 
         template <typename FUNC>
         void loop(FUNC f) {
@@ -3976,12 +4521,21 @@ class StreamParser {
         }
 
         bool fill() {
-            if (!stream_.good()) return false;
+            if (!stream_) {
+                if (bytes_read_ == size_) return false;
+
+                buffer_index_ = 0;
+                bytes_read_   = size_;
+
+                return bytes_read_ > 0;
+            }
+
+            if (!stream_->good()) return false;
 
             buffer_index_ = 0;
 
-            stream_.read(buffer_.data(), N * N);
-            bytes_read_ = stream_.gcount();
+            stream_->read(storage_.data(), N * N);
+            bytes_read_ = stream_->gcount();
 
             return bytes_read_ > 0;
         }
@@ -3996,7 +4550,7 @@ class StreamParser {
 
         char peek() {
             if (buffer_index_ + 1 >= bytes_read_) {
-                return stream_.peek();
+                return stream_ ? stream_->peek() : std::char_traits<char>::eof();
             }
 
             return buffer_[buffer_index_ + 1];
@@ -4019,8 +4573,10 @@ class StreamParser {
         }
 
        private:
-        std::istream &stream_;
-        BufferType buffer_;
+        std::istream *stream_ = nullptr;
+        std::vector<char> storage_;
+        const char *buffer_;
+        std::streamsize size_         = 0;
         std::streamsize bytes_read_   = 0;
         std::streamsize buffer_index_ = 0;
     };
@@ -4424,58 +4980,902 @@ class StreamParser {
 
     bool pgn_end = true;
 };
-}  // namespace chess::pgn
 
-#include <sstream>
+/// @brief Read-only view of a whole file, memory mapped where the platform has mmap and read into
+/// memory otherwise. Meant to be handed to StreamParser(std::string_view) or readGamesParallel.
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string &path) {
+#ifdef CHESS_PGN_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0) {
+            size_ = static_cast<std::size_t>(st.st_size);
+            open_ = true;
+
+            if (size_ > 0) {
+                void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (data == MAP_FAILED) {
+                    size_ = 0;
+                    open_ = false;
+                } else {
+                    // the pages are read front to back, let the kernel read ahead
+                    ::madvise(data, size_, MADV_SEQUENTIAL);
+                    data_ = static_cast<const char *>(data);
+                }
+            }
+        }
 
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return;
 
-namespace chess {
-class uci {
-   public:
-    /// @brief Converts an internal move to a UCI string
-    /// @param move
-    /// @param chess960
+        contents_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data_ = contents_.data();
+        size_ = contents_.size();
+        open_ = true;
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef CHESS_PGN_MMAP
+        if (data_) ::munmap(const_cast<char *>(data_), size_);
+#endif
+    }
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /// @brief Whether the file could be opened and read, an empty file counts as open.
     /// @return
-    [[nodiscard]] static std::string moveToUci(const Move &move, bool chess960 = false) noexcept(false) {
-        // Get the from and to squares
-        Square from_sq = move.from();
-        Square to_sq   = move.to();
+    [[nodiscard]] bool isOpen() const noexcept { return open_; }
 
-        // If the move is not a chess960 castling move and is a king moving more than one square,
-        // update the to square to be the correct square for a regular castling move
-        if (!chess960 && move.typeOf() == Move::CASTLING) {
-            to_sq = Square(to_sq > from_sq ? File::FILE_G : File::FILE_C, from_sq.rank());
-        }
+    /// @brief The contents of the file, valid as long as the MappedFile lives.
+    /// @return
+    [[nodiscard]] std::string_view view() const noexcept { return {data_, size_}; }
 
-        std::stringstream ss;
+   private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+    bool open_        = false;
+#ifndef CHESS_PGN_MMAP
+    std::string contents_;
+#endif
+};
 
-        // Add the from and to squares to the string stream
-        ss << from_sq;
-        ss << to_sq;
+/// @brief Finds the first game that starts at or after `offset`: an "[Event " tag at the start of a
+/// line, after a blank line or at the very beginning.
+/// @param pgn
+/// @param offset
+/// @return the position of the tag, pgn.size() if there is none
+[[nodiscard]] inline std::size_t nextGameStart(std::string_view pgn, std::size_t offset) noexcept {
+    if (offset == 0) return 0;
 
-        // If the move is a promotion, add the promoted piece to the string stream
-        if (move.typeOf() == Move::PROMOTION) {
-            ss << static_cast<std::string>(move.promotionType());
+    while ((offset = pgn.find("[Event ", offset)) != std::string_view::npos) {
+        // walk back over the end of the previous line, which has to be an empty one
+        std::size_t newlines = 0, i = offset;
+
+        while (i > 0 && newlines < 2 && (pgn[i - 1] == '\n' || pgn[i - 1] == '\r')) {
+            newlines += pgn[--i] == '\n';
         }
 
-        return ss.str();
+        if (newlines == 2 || i == 0) return offset;
+
+        offset++;
     }
 
-    /// @brief Converts a UCI string to an internal move.
-    /// @param board
-    /// @param uci
-    /// @return
-    [[nodiscard]] static Move uciToMove(const Board &board, const std::string &uci) noexcept(false) {
-        if (uci.length() < 4) {
-            return Move::NO_MOVE;
-        }
+    return pgn.size();
+}
 
-        Square source = Square(uci.substr(0, 2));
-        Square target = Square(uci.substr(2, 2));
+/// @brief Cuts a PGN into `parts` consecutive ranges of about the same size, each starting at a
+/// game boundary (see nextGameStart). Ranges can be empty when there are fewer games than parts.
+/// @param pgn
+/// @param parts
+/// @return the ranges, in order
+[[nodiscard]] inline std::vector<std::string_view> splitGames(std::string_view pgn, std::size_t parts) {
+    std::vector<std::string_view> ranges;
+    std::size_t start = 0;
 
-        if (!source.is_valid() || !target.is_valid()) {
-            return Move::NO_MOVE;
-        }
+    for (std::size_t i = 1; i <= parts; i++) {
+        const auto end = i == parts ? pgn.size() : nextGameStart(pgn, std::max(start, pgn.size() * i / parts));
+
+        ranges.push_back(pgn.substr(start, end - start));
+        start = end;
+    }
+
+    return ranges;
+}
+
+/// @brief Parses a PGN in memory on one thread per visitor. The PGN is cut with splitGames and
+/// every range is read by its own StreamParser into the visitor with the same index, so the
+/// visitors only have to be thread safe towards each other. Going through the visitors front to
+/// back sees the games in file order. An exception from a visitor is rethrown once all threads
+/// are done.
+/// @tparam VisitorType a class derived from Visitor
+/// @param pgn
+/// @param visitors
+template <typename VisitorType>
+void readGamesParallel(std::string_view pgn, std::vector<VisitorType> &visitors) {
+    const auto ranges = splitGames(pgn, visitors.size());
+
+    std::vector<std::exception_ptr> errors(ranges.size());
+    std::vector<std::thread> threads;
+
+    const auto parse = [&](std::size_t i) {
+        try {
+            StreamParser<> parser(ranges[i]);
+            parser.readGames(visitors[i]);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    // the calling thread takes the first range
+    for (std::size_t i = 1; i < ranges.size(); i++) {
+        if (!ranges[i].empty()) threads.emplace_back(parse, i);
+    }
+
+    if (!ranges.empty()) parse(0);
+
+    for (auto &thread : threads) thread.join();
+
+    for (const auto &error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+}  // namespace chess::pgn
+
+#include <type_traits>
+
+
+namespace chess {
+
+/// @brief A position with the interface of Board, meant for search code.
+/// It has no virtual functions and keeps its history in a fixed-capacity array instead of a
+/// std::vector, so make/unmake can be inlined and a copy (for copy-make) never allocates and only
+/// copies the part of the history in use.
+/// Classes deriving from it (CRTP) can shadow the onPlacePiece/onRemovePiece/onSetFen hooks to keep
+/// their own incremental state, e.g. an evaluation:
+///
+///     class EvalPosition : public BasicPosition<EvalPosition> {
+///         friend class BasicPosition<EvalPosition>;
+///         void onPlacePiece(Piece piece, Square sq) { ... }
+///     };
+///
+/// FEN parsing goes through Board, positions are built once and then only moved around.
+/// @tparam Derived The deriving class, void if there is none.
+/// @tparam MaxPly Capacity of the history, moves made since the last setFen. Past it, the oldest
+/// half is dropped and those moves can no longer be unmade.
+template <typename Derived = void, std::size_t MaxPly = 256>
+class BasicPosition {
+    using U64  = std::uint64_t;
+    using Self = std::conditional_t<std::is_void_v<Derived>, BasicPosition, Derived>;
+
+    struct State {
+        U64 hash;
+        U64 pawn_key;
+        U64 material_key;
+        Board::CastlingRights castling;
+        Square enpassant;
+        uint8_t half_moves;
+        Piece captured_piece;
+        Board::AttackInfo info;
+    };
+
+   public:
+    using CastlingRights = Board::CastlingRights;
+    using AttackInfo     = Board::AttackInfo;
+
+    explicit BasicPosition(std::string_view fen = constants::STARTPOS, bool chess960 = false) {
+        chess960_ = chess960;
+        load(Board(fen, chess960));
+    }
+
+    /// @brief Copies the position of a board, without its move history.
+    /// @param board
+    explicit BasicPosition(const Board &board) { load(board); }
+
+    BasicPosition(const BasicPosition &other) { copyFrom(other); }
+
+    BasicPosition &operator=(const BasicPosition &other) {
+        if (this != &other) copyFrom(other);
+        return *this;
+    }
+
+    static BasicPosition fromFen(std::string_view fen) { return BasicPosition(fen); }
+
+    void setFen(std::string_view fen) {
+        load(Board(fen, chess960_));
+        self().onSetFen();
+    }
+
+    /// @brief A Board of the current position, without the move history.
+    /// @return
+    [[nodiscard]] Board toBoard() const { return Board(getFen(), chess960_); }
+
+    /// @brief Get the current FEN string.
+    /// @return
+    [[nodiscard]] std::string getFen(bool move_counters = true) const {
+        std::string ss;
+        ss.reserve(100);
+
+        for (int rank = 7; rank >= 0; rank--) {
+            int free_space = 0;
+
+            for (int file = 0; file < 8; file++) {
+                const Piece piece = board_[rank * 8 + file];
+
+                if (piece == Piece::NONE) {
+                    free_space++;
+                    continue;
+                }
+
+                if (free_space) {
+                    ss += char('0' + free_space);
+                    free_space = 0;
+                }
+
+                ss += static_cast<std::string>(piece);
+            }
+
+            if (free_space) ss += char('0' + free_space);
+            if (rank > 0) ss += '/';
+        }
+
+        ss += stm_ == Color::WHITE ? " w " : " b ";
+        ss += cr_.isEmpty() ? "-" : getCastleString();
+        ss += ' ';
+        ss += ep_sq_ == Square::underlying::NO_SQ ? std::string("-") : static_cast<std::string>(ep_sq_);
+
+        if (move_counters) {
+            ss += ' ';
+            ss += std::to_string(halfMoveClock());
+            ss += ' ';
+            ss += std::to_string(fullMoveNumber());
+        }
+
+        return ss;
+    }
+
+    template <bool EXACT = false>
+    void makeMove(const Move move) {
+        const auto capture  = at(move.to()) != Piece::NONE && move.typeOf() != Move::CASTLING;
+        const auto captured = at(move.to());
+        const auto pt       = at<PieceType>(move.from());
+
+        // Validate side to move
+        assert((at(move.from()) < Piece::BLACKPAWN) == (stm_ == Color::WHITE));
+        reserveState();
+
+        states_[size_++] = State{key_, pawn_key_, material_key_, cr_, ep_sq_, hfm_, captured, info_};
+        info_.valid      = 0;
+
+        hfm_++;
+        plies_++;
+
+        if (ep_sq_ != Square::underlying::NO_SQ) key_ ^= Zobrist::enpassant(ep_sq_.file());
+        ep_sq_ = Square::underlying::NO_SQ;
+
+        if (capture) {
+            removePiece(captured, move.to());
+
+            hfm_ = 0;
+            key_ ^= Zobrist::piece(captured, move.to());
+            material_key_ ^= Zobrist::piece(captured, Square(pieces(captured.type(), ~stm_).count()));
+
+            if (captured.type() == PieceType::PAWN) pawn_key_ ^= Zobrist::piece(captured, move.to());
+
+            // remove castling rights if rook is captured
+            if (captured.type() == PieceType::ROOK && Rank::back_rank(move.to().rank(), ~stm_)) {
+                const auto king_sq = kingSq(~stm_);
+                const auto file    = CastlingRights::closestSide(move.to(), king_sq);
+
+                if (cr_.getRookFile(~stm_, file) == move.to().file()) {
+                    key_ ^= Zobrist::castlingIndex(cr_.clear(~stm_, file));
+                }
+            }
+        }
+
+        // remove castling rights if king moves
+        if (pt == PieceType::KING && cr_.has(stm_)) {
+            key_ ^= Zobrist::castling(cr_.hashIndex());
+            cr_.clear(stm_);
+            key_ ^= Zobrist::castling(cr_.hashIndex());
+        } else if (pt == PieceType::ROOK && Square::back_rank(move.from(), stm_)) {
+            const auto king_sq = kingSq(stm_);
+            const auto file    = CastlingRights::closestSide(move.from(), king_sq);
+
+            // remove castling rights if rook moves from back rank
+            if (cr_.getRookFile(stm_, file) == move.from().file()) {
+                key_ ^= Zobrist::castlingIndex(cr_.clear(stm_, file));
+            }
+        } else if (pt == PieceType::PAWN) {
+            hfm_ = 0;
+
+            // double push, add the enpassant hash if enemy pawns are attacking the square
+            if (Square::value_distance(move.to(), move.from()) == 16) {
+                Bitboard ep_mask = attacks::pawn(stm_, move.to().ep_square());
+
+                if (static_cast<bool>(ep_mask & pieces(PieceType::PAWN, ~stm_)) &&
+                    (!EXACT || hasLegalEnpassant(move))) {
+                    assert(at(move.to().ep_square()) == Piece::NONE);
+                    ep_sq_ = move.to().ep_square();
+                    key_ ^= Zobrist::enpassant(move.to().ep_square().file());
+                }
+            }
+        }
+
+        if (move.typeOf() == Move::CASTLING) {
+            assert(at<PieceType>(move.from()) == PieceType::KING);
+            assert(at<PieceType>(move.to()) == PieceType::ROOK);
+
+            const bool king_side = move.to() > move.from();
+            const auto rookTo    = Square::castling_rook_square(king_side, stm_);
+            const auto kingTo    = Square::castling_king_square(king_side, stm_);
+
+            const auto king = at(move.from());
+            const auto rook = at(move.to());
+
+            removePiece(king, move.from());
+            removePiece(rook, move.to());
+
+            placePiece(king, kingTo);
+            placePiece(rook, rookTo);
+
+            key_ ^= Zobrist::piece(king, move.from()) ^ Zobrist::piece(king, kingTo);
+            key_ ^= Zobrist::piece(rook, move.to()) ^ Zobrist::piece(rook, rookTo);
+        } else if (move.typeOf() == Move::PROMOTION) {
+            const auto piece_pawn = Piece(PieceType::PAWN, stm_);
+            const auto piece_prom = Piece(move.promotionType(), stm_);
+
+            removePiece(piece_pawn, move.from());
+            placePiece(piece_prom, move.to());
+
+            key_ ^= Zobrist::piece(piece_pawn, move.from()) ^ Zobrist::piece(piece_prom, move.to());
+            pawn_key_ ^= Zobrist::piece(piece_pawn, move.from());
+            material_key_ ^= Zobrist::piece(piece_pawn, Square(pieces(PieceType::PAWN, stm_).count())) ^
+                             Zobrist::piece(piece_prom, Square(pieces(piece_prom.type(), stm_).count() - 1));
+        } else {
+            assert(at(move.from()) != Piece::NONE);
+            assert(at(move.to()) == Piece::NONE);
+
+            const auto piece = at(move.from());
+
+            removePiece(piece, move.from());
+            placePiece(piece, move.to());
+
+            key_ ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, move.to());
+
+            if (pt == PieceType::PAWN) {
+                pawn_key_ ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, move.to());
+            }
+        }
+
+        if (move.typeOf() == Move::ENPASSANT) {
+            assert(at<PieceType>(move.to().ep_square()) == PieceType::PAWN);
+
+            const auto piece = Piece(PieceType::PAWN, ~stm_);
+
+            removePiece(piece, move.to().ep_square());
+
+            key_ ^= Zobrist::piece(piece, move.to().ep_square());
+            pawn_key_ ^= Zobrist::piece(piece, move.to().ep_square());
+            material_key_ ^= Zobrist::piece(piece, Square(pieces(PieceType::PAWN, ~stm_).count()));
+        }
+
+        key_ ^= Zobrist::sideToMove();
+        stm_ = ~stm_;
+    }
+
+    void unmakeMove(const Move move) {
+        assert(size_ > 0);
+        const auto &prev = states_[--size_];
+
+        info_  = prev.info;
+        ep_sq_ = prev.enpassant;
+        cr_    = prev.castling;
+        hfm_   = prev.half_moves;
+        key_   = prev.hash;
+        stm_   = ~stm_;
+        plies_--;
+
+        pawn_key_     = prev.pawn_key;
+        material_key_ = prev.material_key;
+
+        if (move.typeOf() == Move::CASTLING) {
+            const bool king_side = move.to() > move.from();
+
+            const auto rook_from_sq = Square(king_side ? File::FILE_F : File::FILE_D, move.from().rank());
+            const auto king_to_sq   = Square(king_side ? File::FILE_G : File::FILE_C, move.from().rank());
+
+            const auto rook = at(rook_from_sq);
+            const auto king = at(king_to_sq);
+
+            removePiece(rook, rook_from_sq);
+            removePiece(king, king_to_sq);
+
+            placePiece(king, move.from());
+            placePiece(rook, move.to());
+            return;
+        }
+
+        if (move.typeOf() == Move::PROMOTION) {
+            removePiece(at(move.to()), move.to());
+            placePiece(Piece(PieceType::PAWN, stm_), move.from());
+        } else {
+            const auto piece = at(move.to());
+
+            removePiece(piece, move.to());
+            placePiece(piece, move.from());
+        }
+
+        if (move.typeOf() == Move::ENPASSANT) {
+            placePiece(Piece(PieceType::PAWN, ~stm_), move.to().ep_square());
+        } else if (prev.captured_piece != Piece::NONE) {
+            placePiece(prev.captured_piece, move.to());
+        }
+    }
+
+    /// @brief Make a null move. (Switches the side to move)
+    void makeNullMove() {
+        reserveState();
+        states_[size_++] = State{key_, pawn_key_, material_key_, cr_, ep_sq_, hfm_, Piece::NONE, info_};
+        info_.valid      = 0;
+
+        key_ ^= Zobrist::sideToMove();
+        if (ep_sq_ != Square::underlying::NO_SQ) key_ ^= Zobrist::enpassant(ep_sq_.file());
+        ep_sq_ = Square::underlying::NO_SQ;
+
+        stm_ = ~stm_;
+        plies_++;
+    }
+
+    /// @brief Unmake a null move. (Switches the side to move)
+    void unmakeNullMove() {
+        const auto &prev = states_[--size_];
+
+        info_  = prev.info;
+        ep_sq_ = prev.enpassant;
+        cr_    = prev.castling;
+        hfm_   = prev.half_moves;
+        key_   = prev.hash;
+
+        stm_ = ~stm_;
+        plies_--;
+    }
+
+    [[nodiscard]] Bitboard us(Color color) const { return occ_bb_[color]; }
+    [[nodiscard]] Bitboard them(Color color) const { return us(~color); }
+    [[nodiscard]] Bitboard occ() const { return occ_bb_[0] | occ_bb_[1]; }
+    [[nodiscard]] Bitboard all() const { return occ(); }
+
+    [[nodiscard]] Square kingSq(Color color) const {
+        assert(pieces(PieceType::KING, color) != Bitboard(0));
+        return pieces(PieceType::KING, color).lsb();
+    }
+
+    [[nodiscard]] Bitboard pieces(PieceType type, Color color) const { return pieces_bb_[type] & occ_bb_[color]; }
+    [[nodiscard]] Bitboard pieces(PieceType type) const { return pieces_bb_[type]; }
+
+    template <typename T = Piece>
+    [[nodiscard]] T at(Square sq) const {
+        if constexpr (std::is_same_v<T, PieceType>) {
+            return board_[sq.index()].type();
+        } else {
+            return board_[sq.index()];
+        }
+    }
+
+    /// @brief Checks if a move is a capture, enpassant moves are also considered captures.
+    /// @param move
+    /// @return
+    [[nodiscard]] bool isCapture(const Move move) const {
+        return (at(move.to()) != Piece::NONE && move.typeOf() != Move::CASTLING) || move.typeOf() == Move::ENPASSANT;
+    }
+
+    [[nodiscard]] U64 hash() const { return key_; }
+    [[nodiscard]] U64 pawnKey() const { return pawn_key_; }
+    [[nodiscard]] U64 materialKey() const { return material_key_; }
+    [[nodiscard]] Color sideToMove() const { return stm_; }
+    [[nodiscard]] Square enpassantSq() const { return ep_sq_; }
+    [[nodiscard]] CastlingRights castlingRights() const { return cr_; }
+    [[nodiscard]] std::uint32_t halfMoveClock() const { return hfm_; }
+    [[nodiscard]] std::uint32_t fullMoveNumber() const { return 1 + plies_ / 2; }
+    [[nodiscard]] bool chess960() const { return chess960_; }
+
+    /// @brief Number of moves that can be unmade, at most MaxPly. A full history drops its oldest
+    /// half on the next move.
+    /// @return
+    [[nodiscard]] std::size_t historySize() const { return size_; }
+
+    [[nodiscard]] std::string getCastleString() const {
+        std::string ss;
+
+        for (auto color : {Color::WHITE, Color::BLACK}) {
+            for (auto side : {CastlingRights::Side::KING_SIDE, CastlingRights::Side::QUEEN_SIDE}) {
+                if (!cr_.has(color, side)) continue;
+
+                if (chess960_) {
+                    const auto file = static_cast<std::string>(cr_.getRookFile(color, side))[0];
+                    ss += color == Color::WHITE ? char(std::toupper(file)) : file;
+                } else {
+                    const char c = side == CastlingRights::Side::KING_SIDE ? 'k' : 'q';
+                    ss += color == Color::WHITE ? char(std::toupper(c)) : c;
+                }
+            }
+        }
+
+        return ss;
+    }
+
+    /// @brief Checks if the current position is a repetition, set this to 1 if
+    /// you are writing a chess engine.
+    /// @param count
+    /// @return
+    [[nodiscard]] bool isRepetition(int count = 2) const {
+        uint8_t c = 0;
+
+        for (int i = static_cast<int>(size_) - 2; i >= 0 && i >= static_cast<int>(size_) - hfm_ - 1; i -= 2) {
+            if (states_[i].hash == key_) c++;
+
+            if (c == count) return true;
+        }
+
+        return false;
+    }
+
+    [[nodiscard]] bool isHalfMoveDraw() const { return hfm_ >= 100; }
+
+    /// @brief Only call this function if isHalfMoveDraw() returns true.
+    /// @return
+    [[nodiscard]] std::pair<GameResultReason, GameResult> getHalfMoveDrawType() const {
+        if (inCheck() && !movegen::hasLegalMove(*this)) {
+            return {GameResultReason::CHECKMATE, GameResult::LOSE};
+        }
+
+        return {GameResultReason::FIFTY_MOVE_RULE, GameResult::DRAW};
+    }
+
+    [[nodiscard]] bool isInsufficientMaterial() const {
+        const auto count = occ().count();
+
+        // only kings, draw
+        if (count == 2) return true;
+
+        // only bishop + knight, cant mate
+        if (count == 3) {
+            if (pieces(PieceType::BISHOP) || pieces(PieceType::KNIGHT)) return true;
+        }
+
+        if (count == 4) {
+            const auto white_bishops = pieces(PieceType::BISHOP, Color::WHITE);
+            const auto black_bishops = pieces(PieceType::BISHOP, Color::BLACK);
+
+            // same colored bishops, cant mate
+            if (white_bishops && black_bishops && Square::same_color(white_bishops.lsb(), black_bishops.lsb()))
+                return true;
+
+            // one side with two bishops which have the same color
+            if (white_bishops.count() == 2) {
+                if (Square::same_color(white_bishops.lsb(), white_bishops.msb())) return true;
+            } else if (black_bishops.count() == 2) {
+                if (Square::same_color(black_bishops.lsb(), black_bishops.msb())) return true;
+            }
+        }
+
+        return false;
+    }
+
+    [[nodiscard]] std::pair<GameResultReason, GameResult> isGameOver() const {
+        if (isHalfMoveDraw()) return getHalfMoveDrawType();
+
+        if (isInsufficientMaterial()) return {GameResultReason::INSUFFICIENT_MATERIAL, GameResult::DRAW};
+
+        if (isRepetition()) return {GameResultReason::THREEFOLD_REPETITION, GameResult::DRAW};
+
+        if (!movegen::hasLegalMove(*this)) {
+            if (inCheck()) return {GameResultReason::CHECKMATE, GameResult::LOSE};
+            return {GameResultReason::STALEMATE, GameResult::DRAW};
+        }
+
+        return {GameResultReason::NONE, GameResult::NONE};
+    }
+
+    /// @brief Checks if a square is attacked by the given color.
+    /// @param square
+    /// @param color
+    /// @return
+    [[nodiscard]] bool isAttacked(Square square, Color color) const {
+        // cheap checks first
+        if (attacks::pawn(~color, square) & pieces(PieceType::PAWN, color)) return true;
+        if (attacks::knight(square) & pieces(PieceType::KNIGHT, color)) return true;
+        if (attacks::king(square) & pieces(PieceType::KING, color)) return true;
+
+        const auto queens = pieces(PieceType::QUEEN, color);
+        if (attacks::bishop(square, occ()) & (pieces(PieceType::BISHOP, color) | queens)) return true;
+        if (attacks::rook(square, occ()) & (pieces(PieceType::ROOK, color) | queens)) return true;
+
+        return false;
+    }
+
+    [[nodiscard]] bool inCheck() const { return bool(checkers()); }
+
+    /// @brief Returns the pieces giving check to the side to move.
+    /// @return
+    [[nodiscard]] Bitboard checkers() const { return attackInfo().checkers; }
+
+    /// @brief Returns the pieces of the side to move that are pinned to their king.
+    /// @return
+    [[nodiscard]] Bitboard pinned() const {
+        const auto &info = attackInfo();
+        return (info.pin_hv | info.pin_d) & us(stm_);
+    }
+
+    /// @brief Returns the squares attacked by a color, including squares of its own pieces.
+    /// @param color
+    /// @return
+    [[nodiscard]] Bitboard attackedBy(Color color) const {
+        const auto flag = color == Color::WHITE ? AttackInfo::ATTACKED_WHITE : AttackInfo::ATTACKED_BLACK;
+
+        if (!(info_.valid & flag)) {
+            info_.attacked[color] = color == Color::WHITE ? movegen::seenSquares<Color::WHITE>(*this, occ())
+                                                          : movegen::seenSquares<Color::BLACK>(*this, occ());
+            info_.valid |= flag;
+        }
+
+        return info_.attacked[color];
+    }
+
+    /// @brief Checks if a pseudo-legal move (see movegen::pseudolegalmoves) is legal.
+    /// @param move
+    /// @return
+    [[nodiscard]] bool isLegal(const Move move) const { return movegen::isLegal(*this, move); }
+
+    [[nodiscard]] bool hasNonPawnMaterial(Color color) const {
+        return bool(pieces(PieceType::KNIGHT, color) | pieces(PieceType::BISHOP, color) |
+                    pieces(PieceType::ROOK, color) | pieces(PieceType::QUEEN, color));
+    }
+
+    /// @brief Regenerates the zobrist hash key
+    /// @return
+    [[nodiscard]] U64 zobrist() const {
+        U64 hash_key = 0ULL;
+
+        auto occupied = occ();
+        while (occupied) {
+            const Square sq = occupied.pop();
+            hash_key ^= Zobrist::piece(at(sq), sq);
+        }
+
+        if (ep_sq_ != Square::underlying::NO_SQ) hash_key ^= Zobrist::enpassant(ep_sq_.file());
+        if (stm_ == Color::WHITE) hash_key ^= Zobrist::sideToMove();
+
+        return hash_key ^ Zobrist::castling(cr_.hashIndex());
+    }
+
+   protected:
+    // Hooks for the deriving class, called after the board has been changed.
+    void onPlacePiece(Piece, Square) {}
+    void onRemovePiece(Piece, Square) {}
+    void onSetFen() {}
+
+    void placePiece(Piece piece, Square sq) {
+        assert(board_[sq.index()] == Piece::NONE);
+
+        pieces_bb_[piece.type()].set(sq.index());
+        occ_bb_[piece.color()].set(sq.index());
+        board_[sq.index()] = piece;
+
+        self().onPlacePiece(piece, sq);
+    }
+
+    void removePiece(Piece piece, Square sq) {
+        assert(board_[sq.index()] == piece && piece != Piece::NONE);
+
+        pieces_bb_[piece.type()].clear(sq.index());
+        occ_bb_[piece.color()].clear(sq.index());
+        board_[sq.index()] = Piece::NONE;
+
+        self().onRemovePiece(piece, sq);
+    }
+
+    std::array<Bitboard, 6> pieces_bb_ = {};
+    std::array<Bitboard, 2> occ_bb_    = {};
+    std::array<Piece, 64> board_       = {};
+
+    U64 key_           = 0ULL;
+    U64 pawn_key_      = 0ULL;
+    U64 material_key_  = 0ULL;
+    CastlingRights cr_ = {};
+    uint16_t plies_    = 0;
+    Color stm_         = Color::WHITE;
+    Square ep_sq_      = Square::underlying::NO_SQ;
+    uint8_t hfm_       = 0;
+
+    bool chess960_ = false;
+
+   private:
+    Self &self() { return static_cast<Self &>(*this); }
+
+    friend class movegen;
+
+    const AttackInfo &attackInfo() const {
+        if (!(info_.valid & AttackInfo::CHECKS)) {
+            movegen::checkInfo(*this, info_);
+            info_.valid |= AttackInfo::CHECKS;
+        }
+
+        return info_;
+    }
+
+    // Copies the pieces and the state of a board, without hooks, the history starts out empty.
+    void load(const Board &board) {
+        pieces_bb_.fill(Bitboard(0));
+        occ_bb_.fill(Bitboard(0));
+
+        for (int sq = 0; sq < 64; sq++) {
+            const Piece piece = board.at(Square(sq));
+            board_[sq]        = piece;
+
+            if (piece == Piece::NONE) continue;
+            pieces_bb_[piece.type()].set(sq);
+            occ_bb_[piece.color()].set(sq);
+        }
+
+        key_          = board.hash();
+        pawn_key_     = board.pawnKey();
+        material_key_ = board.materialKey();
+        cr_           = board.castlingRights();
+        stm_          = board.sideToMove();
+        plies_        = (board.fullMoveNumber() - 1) * 2 + (stm_ == Color::BLACK);
+        ep_sq_        = board.enpassantSq();
+        hfm_          = board.halfMoveClock();
+        chess960_     = board.chess960();
+        size_         = 0;
+        info_         = {};
+    }
+
+    void copyFrom(const BasicPosition &other) {
+        pieces_bb_    = other.pieces_bb_;
+        occ_bb_       = other.occ_bb_;
+        board_        = other.board_;
+        key_          = other.key_;
+        pawn_key_     = other.pawn_key_;
+        material_key_ = other.material_key_;
+        cr_           = other.cr_;
+        plies_        = other.plies_;
+        stm_          = other.stm_;
+        ep_sq_        = other.ep_sq_;
+        hfm_          = other.hfm_;
+        chess960_     = other.chess960_;
+        size_         = other.size_;
+        info_         = other.info_;
+
+        // only the part of the history in use
+        std::copy(other.states_.begin(), other.states_.begin() + size_, states_.begin());
+    }
+
+    // Whether the side to move after the double push `move` has a legal enpassant capture,
+    // asked before `move` is made.
+    bool hasLegalEnpassant(const Move move) {
+        const auto piece = at(move.from());
+        const auto pawn  = PieceType(PieceType::PAWN);
+        const auto us    = ~stm_;
+
+        // make the push by hand, without hooks
+        pieces_bb_[pawn].clear(move.from().index()).set(move.to().index());
+        occ_bb_[stm_].clear(move.from().index()).set(move.to().index());
+        board_[move.from().index()] = Piece::NONE;
+        board_[move.to().index()]   = piece;
+        stm_                        = us;
+
+        int double_check = 0;
+        const auto king_sq = kingSq(us);
+        Bitboard checkmask, pin_hv, pin_d;
+
+        if (us == Color::WHITE) {
+            checkmask = movegen::checkMask<Color::WHITE>(*this, king_sq, double_check);
+            pin_hv    = movegen::pinMaskRooks<Color::WHITE>(*this, king_sq, occ_bb_[~us], occ_bb_[us]);
+            pin_d     = movegen::pinMaskBishops<Color::WHITE>(*this, king_sq, occ_bb_[~us], occ_bb_[us]);
+        } else {
+            checkmask = movegen::checkMask<Color::BLACK>(*this, king_sq, double_check);
+            pin_hv    = movegen::pinMaskRooks<Color::BLACK>(*this, king_sq, occ_bb_[~us], occ_bb_[us]);
+            pin_d     = movegen::pinMaskBishops<Color::BLACK>(*this, king_sq, occ_bb_[~us], occ_bb_[us]);
+        }
+
+        const auto pawns_lr = pieces(PieceType::PAWN, us) & ~pin_hv;
+        const auto moves    = movegen::generateEPMove(*this, checkmask, pin_d, pawns_lr, move.to().ep_square(), us);
+
+        // undo
+        stm_ = ~us;
+        pieces_bb_[pawn].clear(move.to().index()).set(move.from().index());
+        occ_bb_[stm_].clear(move.to().index()).set(move.from().index());
+        board_[move.to().index()]   = Piece::NONE;
+        board_[move.from().index()] = piece;
+
+        return moves[0] != Move::NO_MOVE;
+    }
+
+    // Makes room for one more state. A full history keeps only its newest MaxPly / 2 states, as if
+    // the position had been set up from a FEN then: the older moves can't be unmade anymore, but
+    // isRepetition only looks back as far as the 50 move rule allows, which the default keeps.
+    void reserveState() {
+        if (size_ < MaxPly) return;
+
+        const auto keep = MaxPly / 2;
+        std::copy(states_.begin() + (size_ - keep), states_.begin() + size_, states_.begin());
+        size_ = keep;
+    }
+
+    std::array<State, MaxPly> states_;
+    std::size_t size_ = 0;
+
+    // see attackInfo() and attackedBy()
+    mutable AttackInfo info_ = {};
+};
+
+using Position = BasicPosition<>;
+
+}  // namespace chess
+
+#include <sstream>
+
+
+namespace chess {
+class uci {
+   public:
+    /// @brief Longest UCI, SAN or LAN string the formatting functions write, without the terminating null.
+    static constexpr std::size_t MAX_MOVE_LENGTH = 8;
+
+    /// @brief Converts an internal move to a UCI string
+    /// @param move
+    /// @param chess960
+    /// @return
+    [[nodiscard]] static std::string moveToUci(const Move &move, bool chess960 = false) noexcept(false) {
+        std::string uci;
+        writeUci(move, uci, chess960);
+        return uci;
+    }
+
+    /// @brief Appends the UCI string of a move to `str`.
+    /// @param move
+    /// @param str
+    /// @param chess960
+    static void moveToUci(const Move &move, std::string &str, bool chess960 = false) {
+        writeUci(move, str, chess960);
+    }
+
+    /// @brief Writes the null-terminated UCI string of a move to `buffer`, which has to hold
+    /// MAX_MOVE_LENGTH + 1 characters.
+    /// @param move
+    /// @param buffer
+    /// @param chess960
+    /// @return the number of characters written, without the terminating null
+    static std::size_t moveToUci(const Move &move, char *buffer, bool chess960 = false) {
+        BufferWriter writer{buffer};
+        writeUci(move, writer, chess960);
+        return writer.finish(buffer);
+    }
+
+    /// @brief Converts a UCI string to an internal move.
+    /// @param board
+    /// @param uci
+    /// @return
+    [[nodiscard]] static Move uciToMove(const Board &board, const std::string &uci) noexcept(false) {
+        if (uci.length() < 4) {
+            return Move::NO_MOVE;
+        }
+
+        Square source = Square(uci.substr(0, 2));
+        Square target = Square(uci.substr(2, 2));
+
+        if (!source.is_valid() || !target.is_valid()) {
+            return Move::NO_MOVE;
+        }
 
         PieceType piece = board.at(source).type();
 
@@ -4523,20 +5923,59 @@ class uci {
     /// @return
     [[nodiscard]] static std::string moveToSan(const Board &board, const Move &move) noexcept(false) {
         std::string san;
-        moveToRep<false>(board, move, san);
+        Board scratch = board;
+        writeRep<false>(scratch, move, san);
         return san;
     }
 
+    /// @brief Appends the SAN string of a move to `str`. The move is made and unmade on `board`
+    /// for the check and mate suffixes, which leaves it as it was.
+    /// @param board
+    /// @param move
+    /// @param str
+    static void moveToSan(Board &board, const Move &move, std::string &str) { writeRep<false>(board, move, str); }
+
+    /// @brief Writes the null-terminated SAN string of a move to `buffer`, which has to hold
+    /// MAX_MOVE_LENGTH + 1 characters. The move is made and unmade on `board`.
+    /// @param board
+    /// @param move
+    /// @param buffer
+    /// @return the number of characters written, without the terminating null
+    static std::size_t moveToSan(Board &board, const Move &move, char *buffer) {
+        BufferWriter writer{buffer};
+        writeRep<false>(board, move, writer);
+        return writer.finish(buffer);
+    }
+
     /// @brief static a move to a LAN string
     /// @param board
     /// @param move
     /// @return
     [[nodiscard]] static std::string moveToLan(const Board &board, const Move &move) noexcept(false) {
         std::string lan;
-        moveToRep<true>(board, move, lan);
+        Board scratch = board;
+        writeRep<true>(scratch, move, lan);
         return lan;
     }
 
+    /// @brief Appends the LAN string of a move to `str`, see moveToSan(Board &, const Move &, std::string &).
+    /// @param board
+    /// @param move
+    /// @param str
+    static void moveToLan(Board &board, const Move &move, std::string &str) { writeRep<true>(board, move, str); }
+
+    /// @brief Writes the null-terminated LAN string of a move to `buffer`, see
+    /// moveToSan(Board &, const Move &, char *).
+    /// @param board
+    /// @param move
+    /// @param buffer
+    /// @return the number of characters written, without the terminating null
+    static std::size_t moveToLan(Board &board, const Move &move, char *buffer) {
+        BufferWriter writer{buffer};
+        writeRep<true>(board, move, writer);
+        return writer.finish(buffer);
+    }
+
     class SanParseError : public std::exception {
        public:
         explicit SanParseError(const char *message) : msg_(message) {}
@@ -4647,6 +6086,115 @@ class uci {
         throw SanParseError("Failed to parse san. At step 3: " + std::string(san) + " " + board.getFen());
     }
 
+    /// @brief Converts a SAN string to a move like parseSan, but never throws or allocates. Instead of
+    /// generating the legal moves, only the pieces of the parsed type that reach the target square are
+    /// looked at, each checked for leaving its king attacked.
+    /// @param board
+    /// @param san
+    /// @return the move, std::nullopt if the SAN is malformed or no legal move matches it
+    [[nodiscard]] static std::optional<Move> parseSanFast(const Board &board, std::string_view san) noexcept {
+        SanMoveInformation info;
+
+        if (san.empty() || parseSanInfo(san, info)) {
+            return std::nullopt;
+        }
+
+        const auto c = board.sideToMove();
+
+        if (info.castling_short || info.castling_long) {
+            Movelist moves;
+            movegen::legalmoves<movegen::MoveGenType::QUIET>(moves, board, PieceGenType::KING);
+
+            for (const auto &move : moves) {
+                if (move.typeOf() == Move::CASTLING && (move.to() > move.from()) == info.castling_short) {
+                    return move;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        const auto to     = info.to;
+        const auto target = board.at(to);
+        const bool pawn   = info.piece == PieceType::PAWN;
+        const bool ep     = pawn && info.capture && to == board.enpassantSq();
+
+        // a capture needs an enemy piece on the target square, any other move an empty one
+        if (info.capture ? !ep && (target == Piece::NONE || target.color() == c) : target != Piece::NONE) {
+            return std::nullopt;
+        }
+
+        const bool promotion = pawn && Square::back_rank(to, ~c);
+
+        if (info.promotion != PieceType::NONE && !promotion) {
+            return std::nullopt;
+        }
+
+        const auto occ = board.occ();
+        Bitboard from;
+
+        switch (info.piece.internal()) {
+            case PieceType::underlying::PAWN:
+                if (info.capture) {
+                    from = attacks::pawn(~c, to);
+                } else if (!Square::back_rank(to, c)) {
+                    const auto single = Square(to.index() + (c == Color::WHITE ? -8 : 8));
+                    const auto rank   = c == Color::WHITE ? Rank::RANK_4 : Rank::RANK_5;
+
+                    from = Bitboard::fromSquare(single);
+
+                    if (board.at(single) == Piece::NONE && to.rank() == rank) {
+                        from = Bitboard::fromSquare(Square(to.index() + (c == Color::WHITE ? -16 : 16)));
+                    }
+                }
+                break;
+            case PieceType::underlying::KNIGHT:
+                from = attacks::knight(to);
+                break;
+            case PieceType::underlying::BISHOP:
+                from = attacks::bishop(to, occ);
+                break;
+            case PieceType::underlying::ROOK:
+                from = attacks::rook(to, occ);
+                break;
+            case PieceType::underlying::QUEEN:
+                from = attacks::queen(to, occ);
+                break;
+            case PieceType::underlying::KING:
+                from = attacks::king(to);
+                break;
+            default:
+                return std::nullopt;
+        }
+
+        from &= board.pieces(info.piece, c);
+
+        if (info.from_file != File::NO_FILE) from &= Bitboard(info.from_file);
+        if (info.from_rank != Rank::NO_RANK) from &= Bitboard(info.from_rank);
+
+        // the captured piece no longer attacks, and the squares it and the moving piece leave are empty
+        const auto captured = Bitboard::fromSquare(ep ? to.ep_square() : to);
+        const auto king_sq  = board.kingSq(c);
+        const auto occ_to   = (occ | Bitboard::fromSquare(to)) & ~(ep ? captured : Bitboard(0));
+
+        // in the order legalmoves() would have them, a missing promotion piece is a queen like in parseSan
+        while (from) {
+            const auto sq   = Square(from.pop());
+            const auto king = sq == king_sq ? to : king_sq;
+
+            if (movegen::attackers(board, ~c, king, occ_to ^ Bitboard::fromSquare(sq)) & ~captured) continue;
+
+            if (promotion) {
+                return Move::make<Move::PROMOTION>(
+                    sq, to, info.promotion == PieceType::NONE ? PieceType(PieceType::QUEEN) : info.promotion);
+            }
+
+            return ep ? Move::make<Move::ENPASSANT>(sq, to) : Move::make<Move::NORMAL>(sq, to);
+        }
+
+        return std::nullopt;
+    }
+
    private:
     struct SanMoveInformation {
         File from_file = File::NO_FILE;
@@ -4667,10 +6215,20 @@ class uci {
 
     template <bool PEDANTIC = false>
     [[nodiscard]] static SanMoveInformation parseSanInfo(std::string_view san) noexcept(false) {
-        if constexpr (PEDANTIC) {
-            if (san.length() < 2) {
-                throw SanParseError("Failed to parse san. At step 0: " + std::string(san));
-            }
+        SanMoveInformation info;
+
+        if (const auto error = parseSanInfo<PEDANTIC>(san, info)) {
+            throw SanParseError(error + std::string(san));
+        }
+
+        return info;
+    }
+
+    // Fills `info` from the SAN string, returns the start of the error message if it is malformed.
+    template <bool PEDANTIC = false>
+    [[nodiscard]] static const char *parseSanInfo(std::string_view san, SanMoveInformation &info) noexcept {
+        if (san.length() < (PEDANTIC ? 2 : 1)) {
+            return "Failed to parse san. At step 0: ";
         }
 
         constexpr auto parse_castle = [](std::string_view &san, SanMoveInformation &info, char castling_char) {
@@ -4688,14 +6246,15 @@ class uci {
         constexpr auto isRank = [](char c) { return c >= '1' && c <= '8'; };
         constexpr auto isFile = [](char c) { return c >= 'a' && c <= 'h'; };
         constexpr auto sw     = [](const char &c) { return std::string_view(&c, 1); };
-        SanMoveInformation info;
 
         // set to 1 to skip piece type offset
         std::size_t index = 1;
 
         if (san[0] == 'O' || san[0] == '0') {
+            if (san.length() < 3) return "Failed to parse san. At step 0: ";
+
             parse_castle(san, info, san[0]);
-            return info;
+            return nullptr;
         } else if (isFile(san[0])) {
             index--;
             info.piece = PieceType::PAWN;
@@ -4739,11 +6298,12 @@ class uci {
         // promotion
         if (index < san.size() && san[index] == '=') {
             index++;
-            info.promotion = PieceType(sw(san[index]));
+
+            if (index < san.size()) info.promotion = PieceType(sw(san[index]));
 
             if (info.promotion == PieceType::KING || info.promotion == PieceType::PAWN ||
                 info.promotion == PieceType::NONE)
-                throw SanParseError("Failed to parse promotion, during san conversion." + std::string(san));
+                return "Failed to parse promotion, during san conversion.";
 
             index++;
         }
@@ -4758,6 +6318,10 @@ class uci {
             info.from_rank = Rank::NO_RANK;
         }
 
+        if (file_to == File::NO_FILE || rank_to == Rank::NO_RANK) {
+            return "Failed to parse san. At step 1: ";
+        }
+
         // pawns which are not capturing stay on the same file
         if (info.piece == PieceType::PAWN && info.from_file == File::NO_FILE && !info.capture) {
             info.from_file = file_to;
@@ -4769,13 +6333,65 @@ class uci {
             info.from = Square(info.from_file, info.from_rank);
         }
 
-        return info;
+        return nullptr;
+    }
+
+    // Appends to a caller's buffer like std::string::operator+= does, without any bounds checks.
+    struct BufferWriter {
+        char *end;
+
+        BufferWriter &operator+=(char c) {
+            *end++ = c;
+            return *this;
+        }
+
+        std::size_t finish(const char *begin) {
+            *end = '\0';
+            return static_cast<std::size_t>(end - begin);
+        }
+    };
+
+    static constexpr char PIECE_CHARS[] = "PNBRQK";
+
+    template <typename Out>
+    static void writeSquare(Square sq, Out &out) {
+        out += static_cast<char>('a' + static_cast<int>(sq.file()));
+        out += static_cast<char>('1' + static_cast<int>(sq.rank()));
+    }
+
+    template <typename Out>
+    static void writeUci(const Move &move, Out &out, bool chess960) {
+        Square from_sq = move.from();
+        Square to_sq   = move.to();
+
+        // If the move is not a chess960 castling move and is a king moving more than one square,
+        // update the to square to be the correct square for a regular castling move
+        if (!chess960 && move.typeOf() == Move::CASTLING) {
+            to_sq = Square(to_sq > from_sq ? File::FILE_G : File::FILE_C, from_sq.rank());
+        }
+
+        writeSquare(from_sq, out);
+        writeSquare(to_sq, out);
+
+        // If the move is a promotion, add the promoted piece in lower case
+        if (move.typeOf() == Move::PROMOTION) {
+            out += static_cast<char>(PIECE_CHARS[static_cast<int>(move.promotionType())] - 'A' + 'a');
+        }
     }
 
-    template <bool LAN = false>
-    static void moveToRep(Board board, const Move &move, std::string &str) {
+    template <bool LAN, typename Out>
+    static void writeRep(Board &board, const Move &move, Out &str) {
         if (move.typeOf() == Move::CASTLING) {
-            str = move.to() > move.from() ? "O-O" : "O-O-O";
+            str += 'O';
+            str += '-';
+            str += 'O';
+
+            if (move.to() < move.from()) {
+                str += '-';
+                str += 'O';
+            }
+
+            writeCheckSuffix(board, move, str);
             return;
         }
 
@@ -4784,60 +6400,56 @@ class uci {
         assert(pt != PieceType::NONE);
 
         if (pt != PieceType::PAWN) {
-            str += std::toupper(static_cast<std::string>(pt)[0]);
+            str += PIECE_CHARS[static_cast<int>(pt)];
         }
 
         if constexpr (LAN) {
-            str += static_cast<std::string>(move.from().file());
-            str += static_cast<std::string>(move.from().rank());
-        } else {
+            writeSquare(move.from(), str);
+        } else if (pt != PieceType::PAWN) {
+            // only moves of the same piece type can be ambiguous
             Movelist moves;
-            movegen::legalmoves(moves, board);
+            movegen::legalmoves(moves, board, 1 << pt);
 
             for (const auto &m : moves) {
-                // check for ambiguity
-                if (pt != PieceType::PAWN && m != move && board.at(m.from()) == board.at(move.from()) &&
-                    m.to() == move.to()) {
+                if (m != move && m.to() == move.to()) {
                     if (m.from().file() == move.from().file()) {
-                        str += static_cast<std::string>(move.from().rank());
-                        break;
+                        str += static_cast<char>('1' + static_cast<int>(move.from().rank()));
                     } else {
-                        str += static_cast<std::string>(move.from().file());
-                        break;
+                        str += static_cast<char>('a' + static_cast<int>(move.from().file()));
                     }
+
+                    break;
                 }
             }
         }
 
         if (board.at(move.to()) != Piece::NONE || move.typeOf() == Move::ENPASSANT) {
-            if (pt == PieceType::PAWN) {
-                str += static_cast<std::string>(move.from().file());
+            if (pt == PieceType::PAWN && !LAN) {
+                str += static_cast<char>('a' + static_cast<int>(move.from().file()));
             }
 
             str += 'x';
         }
 
-        str += static_cast<std::string>(move.to().file());
-        str += static_cast<std::string>(move.to().rank());
+        writeSquare(move.to(), str);
 
         if (move.typeOf() == Move::PROMOTION) {
-            const auto promotion_pt = static_cast<std::string>(move.promotionType());
-
             str += '=';
-            str += std::toupper(promotion_pt[0]);
+            str += PIECE_CHARS[static_cast<int>(move.promotionType())];
         }
 
+        writeCheckSuffix(board, move, str);
+    }
+
+    template <typename Out>
+    static void writeCheckSuffix(Board &board, const Move &move, Out &str) {
         board.makeMove(move);
 
-        if (!board.inCheck()) {
-            return;
+        if (board.inCheck()) {
+            str += movegen::hasLegalMove(board) ? '+' : '#';
         }
 
-        if (board.isGameOver().second == GameResult::LOSE) {
-            str += '#';
-        } else {
-            str += '+';
-        }
+        board.unmakeMove(move);
     }
 };
 }  // namespace chess
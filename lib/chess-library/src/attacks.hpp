@@ -1,6 +1,5 @@
 #pragma once
 
-#include <functional>
 #include <utility>
 
 #include "attacks_fwd.hpp"
@@ -125,79 +124,39 @@ template <Color::underlying c>
     return atks & occupied;
 }
 
-/// @brief Slow function to calculate bishop attacks
+/// @brief Returns the squares from sq (exclusive) to the edge of the board in a given direction
+/// @tparam direction
 /// @param sq
-/// @param occupied
 /// @return
-[[nodiscard]] inline Bitboard attacks::bishopAttacks(Square sq, Bitboard occupied) {
-    Bitboard attacks = 0ULL;
-
-    int r, f;
-
-    int br = sq.rank();
-    int bf = sq.file();
-
-    for (r = br + 1, f = bf + 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r++, f++) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
-    }
-
-    for (r = br - 1, f = bf + 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r--, f++) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
-    }
-
-    for (r = br + 1, f = bf - 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r++, f--) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
-    }
+template <Direction direction>
+[[nodiscard]] inline constexpr Bitboard attacks::ray(Square sq) noexcept {
+    Bitboard ray;
 
-    for (r = br - 1, f = bf - 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(f)); r--, f--) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
+    for (auto b = shift<direction>(Bitboard::fromSquare(sq.index())); b != 0; b = shift<direction>(b)) {
+        ray |= b;
     }
 
-    return attacks;
+    return ray;
 }
 
-/// @brief Slow function to calculate rook attacks
-/// @param sq
+/// @brief Returns the attacks along four rays, each up to and including its first blocker.
+/// The first two rays have to point towards h8, the last two towards a1.
+/// @param rays
 /// @param occupied
 /// @return
-[[nodiscard]] inline Bitboard attacks::rookAttacks(Square sq, Bitboard occupied) {
-    Bitboard attacks = 0ULL;
-
-    int r, f;
-
-    int rr = sq.rank();
-    int rf = sq.file();
-
-    for (r = rr + 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(rf)); r++) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(rf)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
-    }
+[[nodiscard]] inline Bitboard attacks::rayAttacks(const Bitboard (&rays)[4], Bitboard occupied) noexcept {
+    U64 attacks = 0ULL;
 
-    for (r = rr - 1; Square::is_valid(static_cast<Rank>(r), static_cast<File>(rf)); r--) {
-        auto s = Square(static_cast<Rank>(r), static_cast<File>(rf)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
+    for (int i = 0; i < 2; i++) {
+        // the blocker closest to sq is the lowest one, without one (blockers - 1) keeps the whole ray
+        const U64 blockers = (rays[i] & occupied).getBits();
+        attacks |= rays[i].getBits() & (blockers ^ (blockers - 1));
     }
 
-    for (f = rf + 1; Square::is_valid(static_cast<Rank>(rr), static_cast<File>(f)); f++) {
-        auto s = Square(static_cast<Rank>(rr), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
-    }
-
-    for (f = rf - 1; Square::is_valid(static_cast<Rank>(rr), static_cast<File>(f)); f--) {
-        auto s = Square(static_cast<Rank>(rr), static_cast<File>(f)).index();
-        attacks.set(s);
-        if (occupied.check(s)) break;
+    for (int i = 2; i < 4; i++) {
+        // the blocker closest to sq is the highest one, a1 stands in for it when there is none
+        const U64 blockers = (rays[i] & occupied).getBits() | 1ULL;
+        attacks |= rays[i].getBits() & ~((1ULL << Bitboard(blockers).msb()) - 1);
     }
 
     return attacks;
@@ -207,9 +166,8 @@ template <Color::underlying c>
 /// @param sq
 /// @param table
 /// @param magic
-/// @param attacks
-inline void attacks::initSliders(Square sq, Magic table[], U64 magic,
-                                 const std::function<Bitboard(Square, Bitboard)> &attacks) {
+/// @param rays
+inline void attacks::initSliders(Square sq, Magic table[], U64 magic, const Bitboard (&rays)[4]) {
     // The edges of the board are not considered for the attacks
     // i.e. for the sq h7 edges will be a1-h1, a1-a8, a8-h8, ignoring the edge of the current square
     const Bitboard edges = ((Bitboard(Rank::RANK_1) | Bitboard(Rank::RANK_8)) & ~Bitboard(sq.rank())) |
@@ -220,7 +178,7 @@ inline void attacks::initSliders(Square sq, Magic table[], U64 magic,
     auto &table_sq = table[sq.index()];
 
     table_sq.magic = magic;
-    table_sq.mask  = (attacks(sq, occ) & ~edges).getBits();
+    table_sq.mask  = (rayAttacks(rays, occ) & ~edges).getBits();
     table_sq.shift = 64 - Bitboard(table_sq.mask).count();
 
     if (sq < 64 - 1) {
@@ -228,7 +186,7 @@ inline void attacks::initSliders(Square sq, Magic table[], U64 magic,
     }
 
     do {
-        table_sq.attacks[table_sq(occ)] = attacks(sq, occ);
+        table_sq.attacks[table_sq(occ)] = rayAttacks(rays, occ);
         occ                             = (occ - table_sq.mask) & table_sq.mask;
     } while (occ);
 }
@@ -240,8 +198,20 @@ inline void attacks::initAttacks() {
     RookTable[0].attacks   = RookAttacks;
 
     for (int i = 0; i < 64; i++) {
-        initSliders(static_cast<Square>(i), BishopTable, BishopMagics[i], bishopAttacks);
-        initSliders(static_cast<Square>(i), RookTable, RookMagics[i], rookAttacks);
+        const auto sq = static_cast<Square>(i);
+
+        const Bitboard bishop_rays[4] = {ray<Direction::NORTH_EAST>(sq), ray<Direction::NORTH_WEST>(sq),
+                                         ray<Direction::SOUTH_EAST>(sq), ray<Direction::SOUTH_WEST>(sq)};
+        const Bitboard rook_rays[4]   = {ray<Direction::NORTH>(sq), ray<Direction::EAST>(sq),
+                                         ray<Direction::SOUTH>(sq), ray<Direction::WEST>(sq)};
+
+        initSliders(sq, BishopTable, BishopMagics[i], bishop_rays);
+        initSliders(sq, RookTable, RookMagics[i], rook_rays);
     }
 }
+
+inline const bool attacks::SlidersInitialized = [] {
+    initAttacks();
+    return true;
+}();
 }  // namespace chess
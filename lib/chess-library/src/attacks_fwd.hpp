@@ -1,7 +1,16 @@
 #pragma once
 
 #include <cstdint>
-#include <functional>
+
+// Slider attacks are indexed with BMI2 PEXT instead of the magic multiplication when the target
+// has it, e.g. -march=native on Haswell, Zen 3 or newer. Both index the same tables. Define
+// CHESS_NO_PEXT to keep the magics, PEXT is microcoded and slow on Zen 1 and Zen 2.
+#if defined(__BMI2__) && !defined(CHESS_NO_PEXT)
+#    include <immintrin.h>
+#    define CHESS_USE_PEXT 1
+#else
+#    define CHESS_USE_PEXT 0
+#endif
 
 #include "bitboard.hpp"
 #include "board_fwd.hpp"
@@ -17,28 +26,35 @@ class attacks {
         Bitboard *attacks;
         U64 shift;
 
-        U64 operator()(Bitboard b) const { return (((b & mask)).getBits() * magic) >> shift; }
+        U64 operator()(Bitboard b) const {
+#if CHESS_USE_PEXT
+            return _pext_u64(b.getBits(), mask);
+#else
+            return (((b & mask)).getBits() * magic) >> shift;
+#endif
+        }
     };
 
-    /// @brief Slow function to calculate bishop attacks
+    /// @brief Returns the squares from sq (exclusive) to the edge of the board in a given direction
+    /// @tparam direction
     /// @param sq
-    /// @param occupied
     /// @return
-    [[nodiscard]] static Bitboard bishopAttacks(Square sq, Bitboard occupied);
+    template <Direction direction>
+    [[nodiscard]] static constexpr Bitboard ray(Square sq) noexcept;
 
-    /// @brief Slow function to calculate rook attacks
-    /// @param sq
+    /// @brief Returns the attacks along four rays, each up to and including its first blocker.
+    /// The first two rays have to point towards h8, the last two towards a1.
+    /// @param rays
     /// @param occupied
     /// @return
-    [[nodiscard]] static Bitboard rookAttacks(Square sq, Bitboard occupied);
+    [[nodiscard]] static Bitboard rayAttacks(const Bitboard (&rays)[4], Bitboard occupied) noexcept;
 
     /// @brief Initializes the magic bitboard tables for sliding pieces
     /// @param sq
     /// @param table
     /// @param magic
-    /// @param attacks
-    static void initSliders(Square sq, Magic table[], U64 magic,
-                            const std::function<Bitboard(Square, Bitboard)> &attacks);
+    /// @param rays
+    static void initSliders(Square sq, Magic table[], U64 magic, const Bitboard (&rays)[4]);
 
     // clang-format off
     // pre-calculated lookup table for pawn attacks
@@ -232,5 +248,8 @@ class attacks {
     /// @brief [Internal Usage] Initializes the attacks for the bishop and rook. Called once at
     /// startup.
     static inline void initAttacks();
+
+   private:
+    static const bool SlidersInitialized;
 };
 }  // namespace chess
@@ -95,21 +95,43 @@ class Board {
         std::array<std::array<File, 2>, 2> rooks;
     };
 
+    /// @brief Checkers, pins and attacked squares of a position. Each part is computed on first use
+    /// and saved with the position's state, so unmakeMove() restores it instead of recomputing it.
+    struct AttackInfo {
+        enum Valid : std::uint8_t { CHECKS = 1, ATTACKED_WHITE = 2, ATTACKED_BLACK = 4 };
+
+        // pieces giving check to the side to move
+        Bitboard checkers;
+        // rays between the king of the side to move and the enemy sliders pinning a piece to it
+        Bitboard pin_hv;
+        Bitboard pin_d;
+        // squares attacked by each color
+        std::array<Bitboard, 2> attacked;
+
+        std::uint8_t valid = 0;
+    };
+
    private:
     struct State {
         U64 hash;
+        U64 pawn_key;
+        U64 material_key;
         CastlingRights castling;
         Square enpassant;
         uint8_t half_moves;
         Piece captured_piece;
+        AttackInfo info;
 
-        State(const U64 &hash, const CastlingRights &castling, const Square &enpassant, const uint8_t &half_moves,
-              const Piece &captured_piece)
+        State(const U64 &hash, const U64 &pawn_key, const U64 &material_key, const CastlingRights &castling,
+              const Square &enpassant, const uint8_t &half_moves, const Piece &captured_piece, const AttackInfo &info)
             : hash(hash),
+              pawn_key(pawn_key),
+              material_key(material_key),
               castling(castling),
               enpassant(enpassant),
               half_moves(half_moves),
-              captured_piece(captured_piece) {}
+              captured_piece(captured_piece),
+              info(info) {}
     };
 
     enum class PrivateCtor { CREATE };
@@ -268,7 +290,8 @@ class Board {
         // Validate side to move
         assert((at(move.from()) < Piece::BLACKPAWN) == (stm_ == Color::WHITE));
 
-        prev_states_.emplace_back(key_, cr_, ep_sq_, hfm_, captured);
+        prev_states_.emplace_back(key_, pawn_key_, material_key_, cr_, ep_sq_, hfm_, captured, info_);
+        info_.valid = 0;
 
         hfm_++;
         plies_++;
@@ -281,6 +304,9 @@ class Board {
 
             hfm_ = 0;
             key_ ^= Zobrist::piece(captured, move.to());
+            material_key_ ^= Zobrist::piece(captured, Square(pieces(captured.type(), ~stm_).count()));
+
+            if (captured.type() == PieceType::PAWN) pawn_key_ ^= Zobrist::piece(captured, move.to());
 
             // remove castling rights if rook is captured
             if (captured.type() == PieceType::ROOK && Rank::back_rank(move.to().rank(), ~stm_)) {
@@ -405,6 +431,9 @@ class Board {
             placePiece(piece_prom, move.to());
 
             key_ ^= Zobrist::piece(piece_pawn, move.from()) ^ Zobrist::piece(piece_prom, move.to());
+            pawn_key_ ^= Zobrist::piece(piece_pawn, move.from());
+            material_key_ ^= Zobrist::piece(piece_pawn, Square(pieces(PieceType::PAWN, stm_).count())) ^
+                             Zobrist::piece(piece_prom, Square(pieces(piece_prom.type(), stm_).count() - 1));
         } else {
             assert(at(move.from()) != Piece::NONE);
             assert(at(move.to()) == Piece::NONE);
@@ -415,6 +444,10 @@ class Board {
             placePiece(piece, move.to());
 
             key_ ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, move.to());
+
+            if (pt == PieceType::PAWN) {
+                pawn_key_ ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, move.to());
+            }
         }
 
         if (move.typeOf() == Move::ENPASSANT) {
@@ -425,6 +458,8 @@ class Board {
             removePiece(piece, move.to().ep_square());
 
             key_ ^= Zobrist::piece(piece, move.to().ep_square());
+            pawn_key_ ^= Zobrist::piece(piece, move.to().ep_square());
+            material_key_ ^= Zobrist::piece(piece, Square(pieces(PieceType::PAWN, ~stm_).count()));
         }
 
         key_ ^= Zobrist::sideToMove();
@@ -432,15 +467,22 @@ class Board {
     }
 
     void unmakeMove(const Move move) {
-        const auto prev = prev_states_.back();
-        prev_states_.pop_back();
+        const auto &prev = prev_states_.back();
 
+        info_  = prev.info;
         ep_sq_ = prev.enpassant;
         cr_    = prev.castling;
         hfm_   = prev.half_moves;
         stm_   = ~stm_;
         plies_--;
 
+        pawn_key_     = prev.pawn_key;
+        material_key_ = prev.material_key;
+
+        const auto hash     = prev.hash;
+        const auto captured = prev.captured_piece;
+        prev_states_.pop_back();
+
         if (move.typeOf() == Move::CASTLING) {
             const bool king_side = move.to() > move.from();
 
@@ -462,7 +504,7 @@ class Board {
             placePiece(king, move.from());
             placePiece(rook, move.to());
 
-            key_ = prev.hash;
+            key_ = hash;
 
             return;
         } else if (move.typeOf() == Move::PROMOTION) {
@@ -476,12 +518,12 @@ class Board {
             removePiece(piece, move.to());
             placePiece(pawn, move.from());
 
-            if (prev.captured_piece != Piece::NONE) {
+            if (captured != Piece::NONE) {
                 assert(at(move.to()) == Piece::NONE);
-                placePiece(prev.captured_piece, move.to());
+                placePiece(captured, move.to());
             }
 
-            key_ = prev.hash;
+            key_ = hash;
             return;
         } else {
             assert(at(move.to()) != Piece::NONE);
@@ -499,17 +541,18 @@ class Board {
 
             assert(at(pawnTo) == Piece::NONE);
             placePiece(pawn, pawnTo);
-        } else if (prev.captured_piece != Piece::NONE) {
+        } else if (captured != Piece::NONE) {
             assert(at(move.to()) == Piece::NONE);
-            placePiece(prev.captured_piece, move.to());
+            placePiece(captured, move.to());
         }
 
-        key_ = prev.hash;
+        key_ = hash;
     }
 
     /// @brief Make a null move. (Switches the side to move)
     void makeNullMove() {
-        prev_states_.emplace_back(key_, cr_, ep_sq_, hfm_, Piece::NONE);
+        prev_states_.emplace_back(key_, pawn_key_, material_key_, cr_, ep_sq_, hfm_, Piece::NONE, info_);
+        info_.valid = 0;
 
         key_ ^= Zobrist::sideToMove();
         if (ep_sq_ != Square::underlying::NO_SQ) key_ ^= Zobrist::enpassant(ep_sq_.file());
@@ -524,6 +567,7 @@ class Board {
     void unmakeNullMove() {
         const auto &prev = prev_states_.back();
 
+        info_  = prev.info;
         ep_sq_ = prev.enpassant;
         cr_    = prev.castling;
         hfm_   = prev.half_moves;
@@ -600,6 +644,15 @@ class Board {
     /// @brief Get the current hash key of the board
     /// @return
     [[nodiscard]] U64 hash() const { return key_; }
+
+    /// @brief Get the zobrist key of the pawns only, for pawn structure tables
+    /// @return
+    [[nodiscard]] U64 pawnKey() const { return pawn_key_; }
+
+    /// @brief Get a key of the number of pieces of each kind, wherever they stand, for material
+    /// and endgame tables
+    /// @return
+    [[nodiscard]] U64 materialKey() const { return material_key_; }
     [[nodiscard]] Color sideToMove() const { return stm_; }
     [[nodiscard]] Square enpassantSq() const { return ep_sq_; }
     [[nodiscard]] CastlingRights castlingRights() const { return cr_; }
@@ -675,10 +728,7 @@ class Board {
     /// @brief Only call this function if isHalfMoveDraw() returns true.
     /// @return
     [[nodiscard]] std::pair<GameResultReason, GameResult> getHalfMoveDrawType() const {
-        Movelist movelist;
-        movegen::legalmoves(movelist, *this);
-
-        if (movelist.empty() && inCheck()) {
+        if (inCheck() && !movegen::hasLegalMove(*this)) {
             return {GameResultReason::CHECKMATE, GameResult::LOSE};
         }
 
@@ -721,7 +771,7 @@ class Board {
     }
 
     /// @brief Checks if the game is over. Returns GameResultReason::NONE if
-    /// the game is not over. This function calculates all legal moves for the
+    /// the game is not over. This function looks for a legal move in the
     /// current position to
     /// check if the game is over. If you are writing you should not use this
     /// function.
@@ -735,10 +785,7 @@ class Board {
 
         if (isRepetition()) return {GameResultReason::THREEFOLD_REPETITION, GameResult::DRAW};
 
-        Movelist movelist;
-        movegen::legalmoves(movelist, *this);
-
-        if (movelist.empty()) {
+        if (!movegen::hasLegalMove(*this)) {
             if (inCheck()) return {GameResultReason::CHECKMATE, GameResult::LOSE};
             return {GameResultReason::STALEMATE, GameResult::DRAW};
         }
@@ -767,7 +814,43 @@ class Board {
 
     /// @brief Checks if the current side to move is in check
     /// @return
-    [[nodiscard]] bool inCheck() const { return isAttacked(kingSq(stm_), ~stm_); }
+    [[nodiscard]] bool inCheck() const { return bool(checkers()); }
+
+    /// @brief Returns the pieces giving check to the side to move.
+    /// Computed on first use after the position changed.
+    /// @return
+    [[nodiscard]] Bitboard checkers() const { return attackInfo().checkers; }
+
+    /// @brief Returns the pieces of the side to move that are pinned to their king.
+    /// Computed on first use after the position changed.
+    /// @return
+    [[nodiscard]] Bitboard pinned() const {
+        const auto &info = attackInfo();
+        return (info.pin_hv | info.pin_d) & us(stm_);
+    }
+
+    /// @brief Returns the squares attacked by a color, including squares of its own pieces.
+    /// Computed on first use after the position changed.
+    /// @param color
+    /// @return
+    [[nodiscard]] Bitboard attackedBy(Color color) const {
+        const auto flag = color == Color::WHITE ? AttackInfo::ATTACKED_WHITE : AttackInfo::ATTACKED_BLACK;
+
+        if (!(info_.valid & flag)) {
+            info_.attacked[color] = color == Color::WHITE ? movegen::seenSquares<Color::WHITE>(*this, occ())
+                                                          : movegen::seenSquares<Color::BLACK>(*this, occ());
+            info_.valid |= flag;
+        }
+
+        return info_.attacked[color];
+    }
+
+    /// @brief Checks if a pseudo-legal move (see movegen::pseudolegalmoves) is legal.
+    /// Only moves of the king, of pinned pieces, en passant and moves while in check need more
+    /// than a look at the cached pins.
+    /// @param move
+    /// @return
+    [[nodiscard]] bool isLegal(const Move move) const { return movegen::isLegal(*this, move); }
 
     /// @brief Checks if the given color has at least 1 piece thats not pawn and not king
     /// @return
@@ -1047,6 +1130,7 @@ class Board {
             }
 
             board.key_ = board.zobrist();
+            board.initPieceKeys();
         }
 
         // 1:1 mapping of Piece::internal() to the compressed piece
@@ -1126,6 +1210,8 @@ class Board {
     std::array<Piece, 64> board_       = {};
 
     U64 key_           = 0ULL;
+    U64 pawn_key_      = 0ULL;
+    U64 material_key_  = 0ULL;
     CastlingRights cr_ = {};
     uint16_t plies_    = 0;
     Color stm_         = Color::WHITE;
@@ -1134,11 +1220,26 @@ class Board {
 
     bool chess960_ = false;
 
+    // see attackInfo() and attackedBy()
+    mutable AttackInfo info_ = {};
+
    private:
+    friend class movegen;
+
+    const AttackInfo &attackInfo() const {
+        if (!(info_.valid & AttackInfo::CHECKS)) {
+            movegen::checkInfo(*this, info_);
+            info_.valid |= AttackInfo::CHECKS;
+        }
+
+        return info_;
+    }
+
     /// @brief [Internal Usage]
     /// @param fen
     void setFenInternal(std::string_view fen) {
         original_fen_ = fen;
+        info_         = {};
 
         occ_bb_.fill(0ULL);
         pieces_bb_.fill(0ULL);
@@ -1258,6 +1359,28 @@ class Board {
         key_ ^= Zobrist::castling(cr_.hashIndex());
 
         assert(key_ == zobrist());
+
+        initPieceKeys();
+    }
+
+    /// @brief [Internal Usage] Regenerates the pawn and material keys from the pieces on the board.
+    void initPieceKeys() {
+        pawn_key_     = 0ULL;
+        material_key_ = 0ULL;
+
+        auto pawns = pieces(PieceType::PAWN);
+        while (pawns) {
+            const auto sq = pawns.pop();
+            pawn_key_ ^= Zobrist::piece(at(sq), sq);
+        }
+
+        // the n-th piece of a kind adds the key of square n
+        for (int p = 0; p < 12; p++) {
+            const auto piece = Piece(static_cast<Piece::underlying>(p));
+            const auto count = pieces(piece.type(), piece.color()).count();
+
+            for (int n = 0; n < count; n++) material_key_ ^= Zobrist::piece(piece, Square(n));
+        }
     }
 
     template <int N>
@@ -45,6 +45,7 @@ VERSION: 0.6.66
 #include "movelist.hpp"
 #include "pgn.hpp"
 #include "piece.hpp"
+#include "position.hpp"
 #include "uci.hpp"
 #include "utils.hpp"
 #include "zobrist.hpp"
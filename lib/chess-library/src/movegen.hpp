@@ -10,19 +10,21 @@
 
 namespace chess {
 
-inline auto movegen::init_squares_between() {
+inline constexpr std::array<std::array<Bitboard, 64>, 64> movegen::init_squares_between() {
     std::array<std::array<Bitboard, 64>, 64> squares_between_bb{};
-    Bitboard sqs = 0;
-
-    for (Square sq1 = 0; sq1 < 64; ++sq1) {
-        for (Square sq2 = 0; sq2 < 64; ++sq2) {
-            sqs = Bitboard::fromSquare(sq1) | Bitboard::fromSquare(sq2);
-            if (sq1 == sq2)
-                squares_between_bb[sq1.index()][sq2.index()].clear();
-            else if (sq1.file() == sq2.file() || sq1.rank() == sq2.rank())
-                squares_between_bb[sq1.index()][sq2.index()] = attacks::rook(sq1, sqs) & attacks::rook(sq2, sqs);
-            else if (sq1.diagonal_of() == sq2.diagonal_of() || sq1.antidiagonal_of() == sq2.antidiagonal_of())
-                squares_between_bb[sq1.index()][sq2.index()] = attacks::bishop(sq1, sqs) & attacks::bishop(sq2, sqs);
+
+    // file and rank steps of the eight directions
+    constexpr int steps[8][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+    for (int sq = 0; sq < 64; ++sq) {
+        for (const auto &step : steps) {
+            Bitboard between = 0;
+
+            for (int f = sq % 8 + step[0], r = sq / 8 + step[1]; f >= 0 && f < 8 && r >= 0 && r < 8;
+                 f += step[0], r += step[1]) {
+                squares_between_bb[sq][r * 8 + f] = between;
+                between.set(r * 8 + f);
+            }
         }
     }
 
@@ -36,8 +38,8 @@ inline auto movegen::init_squares_between() {
 /// @param sq
 /// @param double_check
 /// @return
-template <Color::underlying c>
-[[nodiscard]] inline Bitboard movegen::checkMask(const Board &board, Square sq, int &double_check) {
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline Bitboard movegen::checkMask(const BoardType &board, Square sq, int &double_check) {
     double_check = 0;
 
     const auto opp_knight = board.pieces(PieceType::KNIGHT, ~c);
@@ -96,8 +98,8 @@ template <Color::underlying c>
 /// @param occ_opp
 /// @param occ_us
 /// @return
-template <Color::underlying c>
-[[nodiscard]] inline Bitboard movegen::pinMaskRooks(const Board &board, Square sq, Bitboard occ_opp, Bitboard occ_us) {
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline Bitboard movegen::pinMaskRooks(const BoardType &board, Square sq, Bitboard occ_opp, Bitboard occ_us) {
     const auto opp_rook  = board.pieces(PieceType::ROOK, ~c);
     const auto opp_queen = board.pieces(PieceType::QUEEN, ~c);
 
@@ -122,8 +124,8 @@ template <Color::underlying c>
 /// @param occ_opp
 /// @param occ_us
 /// @return
-template <Color::underlying c>
-[[nodiscard]] inline Bitboard movegen::pinMaskBishops(const Board &board, Square sq, Bitboard occ_opp,
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline Bitboard movegen::pinMaskBishops(const BoardType &board, Square sq, Bitboard occ_opp,
                                                       Bitboard occ_us) {
     const auto opp_bishop = board.pieces(PieceType::BISHOP, ~c);
     const auto opp_queen  = board.pieces(PieceType::QUEEN, ~c);
@@ -141,21 +143,13 @@ template <Color::underlying c>
     return pin_diag;
 }
 
-/// @brief Returns the squares that are attacked by the enemy
+/// @brief Returns the squares that are attacked by color c
 /// @tparam c
 /// @param board
-/// @param enemy_empty
+/// @param occupied Occupancy the sliders see
 /// @return
-template <Color::underlying c>
-[[nodiscard]] inline Bitboard movegen::seenSquares(const Board &board, Bitboard enemy_empty) {
-    auto king_sq          = board.kingSq(~c);
-    Bitboard map_king_atk = attacks::king(king_sq) & enemy_empty;
-
-    if (map_king_atk == Bitboard(0ull) && !board.chess960()) {
-        return 0ull;
-    }
-
-    auto occ     = board.occ() & ~Bitboard::fromSquare(king_sq);
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline Bitboard movegen::seenSquares(const BoardType &board, Bitboard occupied) {
     auto queens  = board.pieces(PieceType::QUEEN, c);
     auto pawns   = board.pieces(PieceType::PAWN, c);
     auto knights = board.pieces(PieceType::KNIGHT, c);
@@ -171,12 +165,12 @@ template <Color::underlying c>
 
     while (bishops) {
         const auto index = bishops.pop();
-        seen |= attacks::bishop(index, occ);
+        seen |= attacks::bishop(index, occupied);
     }
 
     while (rooks) {
         const auto index = rooks.pop();
-        seen |= attacks::rook(index, occ);
+        seen |= attacks::rook(index, occupied);
     }
 
     const Square index = board.kingSq(c);
@@ -185,26 +179,18 @@ template <Color::underlying c>
     return seen;
 }
 
-/// @brief Generate pawn moves.
+/// @brief Generate the destination squares of the pawn moves.
 /// @tparam c
-/// @tparam mt
 /// @param board
-/// @param moves
 /// @param pin_d
 /// @param pin_hv
 /// @param checkmask
 /// @param occ_opp
-template <Color::underlying c, movegen::MoveGenType mt>
-inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitboard pin_d, Bitboard pin_hv,
-                                       Bitboard checkmask, Bitboard occ_opp) {
+/// @return
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline movegen::PawnTargets movegen::pawnTargets(const BoardType &board, Bitboard pin_d, Bitboard pin_hv,
+                                                               Bitboard checkmask, Bitboard occ_opp) {
     constexpr Direction UP              = c == Color::WHITE ? Direction::NORTH : Direction::SOUTH;
-    constexpr Direction DOWN            = c == Color::WHITE ? Direction::SOUTH : Direction::NORTH;
-    constexpr Direction DOWN_LEFT       = c == Color::WHITE ? Direction::SOUTH_WEST : Direction::NORTH_EAST;
-    constexpr Direction DOWN_RIGHT      = c == Color::WHITE ? Direction::SOUTH_EAST : Direction::NORTH_WEST;
-    constexpr Bitboard RANK_B_PROMO     = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_7)]
-                                                            : attacks::MASK_RANK[static_cast<int>(Rank::RANK_2)];
-    constexpr Bitboard RANK_PROMO       = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_8)]
-                                                            : attacks::MASK_RANK[static_cast<int>(Rank::RANK_1)];
     constexpr Bitboard DOUBLE_PUSH_RANK = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_3)]
                                                             : attacks::MASK_RANK[static_cast<int>(Rank::RANK_6)];
 
@@ -242,6 +228,37 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
                             (attacks::shift<UP>(single_push_pinned & DOUBLE_PUSH_RANK) & ~board.occ())) &
                            checkmask;
 
+    return {l_pawns, r_pawns, single_push, double_push, pawns_lr};
+}
+
+/// @brief Generate pawn moves.
+/// @tparam c
+/// @tparam mt
+/// @param board
+/// @param moves
+/// @param pin_d
+/// @param pin_hv
+/// @param checkmask
+/// @param occ_opp
+template <Color::underlying c, movegen::MoveGenType mt, typename BoardType>
+inline void movegen::generatePawnMoves(const BoardType &board, Movelist &moves, Bitboard pin_d, Bitboard pin_hv,
+                                       Bitboard checkmask, Bitboard occ_opp) {
+    constexpr Direction DOWN        = c == Color::WHITE ? Direction::SOUTH : Direction::NORTH;
+    constexpr Direction DOWN_LEFT   = c == Color::WHITE ? Direction::SOUTH_WEST : Direction::NORTH_EAST;
+    constexpr Direction DOWN_RIGHT  = c == Color::WHITE ? Direction::SOUTH_EAST : Direction::NORTH_WEST;
+    constexpr Bitboard RANK_B_PROMO = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_7)]
+                                                        : attacks::MASK_RANK[static_cast<int>(Rank::RANK_2)];
+    constexpr Bitboard RANK_PROMO   = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_8)]
+                                                        : attacks::MASK_RANK[static_cast<int>(Rank::RANK_1)];
+
+    const auto pawns   = board.pieces(PieceType::PAWN, c);
+    const auto targets = pawnTargets<c>(board, pin_d, pin_hv, checkmask, occ_opp);
+
+    Bitboard l_pawns     = targets.left;
+    Bitboard r_pawns     = targets.right;
+    Bitboard single_push = targets.single_push;
+    Bitboard double_push = targets.double_push;
+
     if (pawns & RANK_B_PROMO) {
         Bitboard promo_left  = l_pawns & RANK_PROMO;
         Bitboard promo_right = r_pawns & RANK_PROMO;
@@ -304,7 +321,7 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
 
     const Square ep = board.enpassantSq();
     if (mt != MoveGenType::QUIET && ep != Square::underlying::NO_SQ) {
-        auto m = generateEPMove(board, checkmask, pin_d, pawns_lr, ep, c);
+        auto m = generateEPMove(board, checkmask, pin_d, targets.pawns_lr, ep, c);
 
         for (const auto &move : m) {
             if (move != Move::NO_MOVE) moves.add(move);
@@ -312,7 +329,8 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
     }
 }
 
-[[nodiscard]] inline std::array<Move, 2> movegen::generateEPMove(const Board &board, Bitboard checkmask, Bitboard pin_d,
+template <typename BoardType>
+[[nodiscard]] inline std::array<Move, 2> movegen::generateEPMove(const BoardType &board, Bitboard checkmask, Bitboard pin_d,
                                                                  Bitboard pawns_lr, Square ep, Color c) {
     assert((ep.rank() == Rank::RANK_3 && board.sideToMove() == Color::BLACK) ||
            (ep.rank() == Rank::RANK_6 && board.sideToMove() == Color::WHITE));
@@ -437,8 +455,8 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
 /// @param seen
 /// @param pin_hv
 /// @return
-template <Color::underlying c, movegen::MoveGenType mt>
-[[nodiscard]] inline Bitboard movegen::generateCastleMoves(const Board &board, Square sq, Bitboard seen,
+template <Color::underlying c, movegen::MoveGenType mt, typename BoardType>
+[[nodiscard]] inline Bitboard movegen::generateCastleMoves(const BoardType &board, Square sq, Bitboard seen,
                                                            Bitboard pin_hv) {
     if constexpr (mt == MoveGenType::CAPTURE) return 0ull;
     const auto rights = board.castlingRights();
@@ -489,8 +507,8 @@ inline void movegen::whileBitboardAdd(Movelist &movelist, Bitboard mask, T func)
 /// @tparam mt
 /// @param movelist
 /// @param board
-template <Color::underlying c, movegen::MoveGenType mt>
-inline void movegen::legalmoves(Movelist &movelist, const Board &board, int pieces) {
+template <Color::underlying c, movegen::MoveGenType mt, typename BoardType>
+inline void movegen::legalmoves(Movelist &movelist, const BoardType &board, int pieces) {
     /*
      The size of the movelist might not
      be 0! This is done on purpose since it enables
@@ -498,19 +516,27 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
     */
     auto king_sq = board.kingSq(c);
 
-    int double_check = 0;
-
     Bitboard occ_us  = board.us(c);
     Bitboard occ_opp = board.us(~c);
     Bitboard occ_all = occ_us | occ_opp;
 
     Bitboard opp_empty = ~occ_us;
 
-    Bitboard check_mask = checkMask<c>(board, king_sq, double_check);
-    Bitboard pin_hv     = pinMaskRooks<c>(board, king_sq, occ_opp, occ_us);
-    Bitboard pin_d      = pinMaskBishops<c>(board, king_sq, occ_opp, occ_us);
+    // checkers and pins are cached by the board, so unmakeMove() gets them back for free
+    const auto &info = board.attackInfo();
+
+    Bitboard check_mask = constants::DEFAULT_CHECKMASK;
+    Bitboard pin_hv     = info.pin_hv;
+    Bitboard pin_d      = info.pin_d;
 
-    assert(double_check <= 2);
+    const int double_check = std::min(info.checkers.count(), 2);
+
+    if (double_check == 1) {
+        const auto index = info.checkers.lsb();
+        check_mask       = SQUARES_BETWEEN_BB[king_sq.index()][index] | info.checkers;
+    } else if (double_check == 2) {
+        check_mask = 0;
+    }
 
     // Moves have to be on the checkmask
     Bitboard movable_square;
@@ -524,7 +550,14 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
         movable_square = ~occ_all;
 
     if (pieces & PieceGenType::KING) {
-        Bitboard seen = seenSquares<~c>(board, opp_empty);
+        Bitboard seen = 0;
+
+        // no need to know what is attacked if the king has nowhere to go
+        if (bool(attacks::king(king_sq) & opp_empty) || board.chess960()) {
+            // sliders giving check see through the king, it can't step back along their ray
+            seen = double_check ? seenSquares<~c>(board, occ_all ^ Bitboard::fromSquare(king_sq))
+                                : board.attackedBy(~c);
+        }
 
         whileBitboardAdd(movelist, Bitboard::fromSquare(king_sq),
                          [&](Square sq) { return generateKingMoves(sq, seen, movable_square); });
@@ -581,8 +614,260 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
     }
 }
 
-template <movegen::MoveGenType mt>
-inline void movegen::legalmoves(Movelist &movelist, const Board &board, int pieces) {
+/// @brief Counts the legal moves for a position
+/// @tparam c
+/// @tparam stop_at_first Returns as soon as a legal move was found
+/// @param board
+/// @return
+template <Color::underlying c, bool stop_at_first, typename BoardType>
+[[nodiscard]] inline int movegen::countLegalMoves(const BoardType &board) {
+    // Same masks as legalmoves, the destination squares are counted instead of added as moves.
+    // The king comes last, what it may not step on is the most expensive part to find out.
+    constexpr Bitboard RANK_PROMO = c == Color::WHITE ? attacks::MASK_RANK[static_cast<int>(Rank::RANK_8)]
+                                                      : attacks::MASK_RANK[static_cast<int>(Rank::RANK_1)];
+
+    const auto king_sq = board.kingSq(c);
+
+    const Bitboard occ_us  = board.us(c);
+    const Bitboard occ_opp = board.us(~c);
+    const Bitboard occ_all = occ_us | occ_opp;
+
+    const auto &info = board.attackInfo();
+
+    Bitboard check_mask = constants::DEFAULT_CHECKMASK;
+
+    const int double_check = std::min(info.checkers.count(), 2);
+
+    if (double_check == 1) {
+        const auto index = info.checkers.lsb();
+        check_mask       = SQUARES_BETWEEN_BB[king_sq.index()][index] | info.checkers;
+    }
+
+    int count = 0;
+
+    if (double_check < 2) {
+        const Bitboard pin_hv         = info.pin_hv;
+        const Bitboard pin_d          = info.pin_d;
+        const Bitboard movable_square = ~occ_us & check_mask;
+
+        const auto pawns = pawnTargets<c>(board, pin_d, pin_hv, check_mask, occ_opp);
+
+        count += pawns.left.count() + pawns.right.count() + pawns.single_push.count() + pawns.double_push.count();
+
+        // a promotion is four moves
+        count += 3 * ((pawns.left & RANK_PROMO).count() + (pawns.right & RANK_PROMO).count() +
+                      (pawns.single_push & RANK_PROMO).count());
+
+        const Square ep = board.enpassantSq();
+        if (ep != Square::underlying::NO_SQ) {
+            for (const auto &move : generateEPMove(board, check_mask, pin_d, pawns.pawns_lr, ep, c)) {
+                count += move != Move::NO_MOVE;
+            }
+        }
+
+        if (stop_at_first && count) return count;
+
+        Bitboard knights = board.pieces(PieceType::KNIGHT, c) & ~(pin_d | pin_hv);
+        while (knights) count += (generateKnightMoves(knights.pop()) & movable_square).count();
+
+        if (stop_at_first && count) return count;
+
+        Bitboard bishops = board.pieces(PieceType::BISHOP, c) & ~pin_hv;
+        while (bishops) count += (generateBishopMoves(bishops.pop(), pin_d, occ_all) & movable_square).count();
+
+        if (stop_at_first && count) return count;
+
+        Bitboard rooks = board.pieces(PieceType::ROOK, c) & ~pin_d;
+        while (rooks) count += (generateRookMoves(rooks.pop(), pin_hv, occ_all) & movable_square).count();
+
+        if (stop_at_first && count) return count;
+
+        Bitboard queens = board.pieces(PieceType::QUEEN, c) & ~(pin_d & pin_hv);
+        while (queens) count += (generateQueenMoves(queens.pop(), pin_d, pin_hv, occ_all) & movable_square).count();
+
+        if (stop_at_first && count) return count;
+    }
+
+    Bitboard seen = 0;
+
+    if (bool(attacks::king(king_sq) & ~occ_us) || board.chess960()) {
+        seen = double_check ? seenSquares<~c>(board, occ_all ^ Bitboard::fromSquare(king_sq)) : board.attackedBy(~c);
+    }
+
+    count += generateKingMoves(king_sq, seen, ~occ_us).count();
+
+    if (!double_check && Square::back_rank(king_sq, c) && board.castlingRights().has(c)) {
+        count += generateCastleMoves<c, MoveGenType::ALL>(board, king_sq, seen, info.pin_hv).count();
+    }
+
+    return count;
+}
+
+/// @brief Checks if there is a legal move for a position
+/// @tparam c
+/// @param board
+/// @return
+template <Color::underlying c, typename BoardType>
+[[nodiscard]] inline bool movegen::hasLegalMove(const BoardType &board) {
+    return countLegalMoves<c, true>(board) != 0;
+}
+
+/// @brief all pseudo-legal moves for a position
+/// @tparam c
+/// @tparam mt
+/// @param movelist
+/// @param board
+template <Color::underlying c, movegen::MoveGenType mt, typename BoardType>
+inline void movegen::pseudolegalmoves(Movelist &movelist, const BoardType &board, int pieces) {
+    // Same as legalmoves without the check and pin masks and the squares seen by the enemy,
+    // isLegal() takes care of those.
+    auto king_sq = board.kingSq(c);
+
+    Bitboard occ_us  = board.us(c);
+    Bitboard occ_opp = board.us(~c);
+    Bitboard occ_all = occ_us | occ_opp;
+
+    Bitboard movable_square;
+
+    if (mt == MoveGenType::ALL)
+        movable_square = ~occ_us;
+    else if (mt == MoveGenType::CAPTURE)
+        movable_square = occ_opp;
+    else  // QUIET moves
+        movable_square = ~occ_all;
+
+    if (pieces & PieceGenType::KING) {
+        whileBitboardAdd(movelist, Bitboard::fromSquare(king_sq),
+                         [&](Square sq) { return generateKingMoves(sq, 0, movable_square); });
+
+        if (Square::back_rank(king_sq, c) && board.castlingRights().has(c)) {
+            Bitboard moves_bb = generateCastleMoves<c, mt>(board, king_sq, 0, 0);
+            while (moves_bb) {
+                Square to = moves_bb.pop();
+                movelist.add(Move::make<Move::CASTLING>(king_sq, to));
+            }
+        }
+    }
+
+    if (pieces & PieceGenType::PAWN) {
+        generatePawnMoves<c, mt>(board, movelist, 0, 0, constants::DEFAULT_CHECKMASK, occ_opp);
+    }
+
+    if (pieces & PieceGenType::KNIGHT) {
+        whileBitboardAdd(movelist, board.pieces(PieceType::KNIGHT, c),
+                         [&](Square sq) { return generateKnightMoves(sq) & movable_square; });
+    }
+
+    if (pieces & PieceGenType::BISHOP) {
+        whileBitboardAdd(movelist, board.pieces(PieceType::BISHOP, c),
+                         [&](Square sq) { return generateBishopMoves(sq, 0, occ_all) & movable_square; });
+    }
+
+    if (pieces & PieceGenType::ROOK) {
+        whileBitboardAdd(movelist, board.pieces(PieceType::ROOK, c),
+                         [&](Square sq) { return generateRookMoves(sq, 0, occ_all) & movable_square; });
+    }
+
+    if (pieces & PieceGenType::QUEEN) {
+        whileBitboardAdd(movelist, board.pieces(PieceType::QUEEN, c),
+                         [&](Square sq) { return generateQueenMoves(sq, 0, 0, occ_all) & movable_square; });
+    }
+}
+
+/// @brief Returns the pieces of a color attacking a square, sliders see through the given occupancy.
+/// @param board
+/// @param color Attacker Color
+/// @param sq
+/// @param occupied
+/// @return
+template <typename BoardType>
+[[nodiscard]] inline Bitboard movegen::attackers(const BoardType &board, Color color, Square sq, Bitboard occupied) {
+    const auto queens = board.pieces(PieceType::QUEEN, color);
+
+    auto atks = attacks::pawn(~color, sq) & board.pieces(PieceType::PAWN, color);
+    atks |= attacks::knight(sq) & board.pieces(PieceType::KNIGHT, color);
+    atks |= attacks::bishop(sq, occupied) & (board.pieces(PieceType::BISHOP, color) | queens);
+    atks |= attacks::rook(sq, occupied) & (board.pieces(PieceType::ROOK, color) | queens);
+    atks |= attacks::king(sq) & board.pieces(PieceType::KING, color);
+
+    return atks;
+}
+
+/// @brief Computes the checkers and the pin masks of the side to move (see Board::AttackInfo).
+/// @param board
+/// @param info
+template <typename BoardType, typename AttackInfo>
+inline void movegen::checkInfo(const BoardType &board, AttackInfo &info) {
+    const auto c       = board.sideToMove();
+    const auto king_sq = board.kingSq(c);
+    const auto occ_us  = board.us(c);
+    const auto occ_opp = board.us(~c);
+
+    info.checkers = attackers(board, ~c, king_sq, board.occ());
+
+    if (c == Color::WHITE) {
+        info.pin_hv = pinMaskRooks<Color::WHITE>(board, king_sq, occ_opp, occ_us);
+        info.pin_d  = pinMaskBishops<Color::WHITE>(board, king_sq, occ_opp, occ_us);
+    } else {
+        info.pin_hv = pinMaskRooks<Color::BLACK>(board, king_sq, occ_opp, occ_us);
+        info.pin_d  = pinMaskBishops<Color::BLACK>(board, king_sq, occ_opp, occ_us);
+    }
+}
+
+/// @brief Checks if a pseudo-legal move of the side to move is legal.
+/// @param board
+/// @param move
+/// @return
+template <typename BoardType>
+[[nodiscard]] inline bool movegen::isLegal(const BoardType &board, const Move move) {
+    const auto c        = board.sideToMove();
+    const auto king_sq  = board.kingSq(c);
+    const auto from     = move.from();
+    const auto checkers = board.checkers();
+
+    if (move.typeOf() == Move::CASTLING) {
+        if (checkers) return false;
+
+        const bool king_side = move.to() > from;
+        const auto king_to   = Square::castling_king_square(king_side, c);
+        const auto rook_to   = Square::castling_rook_square(king_side, c);
+
+        // the king may not pass an attacked square, seen as if it had already left its square
+        const auto occ = board.occ() ^ Bitboard::fromSquare(from);
+        auto path      = SQUARES_BETWEEN_BB[from.index()][king_to.index()] | Bitboard::fromSquare(king_to);
+
+        while (path) {
+            if (attackers(board, ~c, path.pop(), occ)) return false;
+        }
+
+        // and the rook may not have been shielding it, e.g. in chess960 with a slider behind it
+        const auto occ_after =
+            (occ ^ Bitboard::fromSquare(move.to())) | Bitboard::fromSquare(king_to) | Bitboard::fromSquare(rook_to);
+
+        return !attackers(board, ~c, king_to, occ_after);
+    }
+
+    if (from == king_sq) {
+        return !attackers(board, ~c, move.to(), board.occ() ^ Bitboard::fromSquare(from));
+    }
+
+    // the common case, neither in check nor pinned
+    if (!checkers && !(board.pinned() & Bitboard::fromSquare(from)) && move.typeOf() != Move::ENPASSANT) return true;
+
+    // play the move on the occupancy, the captured piece no longer attacks
+    auto captured = Bitboard::fromSquare(move.to());
+    auto occ      = (board.occ() ^ Bitboard::fromSquare(from)) | captured;
+
+    if (move.typeOf() == Move::ENPASSANT) {
+        captured = Bitboard::fromSquare(move.to().ep_square());
+        occ ^= captured;
+    }
+
+    return !(attackers(board, ~c, king_sq, occ) & ~captured);
+}
+
+template <movegen::MoveGenType mt, typename BoardType>
+inline void movegen::legalmoves(Movelist &movelist, const BoardType &board, int pieces) {
     movelist.clear();
 
     if (board.sideToMove() == Color::WHITE)
@@ -591,9 +876,32 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
         legalmoves<Color::BLACK, mt>(movelist, board, pieces);
 }
 
-inline const std::array<std::array<Bitboard, 64>, 64> movegen::SQUARES_BETWEEN_BB = [] {
-    attacks::initAttacks();
-    return movegen::init_squares_between();
-}();
+template <movegen::MoveGenType mt, typename BoardType>
+inline void movegen::pseudolegalmoves(Movelist &movelist, const BoardType &board, int pieces) {
+    movelist.clear();
+
+    if (board.sideToMove() == Color::WHITE)
+        pseudolegalmoves<Color::WHITE, mt>(movelist, board, pieces);
+    else
+        pseudolegalmoves<Color::BLACK, mt>(movelist, board, pieces);
+}
+
+template <typename BoardType>
+[[nodiscard]] inline bool movegen::hasLegalMove(const BoardType &board) {
+    if (board.sideToMove() == Color::WHITE)
+        return hasLegalMove<Color::WHITE>(board);
+    else
+        return hasLegalMove<Color::BLACK>(board);
+}
+
+template <typename BoardType>
+[[nodiscard]] inline int movegen::countLegalMoves(const BoardType &board) {
+    if (board.sideToMove() == Color::WHITE)
+        return countLegalMoves<Color::WHITE>(board);
+    else
+        return countLegalMoves<Color::BLACK>(board);
+}
+
+inline constexpr std::array<std::array<Bitboard, 64>, 64> movegen::SQUARES_BETWEEN_BB = init_squares_between();
 
 }  // namespace chess
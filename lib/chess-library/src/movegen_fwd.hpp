@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 #include "movelist.hpp"
@@ -17,21 +18,62 @@ enum PieceGenType {
 
 class Board;
 
+template <typename Derived, std::size_t MaxPly>
+class BasicPosition;
+
 class movegen {
    public:
     enum class MoveGenType : std::uint8_t { ALL, CAPTURE, QUIET };
 
     /// @brief Generates all legal moves for a position.
     /// @tparam mt
+    /// @tparam BoardType Board or BasicPosition
     /// @param movelist
     /// @param board
-    template <MoveGenType mt = MoveGenType::ALL>
-    void static legalmoves(Movelist &movelist, const Board &board,
+    template <MoveGenType mt = MoveGenType::ALL, typename BoardType>
+    void static legalmoves(Movelist &movelist, const BoardType &board,
                            int pieces = PieceGenType::PAWN | PieceGenType::KNIGHT | PieceGenType::BISHOP |
                                         PieceGenType::ROOK | PieceGenType::QUEEN | PieceGenType::KING);
 
+    /// @brief Generates all pseudo-legal moves for a position, moves that may leave the own king in
+    /// check. They are meant to be checked with board.isLegal(move) right before they are played.
+    /// @tparam mt
+    /// @tparam BoardType Board or BasicPosition
+    /// @param movelist
+    /// @param board
+    template <MoveGenType mt = MoveGenType::ALL, typename BoardType>
+    void static pseudolegalmoves(Movelist &movelist, const BoardType &board,
+                                 int pieces = PieceGenType::PAWN | PieceGenType::KNIGHT | PieceGenType::BISHOP |
+                                              PieceGenType::ROOK | PieceGenType::QUEEN | PieceGenType::KING);
+
+    /// @brief Checks if the side to move has a legal move, stops at the first one it finds.
+    /// Cheaper than generating all legal moves to see if the movelist is empty.
+    /// @tparam BoardType Board or BasicPosition
+    /// @param board
+    /// @return
+    template <typename BoardType>
+    [[nodiscard]] static bool hasLegalMove(const BoardType &board);
+
+    /// @brief Counts the legal moves of the side to move, from the popcounts of their destination
+    /// squares instead of writing them to a movelist.
+    /// @tparam BoardType Board or BasicPosition
+    /// @param board
+    /// @return
+    template <typename BoardType>
+    [[nodiscard]] static int countLegalMoves(const BoardType &board);
+
+    /// @brief Returns the pieces of a color attacking a square, sliders see through the given occupancy,
+    /// e.g. the one after a move to see if it leaves the king in check.
+    /// @param board
+    /// @param color Attacker Color
+    /// @param sq
+    /// @param occupied
+    /// @return
+    template <typename BoardType>
+    [[nodiscard]] static Bitboard attackers(const BoardType &board, Color color, Square sq, Bitboard occupied);
+
    private:
-    static auto init_squares_between();
+    static constexpr std::array<std::array<Bitboard, 64>, 64> init_squares_between();
     static const std::array<std::array<Bitboard, 64>, 64> SQUARES_BETWEEN_BB;
 
     /// @brief Generate the checkmask.
@@ -41,8 +83,8 @@ class movegen {
     /// @param sq
     /// @param double_check
     /// @return
-    template <Color::underlying c>
-    [[nodiscard]] static Bitboard checkMask(const Board &board, Square sq, int &double_check);
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static Bitboard checkMask(const BoardType &board, Square sq, int &double_check);
 
     /// @brief Generate the pin mask for horizontal and vertical pins.
     /// Returns a bitboard where the ray between the king and the pinner is set.
@@ -52,8 +94,8 @@ class movegen {
     /// @param occ_enemy
     /// @param occ_us
     /// @return
-    template <Color::underlying c>
-    [[nodiscard]] static Bitboard pinMaskRooks(const Board &board, Square sq, Bitboard occ_enemy, Bitboard occ_us);
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static Bitboard pinMaskRooks(const BoardType &board, Square sq, Bitboard occ_enemy, Bitboard occ_us);
 
     /// @brief Generate the pin mask for diagonal pins.
     /// Returns a bitboard where the ray between the king and the pinner is set.
@@ -63,16 +105,38 @@ class movegen {
     /// @param occ_enemy
     /// @param occ_us
     /// @return
-    template <Color::underlying c>
-    [[nodiscard]] static Bitboard pinMaskBishops(const Board &board, Square sq, Bitboard occ_enemy, Bitboard occ_us);
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static Bitboard pinMaskBishops(const BoardType &board, Square sq, Bitboard occ_enemy, Bitboard occ_us);
 
-    /// @brief Returns the squares that are attacked by the enemy
+    /// @brief Returns the squares that are attacked by color c
     /// @tparam c
     /// @param board
-    /// @param enemy_empty
+    /// @param occupied Occupancy the sliders see
     /// @return
-    template <Color::underlying c>
-    [[nodiscard]] static Bitboard seenSquares(const Board &board, Bitboard enemy_empty);
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static Bitboard seenSquares(const BoardType &board, Bitboard occupied);
+
+    /// @brief Destination squares of the pawn moves, promotions included, and the pawns that
+    /// may capture en passant.
+    struct PawnTargets {
+        Bitboard left;
+        Bitboard right;
+        Bitboard single_push;
+        Bitboard double_push;
+        Bitboard pawns_lr;
+    };
+
+    /// @brief Generate the destination squares of the pawn moves.
+    /// @tparam c
+    /// @param board
+    /// @param pin_d
+    /// @param pin_hv
+    /// @param checkmask
+    /// @param occ_enemy
+    /// @return
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static PawnTargets pawnTargets(const BoardType &board, Bitboard pin_d, Bitboard pin_hv,
+                                                 Bitboard checkmask, Bitboard occ_enemy);
 
     /// @brief Generate pawn moves.
     /// @tparam c
@@ -83,11 +147,12 @@ class movegen {
     /// @param pin_hv
     /// @param checkmask
     /// @param occ_enemy
-    template <Color::underlying c, MoveGenType mt>
-    static void generatePawnMoves(const Board &board, Movelist &moves, Bitboard pin_d, Bitboard pin_hv,
+    template <Color::underlying c, MoveGenType mt, typename BoardType>
+    static void generatePawnMoves(const BoardType &board, Movelist &moves, Bitboard pin_d, Bitboard pin_hv,
                                   Bitboard checkmask, Bitboard occ_enemy);
 
-    [[nodiscard]] static std::array<Move, 2> generateEPMove(const Board &board, Bitboard checkmask, Bitboard pin_d,
+    template <typename BoardType>
+    [[nodiscard]] static std::array<Move, 2> generateEPMove(const BoardType &board, Bitboard checkmask, Bitboard pin_d,
                                                             Bitboard pawns_lr, Square ep, Color c);
 
     /// @brief Generate knight moves.
@@ -135,8 +200,8 @@ class movegen {
     /// @param seen
     /// @param pinHV
     /// @return
-    template <Color::underlying c, MoveGenType mt>
-    [[nodiscard]] static Bitboard generateCastleMoves(const Board &board, Square sq, Bitboard seen, Bitboard pinHV);
+    template <Color::underlying c, MoveGenType mt, typename BoardType>
+    [[nodiscard]] static Bitboard generateCastleMoves(const BoardType &board, Square sq, Bitboard seen, Bitboard pinHV);
 
     template <typename T>
     static void whileBitboardAdd(Movelist &movelist, Bitboard mask, T func);
@@ -146,10 +211,49 @@ class movegen {
     /// @tparam mt
     /// @param movelist
     /// @param board
-    template <Color::underlying c, MoveGenType mt>
-    static void legalmoves(Movelist &movelist, const Board &board, int pieces);
+    template <Color::underlying c, MoveGenType mt, typename BoardType>
+    static void legalmoves(Movelist &movelist, const BoardType &board, int pieces);
+
+    /// @brief Counts the legal moves for a position
+    /// @tparam c
+    /// @tparam stop_at_first Returns as soon as a legal move was found
+    /// @param board
+    /// @return
+    template <Color::underlying c, bool stop_at_first = false, typename BoardType>
+    [[nodiscard]] static int countLegalMoves(const BoardType &board);
+
+    /// @brief Checks if there is a legal move for a position
+    /// @tparam c
+    /// @param board
+    /// @return
+    template <Color::underlying c, typename BoardType>
+    [[nodiscard]] static bool hasLegalMove(const BoardType &board);
+
+    /// @brief all pseudo-legal moves for a position
+    /// @tparam c
+    /// @tparam mt
+    /// @param movelist
+    /// @param board
+    template <Color::underlying c, MoveGenType mt, typename BoardType>
+    static void pseudolegalmoves(Movelist &movelist, const BoardType &board, int pieces);
+
+    /// @brief Computes the checkers and the pin masks of the side to move (see Board::AttackInfo).
+    /// @param board
+    /// @param info
+    template <typename BoardType, typename AttackInfo>
+    static void checkInfo(const BoardType &board, AttackInfo &info);
+
+    /// @brief Checks if a pseudo-legal move of the side to move is legal.
+    /// @param board
+    /// @param move
+    /// @return
+    template <typename BoardType>
+    [[nodiscard]] static bool isLegal(const BoardType &board, Move move);
 
     friend class Board;
+
+    template <typename Derived, std::size_t MaxPly>
+    friend class BasicPosition;
 };
 
 }  // namespace chess
@@ -1,12 +1,26 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <exception>
+#include <fstream>
 #include <iostream>
 #include <istream>
 #include <optional>
 #include <stdexcept>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__unix) || defined(unix) || defined(__APPLE__) || defined(__MACH__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    define CHESS_PGN_MMAP
+#endif
 
 namespace chess::pgn {
 
@@ -61,6 +75,11 @@ class StreamParser {
    public:
     StreamParser(std::istream &stream) : stream_buffer(stream) {}
 
+    /// @brief Parses a PGN that is already in memory, e.g. a MappedFile, without copying it.
+    /// The data has to outlive the parser.
+    /// @param pgn
+    explicit StreamParser(std::string_view pgn) : stream_buffer(pgn) {}
+
     void readGames(Visitor &vis) {
         visitor = &vis;
 
@@ -123,10 +142,12 @@ class StreamParser {
     class StreamBuffer {
        private:
         static constexpr std::size_t N = BUFFER_SIZE;
-        using BufferType               = std::array<char, N * N>;
 
        public:
-        StreamBuffer(std::istream &stream) : stream_(stream) {}
+        StreamBuffer(std::istream &stream) : stream_(&stream), storage_(N * N), buffer_(storage_.data()) {}
+
+        // the whole input is a single buffer, which the first fill() hands out
+        explicit StreamBuffer(std::string_view data) : buffer_(data.data()), size_(data.size()) {}
 
         template <typename FUNC>
         void loop(FUNC f) {
@@ -193,12 +214,21 @@ class StreamParser {
         }
 
         bool fill() {
-            if (!stream_.good()) return false;
+            if (!stream_) {
+                if (bytes_read_ == size_) return false;
+
+                buffer_index_ = 0;
+                bytes_read_   = size_;
+
+                return bytes_read_ > 0;
+            }
+
+            if (!stream_->good()) return false;
 
             buffer_index_ = 0;
 
-            stream_.read(buffer_.data(), N * N);
-            bytes_read_ = stream_.gcount();
+            stream_->read(storage_.data(), N * N);
+            bytes_read_ = stream_->gcount();
 
             return bytes_read_ > 0;
         }
@@ -213,7 +243,7 @@ class StreamParser {
 
         char peek() {
             if (buffer_index_ + 1 >= bytes_read_) {
-                return stream_.peek();
+                return stream_ ? stream_->peek() : std::char_traits<char>::eof();
             }
 
             return buffer_[buffer_index_ + 1];
@@ -236,8 +266,10 @@ class StreamParser {
         }
 
        private:
-        std::istream &stream_;
-        BufferType buffer_;
+        std::istream *stream_ = nullptr;
+        std::vector<char> storage_;
+        const char *buffer_;
+        std::streamsize size_         = 0;
         std::streamsize bytes_read_   = 0;
         std::streamsize buffer_index_ = 0;
     };
@@ -641,4 +673,151 @@ class StreamParser {
 
     bool pgn_end = true;
 };
+
+/// @brief Read-only view of a whole file, memory mapped where the platform has mmap and read into
+/// memory otherwise. Meant to be handed to StreamParser(std::string_view) or readGamesParallel.
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string &path) {
+#ifdef CHESS_PGN_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0) {
+            size_ = static_cast<std::size_t>(st.st_size);
+            open_ = true;
+
+            if (size_ > 0) {
+                void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (data == MAP_FAILED) {
+                    size_ = 0;
+                    open_ = false;
+                } else {
+                    // the pages are read front to back, let the kernel read ahead
+                    ::madvise(data, size_, MADV_SEQUENTIAL);
+                    data_ = static_cast<const char *>(data);
+                }
+            }
+        }
+
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return;
+
+        contents_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data_ = contents_.data();
+        size_ = contents_.size();
+        open_ = true;
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef CHESS_PGN_MMAP
+        if (data_) ::munmap(const_cast<char *>(data_), size_);
+#endif
+    }
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /// @brief Whether the file could be opened and read, an empty file counts as open.
+    /// @return
+    [[nodiscard]] bool isOpen() const noexcept { return open_; }
+
+    /// @brief The contents of the file, valid as long as the MappedFile lives.
+    /// @return
+    [[nodiscard]] std::string_view view() const noexcept { return {data_, size_}; }
+
+   private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+    bool open_        = false;
+#ifndef CHESS_PGN_MMAP
+    std::string contents_;
+#endif
+};
+
+/// @brief Finds the first game that starts at or after `offset`: an "[Event " tag at the start of a
+/// line, after a blank line or at the very beginning.
+/// @param pgn
+/// @param offset
+/// @return the position of the tag, pgn.size() if there is none
+[[nodiscard]] inline std::size_t nextGameStart(std::string_view pgn, std::size_t offset) noexcept {
+    if (offset == 0) return 0;
+
+    while ((offset = pgn.find("[Event ", offset)) != std::string_view::npos) {
+        // walk back over the end of the previous line, which has to be an empty one
+        std::size_t newlines = 0, i = offset;
+
+        while (i > 0 && newlines < 2 && (pgn[i - 1] == '\n' || pgn[i - 1] == '\r')) {
+            newlines += pgn[--i] == '\n';
+        }
+
+        if (newlines == 2 || i == 0) return offset;
+
+        offset++;
+    }
+
+    return pgn.size();
+}
+
+/// @brief Cuts a PGN into `parts` consecutive ranges of about the same size, each starting at a
+/// game boundary (see nextGameStart). Ranges can be empty when there are fewer games than parts.
+/// @param pgn
+/// @param parts
+/// @return the ranges, in order
+[[nodiscard]] inline std::vector<std::string_view> splitGames(std::string_view pgn, std::size_t parts) {
+    std::vector<std::string_view> ranges;
+    std::size_t start = 0;
+
+    for (std::size_t i = 1; i <= parts; i++) {
+        const auto end = i == parts ? pgn.size() : nextGameStart(pgn, std::max(start, pgn.size() * i / parts));
+
+        ranges.push_back(pgn.substr(start, end - start));
+        start = end;
+    }
+
+    return ranges;
+}
+
+/// @brief Parses a PGN in memory on one thread per visitor. The PGN is cut with splitGames and
+/// every range is read by its own StreamParser into the visitor with the same index, so the
+/// visitors only have to be thread safe towards each other. Going through the visitors front to
+/// back sees the games in file order. An exception from a visitor is rethrown once all threads
+/// are done.
+/// @tparam VisitorType a class derived from Visitor
+/// @param pgn
+/// @param visitors
+template <typename VisitorType>
+void readGamesParallel(std::string_view pgn, std::vector<VisitorType> &visitors) {
+    const auto ranges = splitGames(pgn, visitors.size());
+
+    std::vector<std::exception_ptr> errors(ranges.size());
+    std::vector<std::thread> threads;
+
+    const auto parse = [&](std::size_t i) {
+        try {
+            StreamParser<> parser(ranges[i]);
+            parser.readGames(visitors[i]);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    // the calling thread takes the first range
+    for (std::size_t i = 1; i < ranges.size(); i++) {
+        if (!ranges[i].empty()) threads.emplace_back(parse, i);
+    }
+
+    if (!ranges.empty()) parse(0);
+
+    for (auto &thread : threads) thread.join();
+
+    for (const auto &error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
 }  // namespace chess::pgn
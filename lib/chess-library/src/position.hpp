@@ -0,0 +1,713 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "attacks_fwd.hpp"
+#include "board.hpp"
+#include "color.hpp"
+#include "constants.hpp"
+#include "coords.hpp"
+#include "move.hpp"
+#include "movegen_fwd.hpp"
+#include "movelist.hpp"
+#include "piece.hpp"
+#include "zobrist.hpp"
+
+namespace chess {
+
+/// @brief A position with the interface of Board, meant for search code.
+/// It has no virtual functions and keeps its history in a fixed-capacity array instead of a
+/// std::vector, so make/unmake can be inlined and a copy (for copy-make) never allocates and only
+/// copies the part of the history in use.
+/// Classes deriving from it (CRTP) can shadow the onPlacePiece/onRemovePiece/onSetFen hooks to keep
+/// their own incremental state, e.g. an evaluation:
+///
+///     class EvalPosition : public BasicPosition<EvalPosition> {
+///         friend class BasicPosition<EvalPosition>;
+///         void onPlacePiece(Piece piece, Square sq) { ... }
+///     };
+///
+/// FEN parsing goes through Board, positions are built once and then only moved around.
+/// @tparam Derived The deriving class, void if there is none.
+/// @tparam MaxPly Capacity of the history, moves made since the last setFen. Past it, the oldest
+/// half is dropped and those moves can no longer be unmade.
+template <typename Derived = void, std::size_t MaxPly = 256>
+class BasicPosition {
+    using U64  = std::uint64_t;
+    using Self = std::conditional_t<std::is_void_v<Derived>, BasicPosition, Derived>;
+
+    struct State {
+        U64 hash;
+        U64 pawn_key;
+        U64 material_key;
+        Board::CastlingRights castling;
+        Square enpassant;
+        uint8_t half_moves;
+        Piece captured_piece;
+        Board::AttackInfo info;
+    };
+
+   public:
+    using CastlingRights = Board::CastlingRights;
+    using AttackInfo     = Board::AttackInfo;
+
+    explicit BasicPosition(std::string_view fen = constants::STARTPOS, bool chess960 = false) {
+        chess960_ = chess960;
+        load(Board(fen, chess960));
+    }
+
+    /// @brief Copies the position of a board, without its move history.
+    /// @param board
+    explicit BasicPosition(const Board &board) { load(board); }
+
+    BasicPosition(const BasicPosition &other) { copyFrom(other); }
+
+    BasicPosition &operator=(const BasicPosition &other) {
+        if (this != &other) copyFrom(other);
+        return *this;
+    }
+
+    static BasicPosition fromFen(std::string_view fen) { return BasicPosition(fen); }
+
+    void setFen(std::string_view fen) {
+        load(Board(fen, chess960_));
+        self().onSetFen();
+    }
+
+    /// @brief A Board of the current position, without the move history.
+    /// @return
+    [[nodiscard]] Board toBoard() const { return Board(getFen(), chess960_); }
+
+    /// @brief Get the current FEN string.
+    /// @return
+    [[nodiscard]] std::string getFen(bool move_counters = true) const {
+        std::string ss;
+        ss.reserve(100);
+
+        for (int rank = 7; rank >= 0; rank--) {
+            int free_space = 0;
+
+            for (int file = 0; file < 8; file++) {
+                const Piece piece = board_[rank * 8 + file];
+
+                if (piece == Piece::NONE) {
+                    free_space++;
+                    continue;
+                }
+
+                if (free_space) {
+                    ss += char('0' + free_space);
+                    free_space = 0;
+                }
+
+                ss += static_cast<std::string>(piece);
+            }
+
+            if (free_space) ss += char('0' + free_space);
+            if (rank > 0) ss += '/';
+        }
+
+        ss += stm_ == Color::WHITE ? " w " : " b ";
+        ss += cr_.isEmpty() ? "-" : getCastleString();
+        ss += ' ';
+        ss += ep_sq_ == Square::underlying::NO_SQ ? std::string("-") : static_cast<std::string>(ep_sq_);
+
+        if (move_counters) {
+            ss += ' ';
+            ss += std::to_string(halfMoveClock());
+            ss += ' ';
+            ss += std::to_string(fullMoveNumber());
+        }
+
+        return ss;
+    }
+
+    template <bool EXACT = false>
+    void makeMove(const Move move) {
+        const auto capture  = at(move.to()) != Piece::NONE && move.typeOf() != Move::CASTLING;
+        const auto captured = at(move.to());
+        const auto pt       = at<PieceType>(move.from());
+
+        // Validate side to move
+        assert((at(move.from()) < Piece::BLACKPAWN) == (stm_ == Color::WHITE));
+        reserveState();
+
+        states_[size_++] = State{key_, pawn_key_, material_key_, cr_, ep_sq_, hfm_, captured, info_};
+        info_.valid      = 0;
+
+        hfm_++;
+        plies_++;
+
+        if (ep_sq_ != Square::underlying::NO_SQ) key_ ^= Zobrist::enpassant(ep_sq_.file());
+        ep_sq_ = Square::underlying::NO_SQ;
+
+        if (capture) {
+            removePiece(captured, move.to());
+
+            hfm_ = 0;
+            key_ ^= Zobrist::piece(captured, move.to());
+            material_key_ ^= Zobrist::piece(captured, Square(pieces(captured.type(), ~stm_).count()));
+
+            if (captured.type() == PieceType::PAWN) pawn_key_ ^= Zobrist::piece(captured, move.to());
+
+            // remove castling rights if rook is captured
+            if (captured.type() == PieceType::ROOK && Rank::back_rank(move.to().rank(), ~stm_)) {
+                const auto king_sq = kingSq(~stm_);
+                const auto file    = CastlingRights::closestSide(move.to(), king_sq);
+
+                if (cr_.getRookFile(~stm_, file) == move.to().file()) {
+                    key_ ^= Zobrist::castlingIndex(cr_.clear(~stm_, file));
+                }
+            }
+        }
+
+        // remove castling rights if king moves
+        if (pt == PieceType::KING && cr_.has(stm_)) {
+            key_ ^= Zobrist::castling(cr_.hashIndex());
+            cr_.clear(stm_);
+            key_ ^= Zobrist::castling(cr_.hashIndex());
+        } else if (pt == PieceType::ROOK && Square::back_rank(move.from(), stm_)) {
+            const auto king_sq = kingSq(stm_);
+            const auto file    = CastlingRights::closestSide(move.from(), king_sq);
+
+            // remove castling rights if rook moves from back rank
+            if (cr_.getRookFile(stm_, file) == move.from().file()) {
+                key_ ^= Zobrist::castlingIndex(cr_.clear(stm_, file));
+            }
+        } else if (pt == PieceType::PAWN) {
+            hfm_ = 0;
+
+            // double push, add the enpassant hash if enemy pawns are attacking the square
+            if (Square::value_distance(move.to(), move.from()) == 16) {
+                Bitboard ep_mask = attacks::pawn(stm_, move.to().ep_square());
+
+                if (static_cast<bool>(ep_mask & pieces(PieceType::PAWN, ~stm_)) &&
+                    (!EXACT || hasLegalEnpassant(move))) {
+                    assert(at(move.to().ep_square()) == Piece::NONE);
+                    ep_sq_ = move.to().ep_square();
+                    key_ ^= Zobrist::enpassant(move.to().ep_square().file());
+                }
+            }
+        }
+
+        if (move.typeOf() == Move::CASTLING) {
+            assert(at<PieceType>(move.from()) == PieceType::KING);
+            assert(at<PieceType>(move.to()) == PieceType::ROOK);
+
+            const bool king_side = move.to() > move.from();
+            const auto rookTo    = Square::castling_rook_square(king_side, stm_);
+            const auto kingTo    = Square::castling_king_square(king_side, stm_);
+
+            const auto king = at(move.from());
+            const auto rook = at(move.to());
+
+            removePiece(king, move.from());
+            removePiece(rook, move.to());
+
+            placePiece(king, kingTo);
+            placePiece(rook, rookTo);
+
+            key_ ^= Zobrist::piece(king, move.from()) ^ Zobrist::piece(king, kingTo);
+            key_ ^= Zobrist::piece(rook, move.to()) ^ Zobrist::piece(rook, rookTo);
+        } else if (move.typeOf() == Move::PROMOTION) {
+            const auto piece_pawn = Piece(PieceType::PAWN, stm_);
+            const auto piece_prom = Piece(move.promotionType(), stm_);
+
+            removePiece(piece_pawn, move.from());
+            placePiece(piece_prom, move.to());
+
+            key_ ^= Zobrist::piece(piece_pawn, move.from()) ^ Zobrist::piece(piece_prom, move.to());
+            pawn_key_ ^= Zobrist::piece(piece_pawn, move.from());
+            material_key_ ^= Zobrist::piece(piece_pawn, Square(pieces(PieceType::PAWN, stm_).count())) ^
+                             Zobrist::piece(piece_prom, Square(pieces(piece_prom.type(), stm_).count() - 1));
+        } else {
+            assert(at(move.from()) != Piece::NONE);
+            assert(at(move.to()) == Piece::NONE);
+
+            const auto piece = at(move.from());
+
+            removePiece(piece, move.from());
+            placePiece(piece, move.to());
+
+            key_ ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, move.to());
+
+            if (pt == PieceType::PAWN) {
+                pawn_key_ ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, move.to());
+            }
+        }
+
+        if (move.typeOf() == Move::ENPASSANT) {
+            assert(at<PieceType>(move.to().ep_square()) == PieceType::PAWN);
+
+            const auto piece = Piece(PieceType::PAWN, ~stm_);
+
+            removePiece(piece, move.to().ep_square());
+
+            key_ ^= Zobrist::piece(piece, move.to().ep_square());
+            pawn_key_ ^= Zobrist::piece(piece, move.to().ep_square());
+            material_key_ ^= Zobrist::piece(piece, Square(pieces(PieceType::PAWN, ~stm_).count()));
+        }
+
+        key_ ^= Zobrist::sideToMove();
+        stm_ = ~stm_;
+    }
+
+    void unmakeMove(const Move move) {
+        assert(size_ > 0);
+        const auto &prev = states_[--size_];
+
+        info_  = prev.info;
+        ep_sq_ = prev.enpassant;
+        cr_    = prev.castling;
+        hfm_   = prev.half_moves;
+        key_   = prev.hash;
+        stm_   = ~stm_;
+        plies_--;
+
+        pawn_key_     = prev.pawn_key;
+        material_key_ = prev.material_key;
+
+        if (move.typeOf() == Move::CASTLING) {
+            const bool king_side = move.to() > move.from();
+
+            const auto rook_from_sq = Square(king_side ? File::FILE_F : File::FILE_D, move.from().rank());
+            const auto king_to_sq   = Square(king_side ? File::FILE_G : File::FILE_C, move.from().rank());
+
+            const auto rook = at(rook_from_sq);
+            const auto king = at(king_to_sq);
+
+            removePiece(rook, rook_from_sq);
+            removePiece(king, king_to_sq);
+
+            placePiece(king, move.from());
+            placePiece(rook, move.to());
+            return;
+        }
+
+        if (move.typeOf() == Move::PROMOTION) {
+            removePiece(at(move.to()), move.to());
+            placePiece(Piece(PieceType::PAWN, stm_), move.from());
+        } else {
+            const auto piece = at(move.to());
+
+            removePiece(piece, move.to());
+            placePiece(piece, move.from());
+        }
+
+        if (move.typeOf() == Move::ENPASSANT) {
+            placePiece(Piece(PieceType::PAWN, ~stm_), move.to().ep_square());
+        } else if (prev.captured_piece != Piece::NONE) {
+            placePiece(prev.captured_piece, move.to());
+        }
+    }
+
+    /// @brief Make a null move. (Switches the side to move)
+    void makeNullMove() {
+        reserveState();
+        states_[size_++] = State{key_, pawn_key_, material_key_, cr_, ep_sq_, hfm_, Piece::NONE, info_};
+        info_.valid      = 0;
+
+        key_ ^= Zobrist::sideToMove();
+        if (ep_sq_ != Square::underlying::NO_SQ) key_ ^= Zobrist::enpassant(ep_sq_.file());
+        ep_sq_ = Square::underlying::NO_SQ;
+
+        stm_ = ~stm_;
+        plies_++;
+    }
+
+    /// @brief Unmake a null move. (Switches the side to move)
+    void unmakeNullMove() {
+        const auto &prev = states_[--size_];
+
+        info_  = prev.info;
+        ep_sq_ = prev.enpassant;
+        cr_    = prev.castling;
+        hfm_   = prev.half_moves;
+        key_   = prev.hash;
+
+        stm_ = ~stm_;
+        plies_--;
+    }
+
+    [[nodiscard]] Bitboard us(Color color) const { return occ_bb_[color]; }
+    [[nodiscard]] Bitboard them(Color color) const { return us(~color); }
+    [[nodiscard]] Bitboard occ() const { return occ_bb_[0] | occ_bb_[1]; }
+    [[nodiscard]] Bitboard all() const { return occ(); }
+
+    [[nodiscard]] Square kingSq(Color color) const {
+        assert(pieces(PieceType::KING, color) != Bitboard(0));
+        return pieces(PieceType::KING, color).lsb();
+    }
+
+    [[nodiscard]] Bitboard pieces(PieceType type, Color color) const { return pieces_bb_[type] & occ_bb_[color]; }
+    [[nodiscard]] Bitboard pieces(PieceType type) const { return pieces_bb_[type]; }
+
+    template <typename T = Piece>
+    [[nodiscard]] T at(Square sq) const {
+        if constexpr (std::is_same_v<T, PieceType>) {
+            return board_[sq.index()].type();
+        } else {
+            return board_[sq.index()];
+        }
+    }
+
+    /// @brief Checks if a move is a capture, enpassant moves are also considered captures.
+    /// @param move
+    /// @return
+    [[nodiscard]] bool isCapture(const Move move) const {
+        return (at(move.to()) != Piece::NONE && move.typeOf() != Move::CASTLING) || move.typeOf() == Move::ENPASSANT;
+    }
+
+    [[nodiscard]] U64 hash() const { return key_; }
+    [[nodiscard]] U64 pawnKey() const { return pawn_key_; }
+    [[nodiscard]] U64 materialKey() const { return material_key_; }
+    [[nodiscard]] Color sideToMove() const { return stm_; }
+    [[nodiscard]] Square enpassantSq() const { return ep_sq_; }
+    [[nodiscard]] CastlingRights castlingRights() const { return cr_; }
+    [[nodiscard]] std::uint32_t halfMoveClock() const { return hfm_; }
+    [[nodiscard]] std::uint32_t fullMoveNumber() const { return 1 + plies_ / 2; }
+    [[nodiscard]] bool chess960() const { return chess960_; }
+
+    /// @brief Number of moves that can be unmade, at most MaxPly. A full history drops its oldest
+    /// half on the next move.
+    /// @return
+    [[nodiscard]] std::size_t historySize() const { return size_; }
+
+    [[nodiscard]] std::string getCastleString() const {
+        std::string ss;
+
+        for (auto color : {Color::WHITE, Color::BLACK}) {
+            for (auto side : {CastlingRights::Side::KING_SIDE, CastlingRights::Side::QUEEN_SIDE}) {
+                if (!cr_.has(color, side)) continue;
+
+                if (chess960_) {
+                    const auto file = static_cast<std::string>(cr_.getRookFile(color, side))[0];
+                    ss += color == Color::WHITE ? char(std::toupper(file)) : file;
+                } else {
+                    const char c = side == CastlingRights::Side::KING_SIDE ? 'k' : 'q';
+                    ss += color == Color::WHITE ? char(std::toupper(c)) : c;
+                }
+            }
+        }
+
+        return ss;
+    }
+
+    /// @brief Checks if the current position is a repetition, set this to 1 if
+    /// you are writing a chess engine.
+    /// @param count
+    /// @return
+    [[nodiscard]] bool isRepetition(int count = 2) const {
+        uint8_t c = 0;
+
+        for (int i = static_cast<int>(size_) - 2; i >= 0 && i >= static_cast<int>(size_) - hfm_ - 1; i -= 2) {
+            if (states_[i].hash == key_) c++;
+
+            if (c == count) return true;
+        }
+
+        return false;
+    }
+
+    [[nodiscard]] bool isHalfMoveDraw() const { return hfm_ >= 100; }
+
+    /// @brief Only call this function if isHalfMoveDraw() returns true.
+    /// @return
+    [[nodiscard]] std::pair<GameResultReason, GameResult> getHalfMoveDrawType() const {
+        if (inCheck() && !movegen::hasLegalMove(*this)) {
+            return {GameResultReason::CHECKMATE, GameResult::LOSE};
+        }
+
+        return {GameResultReason::FIFTY_MOVE_RULE, GameResult::DRAW};
+    }
+
+    [[nodiscard]] bool isInsufficientMaterial() const {
+        const auto count = occ().count();
+
+        // only kings, draw
+        if (count == 2) return true;
+
+        // only bishop + knight, cant mate
+        if (count == 3) {
+            if (pieces(PieceType::BISHOP) || pieces(PieceType::KNIGHT)) return true;
+        }
+
+        if (count == 4) {
+            const auto white_bishops = pieces(PieceType::BISHOP, Color::WHITE);
+            const auto black_bishops = pieces(PieceType::BISHOP, Color::BLACK);
+
+            // same colored bishops, cant mate
+            if (white_bishops && black_bishops && Square::same_color(white_bishops.lsb(), black_bishops.lsb()))
+                return true;
+
+            // one side with two bishops which have the same color
+            if (white_bishops.count() == 2) {
+                if (Square::same_color(white_bishops.lsb(), white_bishops.msb())) return true;
+            } else if (black_bishops.count() == 2) {
+                if (Square::same_color(black_bishops.lsb(), black_bishops.msb())) return true;
+            }
+        }
+
+        return false;
+    }
+
+    [[nodiscard]] std::pair<GameResultReason, GameResult> isGameOver() const {
+        if (isHalfMoveDraw()) return getHalfMoveDrawType();
+
+        if (isInsufficientMaterial()) return {GameResultReason::INSUFFICIENT_MATERIAL, GameResult::DRAW};
+
+        if (isRepetition()) return {GameResultReason::THREEFOLD_REPETITION, GameResult::DRAW};
+
+        if (!movegen::hasLegalMove(*this)) {
+            if (inCheck()) return {GameResultReason::CHECKMATE, GameResult::LOSE};
+            return {GameResultReason::STALEMATE, GameResult::DRAW};
+        }
+
+        return {GameResultReason::NONE, GameResult::NONE};
+    }
+
+    /// @brief Checks if a square is attacked by the given color.
+    /// @param square
+    /// @param color
+    /// @return
+    [[nodiscard]] bool isAttacked(Square square, Color color) const {
+        // cheap checks first
+        if (attacks::pawn(~color, square) & pieces(PieceType::PAWN, color)) return true;
+        if (attacks::knight(square) & pieces(PieceType::KNIGHT, color)) return true;
+        if (attacks::king(square) & pieces(PieceType::KING, color)) return true;
+
+        const auto queens = pieces(PieceType::QUEEN, color);
+        if (attacks::bishop(square, occ()) & (pieces(PieceType::BISHOP, color) | queens)) return true;
+        if (attacks::rook(square, occ()) & (pieces(PieceType::ROOK, color) | queens)) return true;
+
+        return false;
+    }
+
+    [[nodiscard]] bool inCheck() const { return bool(checkers()); }
+
+    /// @brief Returns the pieces giving check to the side to move.
+    /// @return
+    [[nodiscard]] Bitboard checkers() const { return attackInfo().checkers; }
+
+    /// @brief Returns the pieces of the side to move that are pinned to their king.
+    /// @return
+    [[nodiscard]] Bitboard pinned() const {
+        const auto &info = attackInfo();
+        return (info.pin_hv | info.pin_d) & us(stm_);
+    }
+
+    /// @brief Returns the squares attacked by a color, including squares of its own pieces.
+    /// @param color
+    /// @return
+    [[nodiscard]] Bitboard attackedBy(Color color) const {
+        const auto flag = color == Color::WHITE ? AttackInfo::ATTACKED_WHITE : AttackInfo::ATTACKED_BLACK;
+
+        if (!(info_.valid & flag)) {
+            info_.attacked[color] = color == Color::WHITE ? movegen::seenSquares<Color::WHITE>(*this, occ())
+                                                          : movegen::seenSquares<Color::BLACK>(*this, occ());
+            info_.valid |= flag;
+        }
+
+        return info_.attacked[color];
+    }
+
+    /// @brief Checks if a pseudo-legal move (see movegen::pseudolegalmoves) is legal.
+    /// @param move
+    /// @return
+    [[nodiscard]] bool isLegal(const Move move) const { return movegen::isLegal(*this, move); }
+
+    [[nodiscard]] bool hasNonPawnMaterial(Color color) const {
+        return bool(pieces(PieceType::KNIGHT, color) | pieces(PieceType::BISHOP, color) |
+                    pieces(PieceType::ROOK, color) | pieces(PieceType::QUEEN, color));
+    }
+
+    /// @brief Regenerates the zobrist hash key
+    /// @return
+    [[nodiscard]] U64 zobrist() const {
+        U64 hash_key = 0ULL;
+
+        auto occupied = occ();
+        while (occupied) {
+            const Square sq = occupied.pop();
+            hash_key ^= Zobrist::piece(at(sq), sq);
+        }
+
+        if (ep_sq_ != Square::underlying::NO_SQ) hash_key ^= Zobrist::enpassant(ep_sq_.file());
+        if (stm_ == Color::WHITE) hash_key ^= Zobrist::sideToMove();
+
+        return hash_key ^ Zobrist::castling(cr_.hashIndex());
+    }
+
+   protected:
+    // Hooks for the deriving class, called after the board has been changed.
+    void onPlacePiece(Piece, Square) {}
+    void onRemovePiece(Piece, Square) {}
+    void onSetFen() {}
+
+    void placePiece(Piece piece, Square sq) {
+        assert(board_[sq.index()] == Piece::NONE);
+
+        pieces_bb_[piece.type()].set(sq.index());
+        occ_bb_[piece.color()].set(sq.index());
+        board_[sq.index()] = piece;
+
+        self().onPlacePiece(piece, sq);
+    }
+
+    void removePiece(Piece piece, Square sq) {
+        assert(board_[sq.index()] == piece && piece != Piece::NONE);
+
+        pieces_bb_[piece.type()].clear(sq.index());
+        occ_bb_[piece.color()].clear(sq.index());
+        board_[sq.index()] = Piece::NONE;
+
+        self().onRemovePiece(piece, sq);
+    }
+
+    std::array<Bitboard, 6> pieces_bb_ = {};
+    std::array<Bitboard, 2> occ_bb_    = {};
+    std::array<Piece, 64> board_       = {};
+
+    U64 key_           = 0ULL;
+    U64 pawn_key_      = 0ULL;
+    U64 material_key_  = 0ULL;
+    CastlingRights cr_ = {};
+    uint16_t plies_    = 0;
+    Color stm_         = Color::WHITE;
+    Square ep_sq_      = Square::underlying::NO_SQ;
+    uint8_t hfm_       = 0;
+
+    bool chess960_ = false;
+
+   private:
+    Self &self() { return static_cast<Self &>(*this); }
+
+    friend class movegen;
+
+    const AttackInfo &attackInfo() const {
+        if (!(info_.valid & AttackInfo::CHECKS)) {
+            movegen::checkInfo(*this, info_);
+            info_.valid |= AttackInfo::CHECKS;
+        }
+
+        return info_;
+    }
+
+    // Copies the pieces and the state of a board, without hooks, the history starts out empty.
+    void load(const Board &board) {
+        pieces_bb_.fill(Bitboard(0));
+        occ_bb_.fill(Bitboard(0));
+
+        for (int sq = 0; sq < 64; sq++) {
+            const Piece piece = board.at(Square(sq));
+            board_[sq]        = piece;
+
+            if (piece == Piece::NONE) continue;
+            pieces_bb_[piece.type()].set(sq);
+            occ_bb_[piece.color()].set(sq);
+        }
+
+        key_          = board.hash();
+        pawn_key_     = board.pawnKey();
+        material_key_ = board.materialKey();
+        cr_           = board.castlingRights();
+        stm_          = board.sideToMove();
+        plies_        = (board.fullMoveNumber() - 1) * 2 + (stm_ == Color::BLACK);
+        ep_sq_        = board.enpassantSq();
+        hfm_          = board.halfMoveClock();
+        chess960_     = board.chess960();
+        size_         = 0;
+        info_         = {};
+    }
+
+    void copyFrom(const BasicPosition &other) {
+        pieces_bb_    = other.pieces_bb_;
+        occ_bb_       = other.occ_bb_;
+        board_        = other.board_;
+        key_          = other.key_;
+        pawn_key_     = other.pawn_key_;
+        material_key_ = other.material_key_;
+        cr_           = other.cr_;
+        plies_        = other.plies_;
+        stm_          = other.stm_;
+        ep_sq_        = other.ep_sq_;
+        hfm_          = other.hfm_;
+        chess960_     = other.chess960_;
+        size_         = other.size_;
+        info_         = other.info_;
+
+        // only the part of the history in use
+        std::copy(other.states_.begin(), other.states_.begin() + size_, states_.begin());
+    }
+
+    // Whether the side to move after the double push `move` has a legal enpassant capture,
+    // asked before `move` is made.
+    bool hasLegalEnpassant(const Move move) {
+        const auto piece = at(move.from());
+        const auto pawn  = PieceType(PieceType::PAWN);
+        const auto us    = ~stm_;
+
+        // make the push by hand, without hooks
+        pieces_bb_[pawn].clear(move.from().index()).set(move.to().index());
+        occ_bb_[stm_].clear(move.from().index()).set(move.to().index());
+        board_[move.from().index()] = Piece::NONE;
+        board_[move.to().index()]   = piece;
+        stm_                        = us;
+
+        int double_check = 0;
+        const auto king_sq = kingSq(us);
+        Bitboard checkmask, pin_hv, pin_d;
+
+        if (us == Color::WHITE) {
+            checkmask = movegen::checkMask<Color::WHITE>(*this, king_sq, double_check);
+            pin_hv    = movegen::pinMaskRooks<Color::WHITE>(*this, king_sq, occ_bb_[~us], occ_bb_[us]);
+            pin_d     = movegen::pinMaskBishops<Color::WHITE>(*this, king_sq, occ_bb_[~us], occ_bb_[us]);
+        } else {
+            checkmask = movegen::checkMask<Color::BLACK>(*this, king_sq, double_check);
+            pin_hv    = movegen::pinMaskRooks<Color::BLACK>(*this, king_sq, occ_bb_[~us], occ_bb_[us]);
+            pin_d     = movegen::pinMaskBishops<Color::BLACK>(*this, king_sq, occ_bb_[~us], occ_bb_[us]);
+        }
+
+        const auto pawns_lr = pieces(PieceType::PAWN, us) & ~pin_hv;
+        const auto moves    = movegen::generateEPMove(*this, checkmask, pin_d, pawns_lr, move.to().ep_square(), us);
+
+        // undo
+        stm_ = ~us;
+        pieces_bb_[pawn].clear(move.to().index()).set(move.from().index());
+        occ_bb_[stm_].clear(move.to().index()).set(move.from().index());
+        board_[move.to().index()]   = Piece::NONE;
+        board_[move.from().index()] = piece;
+
+        return moves[0] != Move::NO_MOVE;
+    }
+
+    // Makes room for one more state. A full history keeps only its newest MaxPly / 2 states, as if
+    // the position had been set up from a FEN then: the older moves can't be unmade anymore, but
+    // isRepetition only looks back as far as the 50 move rule allows, which the default keeps.
+    void reserveState() {
+        if (size_ < MaxPly) return;
+
+        const auto keep = MaxPly / 2;
+        std::copy(states_.begin() + (size_ - keep), states_.begin() + size_, states_.begin());
+        size_ = keep;
+    }
+
+    std::array<State, MaxPly> states_;
+    std::size_t size_ = 0;
+
+    // see attackInfo() and attackedBy()
+    mutable AttackInfo info_ = {};
+};
+
+using Position = BasicPosition<>;
+
+}  // namespace chess
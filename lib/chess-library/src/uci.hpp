@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <cctype>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -16,33 +17,37 @@
 namespace chess {
 class uci {
    public:
+    /// @brief Longest UCI, SAN or LAN string the formatting functions write, without the terminating null.
+    static constexpr std::size_t MAX_MOVE_LENGTH = 8;
+
     /// @brief Converts an internal move to a UCI string
     /// @param move
     /// @param chess960
     /// @return
     [[nodiscard]] static std::string moveToUci(const Move &move, bool chess960 = false) noexcept(false) {
-        // Get the from and to squares
-        Square from_sq = move.from();
-        Square to_sq   = move.to();
-
-        // If the move is not a chess960 castling move and is a king moving more than one square,
-        // update the to square to be the correct square for a regular castling move
-        if (!chess960 && move.typeOf() == Move::CASTLING) {
-            to_sq = Square(to_sq > from_sq ? File::FILE_G : File::FILE_C, from_sq.rank());
-        }
-
-        std::stringstream ss;
-
-        // Add the from and to squares to the string stream
-        ss << from_sq;
-        ss << to_sq;
+        std::string uci;
+        writeUci(move, uci, chess960);
+        return uci;
+    }
 
-        // If the move is a promotion, add the promoted piece to the string stream
-        if (move.typeOf() == Move::PROMOTION) {
-            ss << static_cast<std::string>(move.promotionType());
-        }
+    /// @brief Appends the UCI string of a move to `str`.
+    /// @param move
+    /// @param str
+    /// @param chess960
+    static void moveToUci(const Move &move, std::string &str, bool chess960 = false) {
+        writeUci(move, str, chess960);
+    }
 
-        return ss.str();
+    /// @brief Writes the null-terminated UCI string of a move to `buffer`, which has to hold
+    /// MAX_MOVE_LENGTH + 1 characters.
+    /// @param move
+    /// @param buffer
+    /// @param chess960
+    /// @return the number of characters written, without the terminating null
+    static std::size_t moveToUci(const Move &move, char *buffer, bool chess960 = false) {
+        BufferWriter writer{buffer};
+        writeUci(move, writer, chess960);
+        return writer.finish(buffer);
     }
 
     /// @brief Converts a UCI string to an internal move.
@@ -107,20 +112,59 @@ class uci {
     /// @return
     [[nodiscard]] static std::string moveToSan(const Board &board, const Move &move) noexcept(false) {
         std::string san;
-        moveToRep<false>(board, move, san);
+        Board scratch = board;
+        writeRep<false>(scratch, move, san);
         return san;
     }
 
+    /// @brief Appends the SAN string of a move to `str`. The move is made and unmade on `board`
+    /// for the check and mate suffixes, which leaves it as it was.
+    /// @param board
+    /// @param move
+    /// @param str
+    static void moveToSan(Board &board, const Move &move, std::string &str) { writeRep<false>(board, move, str); }
+
+    /// @brief Writes the null-terminated SAN string of a move to `buffer`, which has to hold
+    /// MAX_MOVE_LENGTH + 1 characters. The move is made and unmade on `board`.
+    /// @param board
+    /// @param move
+    /// @param buffer
+    /// @return the number of characters written, without the terminating null
+    static std::size_t moveToSan(Board &board, const Move &move, char *buffer) {
+        BufferWriter writer{buffer};
+        writeRep<false>(board, move, writer);
+        return writer.finish(buffer);
+    }
+
     /// @brief static a move to a LAN string
     /// @param board
     /// @param move
     /// @return
     [[nodiscard]] static std::string moveToLan(const Board &board, const Move &move) noexcept(false) {
         std::string lan;
-        moveToRep<true>(board, move, lan);
+        Board scratch = board;
+        writeRep<true>(scratch, move, lan);
         return lan;
     }
 
+    /// @brief Appends the LAN string of a move to `str`, see moveToSan(Board &, const Move &, std::string &).
+    /// @param board
+    /// @param move
+    /// @param str
+    static void moveToLan(Board &board, const Move &move, std::string &str) { writeRep<true>(board, move, str); }
+
+    /// @brief Writes the null-terminated LAN string of a move to `buffer`, see
+    /// moveToSan(Board &, const Move &, char *).
+    /// @param board
+    /// @param move
+    /// @param buffer
+    /// @return the number of characters written, without the terminating null
+    static std::size_t moveToLan(Board &board, const Move &move, char *buffer) {
+        BufferWriter writer{buffer};
+        writeRep<true>(board, move, writer);
+        return writer.finish(buffer);
+    }
+
     class SanParseError : public std::exception {
        public:
         explicit SanParseError(const char *message) : msg_(message) {}
@@ -231,6 +275,115 @@ class uci {
         throw SanParseError("Failed to parse san. At step 3: " + std::string(san) + " " + board.getFen());
     }
 
+    /// @brief Converts a SAN string to a move like parseSan, but never throws or allocates. Instead of
+    /// generating the legal moves, only the pieces of the parsed type that reach the target square are
+    /// looked at, each checked for leaving its king attacked.
+    /// @param board
+    /// @param san
+    /// @return the move, std::nullopt if the SAN is malformed or no legal move matches it
+    [[nodiscard]] static std::optional<Move> parseSanFast(const Board &board, std::string_view san) noexcept {
+        SanMoveInformation info;
+
+        if (san.empty() || parseSanInfo(san, info)) {
+            return std::nullopt;
+        }
+
+        const auto c = board.sideToMove();
+
+        if (info.castling_short || info.castling_long) {
+            Movelist moves;
+            movegen::legalmoves<movegen::MoveGenType::QUIET>(moves, board, PieceGenType::KING);
+
+            for (const auto &move : moves) {
+                if (move.typeOf() == Move::CASTLING && (move.to() > move.from()) == info.castling_short) {
+                    return move;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        const auto to     = info.to;
+        const auto target = board.at(to);
+        const bool pawn   = info.piece == PieceType::PAWN;
+        const bool ep     = pawn && info.capture && to == board.enpassantSq();
+
+        // a capture needs an enemy piece on the target square, any other move an empty one
+        if (info.capture ? !ep && (target == Piece::NONE || target.color() == c) : target != Piece::NONE) {
+            return std::nullopt;
+        }
+
+        const bool promotion = pawn && Square::back_rank(to, ~c);
+
+        if (info.promotion != PieceType::NONE && !promotion) {
+            return std::nullopt;
+        }
+
+        const auto occ = board.occ();
+        Bitboard from;
+
+        switch (info.piece.internal()) {
+            case PieceType::underlying::PAWN:
+                if (info.capture) {
+                    from = attacks::pawn(~c, to);
+                } else if (!Square::back_rank(to, c)) {
+                    const auto single = Square(to.index() + (c == Color::WHITE ? -8 : 8));
+                    const auto rank   = c == Color::WHITE ? Rank::RANK_4 : Rank::RANK_5;
+
+                    from = Bitboard::fromSquare(single);
+
+                    if (board.at(single) == Piece::NONE && to.rank() == rank) {
+                        from = Bitboard::fromSquare(Square(to.index() + (c == Color::WHITE ? -16 : 16)));
+                    }
+                }
+                break;
+            case PieceType::underlying::KNIGHT:
+                from = attacks::knight(to);
+                break;
+            case PieceType::underlying::BISHOP:
+                from = attacks::bishop(to, occ);
+                break;
+            case PieceType::underlying::ROOK:
+                from = attacks::rook(to, occ);
+                break;
+            case PieceType::underlying::QUEEN:
+                from = attacks::queen(to, occ);
+                break;
+            case PieceType::underlying::KING:
+                from = attacks::king(to);
+                break;
+            default:
+                return std::nullopt;
+        }
+
+        from &= board.pieces(info.piece, c);
+
+        if (info.from_file != File::NO_FILE) from &= Bitboard(info.from_file);
+        if (info.from_rank != Rank::NO_RANK) from &= Bitboard(info.from_rank);
+
+        // the captured piece no longer attacks, and the squares it and the moving piece leave are empty
+        const auto captured = Bitboard::fromSquare(ep ? to.ep_square() : to);
+        const auto king_sq  = board.kingSq(c);
+        const auto occ_to   = (occ | Bitboard::fromSquare(to)) & ~(ep ? captured : Bitboard(0));
+
+        // in the order legalmoves() would have them, a missing promotion piece is a queen like in parseSan
+        while (from) {
+            const auto sq   = Square(from.pop());
+            const auto king = sq == king_sq ? to : king_sq;
+
+            if (movegen::attackers(board, ~c, king, occ_to ^ Bitboard::fromSquare(sq)) & ~captured) continue;
+
+            if (promotion) {
+                return Move::make<Move::PROMOTION>(
+                    sq, to, info.promotion == PieceType::NONE ? PieceType(PieceType::QUEEN) : info.promotion);
+            }
+
+            return ep ? Move::make<Move::ENPASSANT>(sq, to) : Move::make<Move::NORMAL>(sq, to);
+        }
+
+        return std::nullopt;
+    }
+
    private:
     struct SanMoveInformation {
         File from_file = File::NO_FILE;
@@ -251,10 +404,20 @@ class uci {
 
     template <bool PEDANTIC = false>
     [[nodiscard]] static SanMoveInformation parseSanInfo(std::string_view san) noexcept(false) {
-        if constexpr (PEDANTIC) {
-            if (san.length() < 2) {
-                throw SanParseError("Failed to parse san. At step 0: " + std::string(san));
-            }
+        SanMoveInformation info;
+
+        if (const auto error = parseSanInfo<PEDANTIC>(san, info)) {
+            throw SanParseError(error + std::string(san));
+        }
+
+        return info;
+    }
+
+    // Fills `info` from the SAN string, returns the start of the error message if it is malformed.
+    template <bool PEDANTIC = false>
+    [[nodiscard]] static const char *parseSanInfo(std::string_view san, SanMoveInformation &info) noexcept {
+        if (san.length() < (PEDANTIC ? 2 : 1)) {
+            return "Failed to parse san. At step 0: ";
         }
 
         constexpr auto parse_castle = [](std::string_view &san, SanMoveInformation &info, char castling_char) {
@@ -272,14 +435,15 @@ class uci {
         constexpr auto isRank = [](char c) { return c >= '1' && c <= '8'; };
         constexpr auto isFile = [](char c) { return c >= 'a' && c <= 'h'; };
         constexpr auto sw     = [](const char &c) { return std::string_view(&c, 1); };
-        SanMoveInformation info;
 
         // set to 1 to skip piece type offset
         std::size_t index = 1;
 
         if (san[0] == 'O' || san[0] == '0') {
+            if (san.length() < 3) return "Failed to parse san. At step 0: ";
+
             parse_castle(san, info, san[0]);
-            return info;
+            return nullptr;
         } else if (isFile(san[0])) {
             index--;
             info.piece = PieceType::PAWN;
@@ -323,11 +487,12 @@ class uci {
         // promotion
         if (index < san.size() && san[index] == '=') {
             index++;
-            info.promotion = PieceType(sw(san[index]));
+
+            if (index < san.size()) info.promotion = PieceType(sw(san[index]));
 
             if (info.promotion == PieceType::KING || info.promotion == PieceType::PAWN ||
                 info.promotion == PieceType::NONE)
-                throw SanParseError("Failed to parse promotion, during san conversion." + std::string(san));
+                return "Failed to parse promotion, during san conversion.";
 
             index++;
         }
@@ -342,6 +507,10 @@ class uci {
             info.from_rank = Rank::NO_RANK;
         }
 
+        if (file_to == File::NO_FILE || rank_to == Rank::NO_RANK) {
+            return "Failed to parse san. At step 1: ";
+        }
+
         // pawns which are not capturing stay on the same file
         if (info.piece == PieceType::PAWN && info.from_file == File::NO_FILE && !info.capture) {
             info.from_file = file_to;
@@ -353,13 +522,65 @@ class uci {
             info.from = Square(info.from_file, info.from_rank);
         }
 
-        return info;
+        return nullptr;
+    }
+
+    // Appends to a caller's buffer like std::string::operator+= does, without any bounds checks.
+    struct BufferWriter {
+        char *end;
+
+        BufferWriter &operator+=(char c) {
+            *end++ = c;
+            return *this;
+        }
+
+        std::size_t finish(const char *begin) {
+            *end = '\0';
+            return static_cast<std::size_t>(end - begin);
+        }
+    };
+
+    static constexpr char PIECE_CHARS[] = "PNBRQK";
+
+    template <typename Out>
+    static void writeSquare(Square sq, Out &out) {
+        out += static_cast<char>('a' + static_cast<int>(sq.file()));
+        out += static_cast<char>('1' + static_cast<int>(sq.rank()));
     }
 
-    template <bool LAN = false>
-    static void moveToRep(Board board, const Move &move, std::string &str) {
+    template <typename Out>
+    static void writeUci(const Move &move, Out &out, bool chess960) {
+        Square from_sq = move.from();
+        Square to_sq   = move.to();
+
+        // If the move is not a chess960 castling move and is a king moving more than one square,
+        // update the to square to be the correct square for a regular castling move
+        if (!chess960 && move.typeOf() == Move::CASTLING) {
+            to_sq = Square(to_sq > from_sq ? File::FILE_G : File::FILE_C, from_sq.rank());
+        }
+
+        writeSquare(from_sq, out);
+        writeSquare(to_sq, out);
+
+        // If the move is a promotion, add the promoted piece in lower case
+        if (move.typeOf() == Move::PROMOTION) {
+            out += static_cast<char>(PIECE_CHARS[static_cast<int>(move.promotionType())] - 'A' + 'a');
+        }
+    }
+
+    template <bool LAN, typename Out>
+    static void writeRep(Board &board, const Move &move, Out &str) {
         if (move.typeOf() == Move::CASTLING) {
-            str = move.to() > move.from() ? "O-O" : "O-O-O";
+            str += 'O';
+            str += '-';
+            str += 'O';
+
+            if (move.to() < move.from()) {
+                str += '-';
+                str += 'O';
+            }
+
+            writeCheckSuffix(board, move, str);
             return;
         }
 
@@ -368,60 +589,56 @@ class uci {
         assert(pt != PieceType::NONE);
 
         if (pt != PieceType::PAWN) {
-            str += std::toupper(static_cast<std::string>(pt)[0]);
+            str += PIECE_CHARS[static_cast<int>(pt)];
         }
 
         if constexpr (LAN) {
-            str += static_cast<std::string>(move.from().file());
-            str += static_cast<std::string>(move.from().rank());
-        } else {
+            writeSquare(move.from(), str);
+        } else if (pt != PieceType::PAWN) {
+            // only moves of the same piece type can be ambiguous
             Movelist moves;
-            movegen::legalmoves(moves, board);
+            movegen::legalmoves(moves, board, 1 << pt);
 
             for (const auto &m : moves) {
-                // check for ambiguity
-                if (pt != PieceType::PAWN && m != move && board.at(m.from()) == board.at(move.from()) &&
-                    m.to() == move.to()) {
+                if (m != move && m.to() == move.to()) {
                     if (m.from().file() == move.from().file()) {
-                        str += static_cast<std::string>(move.from().rank());
-                        break;
+                        str += static_cast<char>('1' + static_cast<int>(move.from().rank()));
                     } else {
-                        str += static_cast<std::string>(move.from().file());
-                        break;
+                        str += static_cast<char>('a' + static_cast<int>(move.from().file()));
                     }
+
+                    break;
                 }
             }
         }
 
         if (board.at(move.to()) != Piece::NONE || move.typeOf() == Move::ENPASSANT) {
-            if (pt == PieceType::PAWN) {
-                str += static_cast<std::string>(move.from().file());
+            if (pt == PieceType::PAWN && !LAN) {
+                str += static_cast<char>('a' + static_cast<int>(move.from().file()));
             }
 
             str += 'x';
         }
 
-        str += static_cast<std::string>(move.to().file());
-        str += static_cast<std::string>(move.to().rank());
+        writeSquare(move.to(), str);
 
         if (move.typeOf() == Move::PROMOTION) {
-            const auto promotion_pt = static_cast<std::string>(move.promotionType());
-
             str += '=';
-            str += std::toupper(promotion_pt[0]);
+            str += PIECE_CHARS[static_cast<int>(move.promotionType())];
         }
 
+        writeCheckSuffix(board, move, str);
+    }
+
+    template <typename Out>
+    static void writeCheckSuffix(Board &board, const Move &move, Out &str) {
         board.makeMove(move);
 
-        if (!board.inCheck()) {
-            return;
+        if (board.inCheck()) {
+            str += movegen::hasLegalMove(board) ? '+' : '#';
         }
 
-        if (board.isGameOver().second == GameResult::LOSE) {
-            str += '#';
-        } else {
-            str += '+';
-        }
+        board.unmakeMove(move);
     }
 };
 }  // namespace chess
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 #include "coords.hpp"
@@ -214,6 +215,9 @@ class Zobrist {
 
    public:
     friend class Board;
+
+    template <typename Derived, std::size_t MaxPly>
+    friend class BasicPosition;
 };
 
 }  // namespace chess
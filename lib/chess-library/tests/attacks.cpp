@@ -0,0 +1,82 @@
+#include <chrono>
+#include <random>
+#include <sstream>
+
+#include "../src/include.hpp"
+#include "doctest/doctest.hpp"
+
+using namespace chess;
+using namespace std::chrono;
+
+// Walks the rays square by square, the slow way the tables are checked against.
+static Bitboard rays(Square sq, Bitboard occupied, const int (&dirs)[4][2]) {
+    Bitboard attacks;
+
+    for (const auto& dir : dirs) {
+        int f = (sq.index() & 7) + dir[0];
+        int r = (sq.index() >> 3) + dir[1];
+
+        while (f >= 0 && f < 8 && r >= 0 && r < 8) {
+            const auto to = Square(r * 8 + f);
+            attacks.set(to.index());
+            if (occupied.check(to.index())) break;
+            f += dir[0];
+            r += dir[1];
+        }
+    }
+
+    return attacks;
+}
+
+static constexpr int ROOK_DIRS[4][2]   = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+static constexpr int BISHOP_DIRS[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+TEST_SUITE("Attacks") {
+    TEST_CASE("Slider attacks match the rays") {
+        std::mt19937_64 rng(42);
+
+        for (int sq = 0; sq < 64; sq++) {
+            int mismatches = 0;
+
+            for (int i = 0; i < 2000; i++) {
+                // sparse and dense occupancies
+                const auto occupied = Bitboard(i & 1 ? rng() & rng() : rng());
+                const auto rook     = attacks::rook(Square(sq), occupied);
+                const auto bishop   = attacks::bishop(Square(sq), occupied);
+
+                mismatches += rook != rays(Square(sq), occupied, ROOK_DIRS);
+                mismatches += bishop != rays(Square(sq), occupied, BISHOP_DIRS);
+                mismatches += attacks::queen(Square(sq), occupied) != (rook | bishop);
+            }
+
+            CHECK(mismatches == 0);
+        }
+    }
+
+    TEST_CASE("Slider attacks benchmark") {
+        std::mt19937_64 rng(42);
+        std::vector<Bitboard> occupancies(4096);
+
+        for (auto& occupied : occupancies) occupied = Bitboard(rng() & rng());
+
+        uint64_t sum    = 0;
+        const auto t1   = high_resolution_clock::now();
+        const int loops = 5000;
+
+        for (int i = 0; i < loops; i++) {
+            for (const auto& occupied : occupancies) {
+                const auto sq = Square(int(occupied.getBits() & 63));
+                sum += attacks::rook(sq, occupied).getBits() ^ attacks::bishop(sq, occupied).getBits();
+            }
+        }
+
+        const auto t2 = high_resolution_clock::now();
+
+        CHECK(sum != 0);
+
+        std::stringstream ss;
+        ss << (CHESS_USE_PEXT ? "pext" : "magic") << " slider lookups x" << 2 * loops * occupancies.size() << " "
+           << duration_cast<milliseconds>(t2 - t1).count() << " ms";
+        std::cout << ss.str() << std::endl;
+    }
+}
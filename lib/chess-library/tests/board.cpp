@@ -175,6 +175,113 @@ TEST_SUITE("Board") {
         }
     }
 
+    TEST_CASE("Board cached attack info") {
+        const std::string fens[] = {
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"};
+
+        // compares the cached info with a fresh board and with isAttacked()
+        const auto mismatches = [](const Board& board) {
+            const Board fresh(board.getFen());
+            int count = 0;
+
+            count += board.checkers() != fresh.checkers();
+            count += board.pinned() != fresh.pinned();
+            count += board.inCheck() != board.isAttacked(board.kingSq(board.sideToMove()), ~board.sideToMove());
+
+            for (const auto color : {Color::WHITE, Color::BLACK}) {
+                for (int sq = 0; sq < 64; sq++) {
+                    count += board.attackedBy(color).check(sq) != board.isAttacked(Square(sq), color);
+                }
+            }
+
+            return count;
+        };
+
+        int errors = 0;
+
+        for (const auto& fen : fens) {
+            Board board(fen);
+            Movelist moves;
+            movegen::legalmoves(moves, board);
+
+            for (const auto& move : moves) {
+                board.makeMove(move);
+                errors += mismatches(board);
+
+                Movelist replies;
+                movegen::legalmoves(replies, board);
+
+                for (const auto& reply : replies) {
+                    board.makeMove(reply);
+                    errors += mismatches(board);
+                    board.unmakeMove(reply);
+                }
+
+                // restored from the state, not recomputed
+                errors += mismatches(board);
+                board.unmakeMove(move);
+            }
+
+            board.makeNullMove();
+            errors += mismatches(board);
+            board.unmakeNullMove();
+            errors += mismatches(board);
+        }
+
+        CHECK(errors == 0);
+    }
+
+    TEST_CASE("Board pawn and material keys") {
+        const std::string fens[] = {
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"};
+
+        // compares the incremental keys with the ones of a fresh board, down to `depth`
+        const auto mismatches = [](Board& board, int depth, const auto& self) -> int {
+            const Board fresh(board.getFen());
+            int count = (board.pawnKey() != fresh.pawnKey()) + (board.materialKey() != fresh.materialKey());
+
+            if (depth == 0) return count;
+
+            Movelist moves;
+            movegen::legalmoves(moves, board);
+
+            for (const auto& move : moves) {
+                board.makeMove(move);
+                count += self(board, depth - 1, self);
+                board.unmakeMove(move);
+            }
+
+            return count;
+        };
+
+        int errors = 0;
+
+        for (const auto& fen : fens) {
+            Board board(fen);
+            errors += mismatches(board, 3, mismatches);
+            CHECK(board.getFen() == fen);
+        }
+
+        CHECK(errors == 0);
+
+        // the same material on other squares
+        const Board a("4k3/pp6/8/8/8/8/PP3N2/4K3 w - - 0 1");
+        const Board b("4k3/p7/1p6/8/8/3N4/1P5P/K7 b - - 0 1");
+        CHECK(a.materialKey() == b.materialKey());
+        CHECK(a.pawnKey() != b.pawnKey());
+
+        // the same pawns with other pieces
+        const Board c("4k3/pp6/8/8/8/8/PP3B2/4K3 w - - 0 1");
+        CHECK(a.pawnKey() == c.pawnKey());
+        CHECK(a.materialKey() != c.materialKey());
+    }
+
     TEST_CASE("PackedBoard") {
         SUBCASE("encode and decode ") {
             Board board     = Board("4k1n1/pppppppp/8/8/8/8/PPPPPPPP/4K3 w - - 0 1");
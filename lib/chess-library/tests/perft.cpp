@@ -30,6 +30,113 @@ class Perft {
         return nodes;
     }
 
+    // Same as perft, but with pseudo-legal moves that are checked before they are played.
+    uint64_t perftPseudo(int depth) {
+        Movelist moves;
+        movegen::pseudolegalmoves(moves, board_);
+
+        uint64_t nodes = 0;
+
+        for (const auto& move : moves) {
+            if (!board_.isLegal(move)) continue;
+
+            if (depth == 1) {
+                nodes++;
+                continue;
+            }
+
+            board_.makeMove<true>(move);
+            nodes += perftPseudo(depth - 1);
+            board_.unmakeMove(move);
+        }
+
+        return nodes;
+    }
+
+    void comparePseudo(Board& board, int depth) {
+        board_ = board;
+
+        const auto t1     = high_resolution_clock::now();
+        const auto legal  = perft(depth);
+        const auto t2     = high_resolution_clock::now();
+        const auto pseudo = perftPseudo(depth);
+        const auto t3     = high_resolution_clock::now();
+
+        std::stringstream ss;
+
+        // clang-format off
+        ss << "depth " << std::left << std::setw(2) << depth
+           << " legal " << std::setw(5) << duration_cast<milliseconds>(t2 - t1).count()
+           << " ms pseudo-legal " << std::setw(5) << duration_cast<milliseconds>(t3 - t2).count()
+           << " ms nodes " << std::setw(12) << legal
+           << " fen " << board_.getFen();
+        // clang-format on
+        std::cout << ss.str() << std::endl;
+
+        CHECK(pseudo == legal);
+    }
+
+    // Same as perft, but counts the moves at the last ply instead of generating them.
+    uint64_t perftCount(int depth) {
+        if (depth == 1) return movegen::countLegalMoves(board_);
+
+        Movelist moves;
+        movegen::legalmoves(moves, board_);
+
+        uint64_t nodes = 0;
+
+        for (const auto& move : moves) {
+            board_.makeMove<true>(move);
+            nodes += perftCount(depth - 1);
+            board_.unmakeMove(move);
+        }
+
+        return nodes;
+    }
+
+    // Number of nodes where countLegalMoves or hasLegalMove disagree with legalmoves.
+    int countMismatches(int depth) {
+        Movelist moves;
+        movegen::legalmoves(moves, board_);
+
+        int mismatches = movegen::countLegalMoves(board_) != moves.size();
+        mismatches += movegen::hasLegalMove(board_) == moves.empty();
+
+        if (depth == 1) return mismatches;
+
+        for (const auto& move : moves) {
+            board_.makeMove<true>(move);
+            mismatches += countMismatches(depth - 1);
+            board_.unmakeMove(move);
+        }
+
+        return mismatches;
+    }
+
+    void compareCount(Board& board, int depth) {
+        board_ = board;
+
+        const auto t1    = high_resolution_clock::now();
+        const auto legal = perft(depth);
+        const auto t2    = high_resolution_clock::now();
+        const auto count = perftCount(depth);
+        const auto t3    = high_resolution_clock::now();
+
+        std::stringstream ss;
+
+        // clang-format off
+        ss << "depth " << std::left << std::setw(2) << depth
+           << " movelist " << std::setw(5) << duration_cast<milliseconds>(t2 - t1).count()
+           << " ms count " << std::setw(5) << duration_cast<milliseconds>(t3 - t2).count()
+           << " ms nodes " << std::setw(12) << legal
+           << " fen " << board_.getFen();
+        // clang-format on
+        std::cout << ss.str() << std::endl;
+
+        CHECK(count == legal);
+        CHECK(countMismatches(depth - 1) == 0);
+    }
+
     void benchPerft(Board& board, int depth, uint64_t expected_node_count) {
         board_ = board;
 
@@ -104,4 +211,80 @@ TEST_SUITE("PERFT") {
             perft.benchPerft(board, test.depth, test.expected_node_count);
         }
     }
+
+    TEST_CASE("Pseudo-legal Move Generation") {
+        const Test test_positions[] = {
+            {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0, 5},
+            {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - ", 0, 4},
+            {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - ", 0, 5},
+            {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 0, 4},
+            {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 0, 4},
+            {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 1", 0, 4},
+            {"7k/4p3/8/2KP3r/8/8/8/8 b - - 0 1", 0, 5}};
+
+        const Test test_positions_960[] = {
+            {"1rqbkrbn/1ppppp1p/1n6/p1N3p1/8/2P4P/PP1PPPP1/1RQBKRBN w FBfb - 0 9", 0, 4},
+            {"4rrb1/1kp3b1/1p1p4/pP1Pn2p/5p2/1PR2P2/2P1NB1P/2KR1B2 w D - 0 21", 0, 4},
+            {"1rkr3b/1ppn3p/3pB1n1/6q1/R2P4/4N1P1/1P5P/2KRQ1B1 b Dbd - 0 14", 0, 4},
+            {"rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 0, 4}};
+
+        Perft perft;
+
+        for (const auto& test : test_positions) {
+            Board board(test.fen);
+            perft.comparePseudo(board, test.depth);
+        }
+
+        for (const auto& test : test_positions_960) {
+            Board board(test.fen);
+            board.set960(true);
+
+            perft.comparePseudo(board, test.depth);
+        }
+    }
+
+    TEST_CASE("Legal Move Counting") {
+        const Test test_positions[] = {
+            {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0, 6},
+            {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - ", 0, 5},
+            {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - ", 0, 6},
+            {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 0, 5},
+            {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 0, 5},
+            {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 1", 0, 5},
+            {"7k/4p3/8/2KP3r/8/8/8/8 b - - 0 1", 0, 6}};
+
+        const Test test_positions_960[] = {
+            {"1rqbkrbn/1ppppp1p/1n6/p1N3p1/8/2P4P/PP1PPPP1/1RQBKRBN w FBfb - 0 9", 0, 5},
+            {"4rrb1/1kp3b1/1p1p4/pP1Pn2p/5p2/1PR2P2/2P1NB1P/2KR1B2 w D - 0 21", 0, 5},
+            {"1rkr3b/1ppn3p/3pB1n1/6q1/R2P4/4N1P1/1P5P/2KRQ1B1 b Dbd - 0 14", 0, 5},
+            {"rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 0, 5}};
+
+        Perft perft;
+
+        for (const auto& test : test_positions) {
+            Board board(test.fen);
+            perft.compareCount(board, test.depth);
+        }
+
+        for (const auto& test : test_positions_960) {
+            Board board(test.fen);
+            board.set960(true);
+
+            perft.compareCount(board, test.depth);
+        }
+
+        // checkmate, stalemate, double check and an en passant capture that blocks a check
+        const std::string fens[] = {"rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3",
+                                    "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1", "4k3/8/8/8/1b6/8/8/r3K3 w - - 0 1",
+                                    "8/8/8/1k6/3Pp3/8/8/4KQ2 b - d3 0 1"};
+
+        for (const auto& fen : fens) {
+            Board board(fen);
+            Movelist moves;
+            movegen::legalmoves(moves, board);
+
+            CHECK(movegen::countLegalMoves(board) == moves.size());
+            CHECK(movegen::hasLegalMove(board) == !moves.empty());
+        }
+    }
 }
@@ -1,7 +1,12 @@
 #include <cassert>
+#include <chrono>
 #include <fstream>
+#include <iomanip>
 #include <memory>
+#include <sstream>
 #include <string_view>
+#include <thread>
+#include <type_traits>
 
 #include "../src/include.hpp"
 #include "doctest/doctest.hpp"
@@ -142,6 +147,30 @@ class MockVisitorGameover : public pgn::Visitor {
     std::pair<GameResultReason, GameResult> game_res_;
 };
 
+// Records every call, over all games, to compare two ways of parsing the same PGN.
+class RecordingVisitor : public pgn::Visitor {
+   public:
+    void startPgn() {
+        events.push_back("start");
+        games++;
+    }
+
+    void header(std::string_view key, std::string_view value) {
+        events.push_back("header " + std::string(key) + " " + std::string(value));
+    }
+
+    void startMoves() { events.push_back("moves"); }
+
+    void move(std::string_view move, std::string_view comment) {
+        events.push_back("move " + std::string(move) + " {" + std::string(comment) + "}");
+    }
+
+    void endPgn() { events.push_back("end"); }
+
+    std::vector<std::string> events;
+    int games = 0;
+};
+
 TEST_SUITE("PGN StreamParser") {
     TEST_CASE("Basic PGN") {
         const auto file  = "./tests/pgns/basic.pgn";
@@ -579,4 +608,119 @@ TEST_SUITE("PGN StreamParser") {
         CHECK(vis->headers()[1] == "Variation closing ] opening");
         CHECK(vis->headers()[5] == "White New-cfe8\"dsadsa\"ce842c");
     }
+
+    TEST_CASE("Parsing from memory matches the stream") {
+        const char* files[] = {"basic.pgn",
+                               "black2move.pgn",
+                               "book.pgn",
+                               "castling.pgn",
+                               "corrupted.pgn",
+                               "multiple.pgn",
+                               "newline.pgn",
+                               "no_moves.pgn",
+                               "no_moves_but_comment_followed_by_termination_marker.pgn",
+                               "no_moves_but_game_termination.pgn",
+                               "no_moves_but_game_termination_multiple.pgn",
+                               "no_moves_two_games.pgn",
+                               "no_result.pgn",
+                               "skip.pgn",
+                               "square_bracket_in_header.pgn",
+                               "threefold_repetition.pgn",
+                               "variations.pgn"};
+
+        for (const auto* name : files) {
+            const auto path  = std::string("./tests/pgns/") + name;
+            auto file_stream = std::ifstream(path);
+
+            RecordingVisitor streamed, mapped;
+            pgn::StreamParser<1>(file_stream).readGames(streamed);
+
+            const pgn::MappedFile file(path);
+            REQUIRE(file.isOpen());
+            pgn::StreamParser<>(file.view()).readGames(mapped);
+
+            CHECK(mapped.events == streamed.events);
+        }
+
+        CHECK(!pgn::MappedFile("./tests/pgns/missing.pgn").isOpen());
+
+        // a file name must not be taken for PGN text
+        static_assert(!std::is_convertible_v<const char*, pgn::StreamParser<>>);
+        static_assert(!std::is_convertible_v<std::string_view, pgn::StreamParser<>>);
+    }
+
+    TEST_CASE("Split at game boundaries") {
+        const std::string pgn =
+            "[Event \"a\"]\n[Result \"1-0\"]\n\n1. e4 { [Event \"no\"] } e5 1-0\n\n"
+            "[Event \"b\"]\n[Result \"0-1\"]\n\n1. d4 0-1\r\n\r\n"
+            "[Event \"c\"]\n[Result \"*\"]\n\n1. c4 *\n";
+
+        const auto b = pgn.find("[Event \"b\"]");
+        const auto c = pgn.find("[Event \"c\"]");
+
+        CHECK(pgn::nextGameStart(pgn, 0) == 0);
+        CHECK(pgn::nextGameStart(pgn, 1) == b);
+        CHECK(pgn::nextGameStart(pgn, b) == b);
+        CHECK(pgn::nextGameStart(pgn, b + 1) == c);
+        CHECK(pgn::nextGameStart(pgn, c + 1) == pgn.size());
+
+        const auto parts = pgn::splitGames(pgn, 8);
+        REQUIRE(parts.size() == 8);
+
+        std::string joined;
+        int games = 0;
+
+        for (const auto& part : parts) {
+            joined += part;
+            games += !part.empty();
+
+            if (!part.empty()) CHECK(part.substr(0, 7) == "[Event ");
+        }
+
+        CHECK(joined == pgn);
+        CHECK(games == 3);
+    }
+
+    TEST_CASE("readGamesParallel keeps the games in order") {
+        std::string games;
+        for (const auto* name : {"basic.pgn", "multiple.pgn", "variations.pgn"}) {
+            std::ifstream in(std::string("./tests/pgns/") + name);
+            games += std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()) + "\n\n";
+        }
+
+        std::string corpus;
+        for (int i = 0; i < 400; i++) corpus += games;
+
+        const auto time_s = [](auto&& f) {
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            f();
+            const auto t2 = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration<double>(t2 - t1).count();
+        };
+
+        RecordingVisitor sequential;
+        const auto sequential_s = time_s([&] { pgn::StreamParser<>(std::string_view(corpus)).readGames(sequential); });
+
+        const auto threads = std::max(2u, std::thread::hardware_concurrency());
+        std::vector<RecordingVisitor> visitors(threads);
+        const auto parallel_s = time_s([&] { pgn::readGamesParallel(corpus, visitors); });
+
+        std::vector<std::string> merged;
+        int games_parallel = 0;
+
+        for (const auto& visitor : visitors) {
+            merged.insert(merged.end(), visitor.events.begin(), visitor.events.end());
+            games_parallel += visitor.games;
+        }
+
+        CHECK(sequential.games == 6 * 400);
+        CHECK(games_parallel == sequential.games);
+        CHECK(merged == sequential.events);
+
+        std::stringstream ss;
+        ss << sequential.games << " games, 1 thread " << std::fixed << std::setprecision(0)
+           << sequential.games / sequential_s << " games/s, " << threads << " threads "
+           << sequential.games / parallel_s << " games/s";
+        std::cout << ss.str() << std::endl;
+    }
 }
@@ -0,0 +1,277 @@
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+#include "../src/include.hpp"
+#include "doctest/doctest.hpp"
+
+using namespace chess;
+using namespace std::chrono;
+
+template <typename BoardType>
+static uint64_t perft(BoardType& board, int depth) {
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+
+    if (depth == 1) return moves.size();
+
+    uint64_t nodes = 0;
+
+    for (const auto& move : moves) {
+        board.template makeMove<true>(move);
+        nodes += perft(board, depth - 1);
+        board.unmakeMove(move);
+    }
+
+    return nodes;
+}
+
+// Same as perft, but copies the position instead of unmaking the move.
+template <typename BoardType>
+static uint64_t perftCopyMake(const BoardType& board, int depth) {
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+
+    if (depth == 1) return moves.size();
+
+    uint64_t nodes = 0;
+
+    for (const auto& move : moves) {
+        BoardType copy = board;
+        copy.template makeMove<true>(move);
+        nodes += perftCopyMake(copy, depth - 1);
+    }
+
+    return nodes;
+}
+
+template <typename F>
+static int64_t timeMs(F&& f) {
+    const auto t1 = high_resolution_clock::now();
+    f();
+    const auto t2 = high_resolution_clock::now();
+    return duration_cast<milliseconds>(t2 - t1).count();
+}
+
+// Like Position, but counts the pieces through the hooks.
+class CountingPosition : public BasicPosition<CountingPosition> {
+   public:
+    explicit CountingPosition(std::string_view fen) : BasicPosition(fen) { onSetFen(); }
+
+    int count = 0;
+
+   private:
+    friend class BasicPosition<CountingPosition>;
+
+    void onPlacePiece(Piece, Square) { count++; }
+    void onRemovePiece(Piece, Square) { count--; }
+    void onSetFen() { count = occ().count(); }
+};
+
+TEST_SUITE("Position") {
+    TEST_CASE("Position matches Board") {
+        const std::string fens[] = {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+            "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"};
+
+        for (const auto& fen : fens) {
+            Board board(fen);
+            Position position(fen);
+
+            CHECK(position.getFen() == fen);
+            CHECK(position.hash() == board.hash());
+            CHECK(position.hash() == position.zobrist());
+            CHECK(perft(position, 3) == perft(board, 3));
+        }
+    }
+
+    TEST_CASE("Position makeMove/unmakeMove keeps the hash") {
+        Position position("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+        Board board(position.getFen());
+
+        Movelist moves;
+        movegen::legalmoves(moves, position);
+
+        for (const auto& move : moves) {
+            position.makeMove(move);
+            board.makeMove(move);
+
+            CHECK(position.hash() == position.zobrist());
+            CHECK(position.hash() == board.hash());
+            CHECK(position.pawnKey() == board.pawnKey());
+            CHECK(position.materialKey() == board.materialKey());
+            CHECK(position.getFen() == board.getFen());
+
+            position.unmakeMove(move);
+            board.unmakeMove(move);
+        }
+
+        CHECK(position.getFen() == board.getFen());
+        CHECK(position.historySize() == 0);
+    }
+
+    TEST_CASE("Position copy-make") {
+        Position position;
+        Position copy = position;
+
+        copy.makeMove(uci::uciToMove(position.toBoard(), "e2e4"));
+
+        CHECK(position.getFen() == constants::STARTPOS);
+        CHECK(copy.getFen() == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+        CHECK(copy.historySize() == 1);
+        CHECK(perftCopyMake(position, 4) == 197281);
+    }
+
+    TEST_CASE("Position repetition and game over") {
+        Position position;
+        const char* moves[] = {"g1f3", "g8f6", "f3g1", "f6g8", "g1f3", "g8f6", "f3g1", "f6g8"};
+
+        for (const auto* uci_move : moves) {
+            CHECK(!position.isRepetition());
+            position.makeMove(uci::uciToMove(position.toBoard(), uci_move));
+        }
+
+        CHECK(position.isRepetition());
+        CHECK(position.isGameOver().first == GameResultReason::THREEFOLD_REPETITION);
+
+        Position mate("rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3");
+        CHECK(mate.inCheck());
+        CHECK(mate.isGameOver() == std::pair{GameResultReason::CHECKMATE, GameResult::LOSE});
+    }
+
+    TEST_CASE("Position exact enpassant") {
+        // the e7e5 double push can't be taken en passant, the d5 pawn is pinned against the king
+        Position position("7k/4p3/8/2KP3r/8/8/8/8 b - - 0 1");
+        Board board(position.getFen());
+
+        position.makeMove<true>(Move::make(Square::underlying::SQ_E7, Square::underlying::SQ_E5));
+        board.makeMove<true>(Move::make(Square::underlying::SQ_E7, Square::underlying::SQ_E5));
+
+        CHECK(position.enpassantSq() == Square::underlying::NO_SQ);
+        CHECK(position.hash() == board.hash());
+    }
+
+    TEST_CASE("Position pseudo-legal moves") {
+        Position position("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+        Movelist moves;
+        movegen::legalmoves(moves, position);
+
+        for (const auto& move : moves) {
+            position.makeMove(move);
+
+            Movelist legal, pseudo;
+            movegen::legalmoves(legal, position);
+            movegen::pseudolegalmoves(pseudo, position);
+
+            const auto count = std::count_if(pseudo.begin(), pseudo.end(),
+                                             [&](const Move& m) { return position.isLegal(m); });
+            CHECK(count == legal.size());
+
+            position.unmakeMove(move);
+        }
+    }
+
+    TEST_CASE("Position plays past MaxPly") {
+        Position position;
+        Board board;
+
+        // the knights shuffle back and forth, every position repeats and nothing resets the clock
+        const char* cycle[] = {"g1f3", "g8f6", "f3g1", "f6g8"};
+
+        std::vector<Move> played;
+
+        for (int ply = 0; ply < 600; ply++) {
+            const auto move = uci::uciToMove(board, cycle[ply % 4]);
+            played.push_back(move);
+
+            position.makeMove(move);
+            board.makeMove(move);
+
+            CHECK(position.historySize() <= 256);
+            CHECK(position.hash() == board.hash());
+            CHECK(position.isRepetition() == board.isRepetition());
+        }
+
+        CHECK(position.getFen() == board.getFen());
+
+        // the newest moves can still be unmade
+        for (int ply = 599; ply >= 500; ply--) {
+            position.unmakeMove(played[ply]);
+            board.unmakeMove(played[ply]);
+            CHECK(position.hash() == board.hash());
+        }
+
+        CHECK(position.getFen() == board.getFen());
+    }
+
+    TEST_CASE("Position hooks") {
+        CountingPosition position("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+        Movelist moves;
+        movegen::legalmoves(moves, position);
+
+        for (const auto& move : moves) {
+            position.makeMove(move);
+            CHECK(position.count == position.occ().count());
+            position.unmakeMove(move);
+        }
+
+        position.setFen(constants::STARTPOS);
+        CHECK(position.count == 32);
+    }
+
+    TEST_CASE("Position benchmark against Board") {
+        const std::string fen = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+        const int depth       = 4;
+        const int repeats     = 200000;
+
+        Board board(fen);
+        Position position(fen);
+        uint64_t board_nodes = 0, position_nodes = 0, copy_nodes = 0;
+
+        const auto board_ms    = timeMs([&] { board_nodes = perft(board, depth); });
+        const auto position_ms = timeMs([&] { position_nodes = perft(position, depth); });
+        const auto copy_ms     = timeMs([&] { copy_nodes = perftCopyMake(position, depth); });
+
+        CHECK(board_nodes == 4085603);
+        CHECK(position_nodes == board_nodes);
+        CHECK(copy_nodes == board_nodes);
+
+        Movelist moves;
+        movegen::legalmoves(moves, board);
+
+        const auto board_make_ms = timeMs([&] {
+            for (int i = 0; i < repeats; i++) {
+                for (const auto& move : moves) {
+                    board.makeMove(move);
+                    board.unmakeMove(move);
+                }
+            }
+        });
+
+        const auto position_make_ms = timeMs([&] {
+            for (int i = 0; i < repeats; i++) {
+                for (const auto& move : moves) {
+                    position.makeMove(move);
+                    position.unmakeMove(move);
+                }
+            }
+        });
+
+        CHECK(board.getFen() == position.getFen());
+
+        std::stringstream ss;
+        // clang-format off
+        ss << "perft " << depth << " Board " << board_ms << " ms, Position " << position_ms
+           << " ms, Position copy-make " << copy_ms << " ms\n"
+           << "make/unmake x" << repeats * moves.size() << " Board " << board_make_ms
+           << " ms, Position " << position_make_ms << " ms";
+        // clang-format on
+        std::cout << ss.str() << std::endl;
+    }
+}
@@ -1,8 +1,58 @@
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
 #include "../src/include.hpp"
 #include "doctest/doctest.hpp"
 
 using namespace chess;
 
+// Replays the games of a PGN with either SAN parser.
+template <bool FAST>
+class ReplayVisitor : public pgn::Visitor {
+   public:
+    void startPgn() { board_.setFen(constants::STARTPOS); }
+
+    void header(std::string_view key, std::string_view value) {
+        if (key == "FEN") board_.setFen(value);
+    }
+
+    void startMoves() {}
+
+    void move(std::string_view san, std::string_view) {
+        Move move = Move::NO_MOVE;
+
+        if constexpr (FAST) {
+            move = uci::parseSanFast(board_, san).value_or(Move::NO_MOVE);
+        } else {
+            try {
+                move = uci::parseSan(board_, san, moves_);
+            } catch (const uci::SanParseError&) {
+            }
+        }
+
+        if (move == Move::NO_MOVE) {
+            errors++;
+            skipPgn(true);
+            return;
+        }
+
+        board_.makeMove(move);
+        plies++;
+    }
+
+    void endPgn() { games++; }
+
+    int games  = 0;
+    int plies  = 0;
+    int errors = 0;
+
+   private:
+    Board board_;
+    Movelist moves_;
+};
+
 TEST_SUITE("SAN Parser") {
     TEST_CASE("Test ambiguous pawn capture") {
         Board b;
@@ -246,4 +296,229 @@ TEST_SUITE("SAN Parser") {
 
         CHECK(uci::parseSan(b, "") == Move::NO_MOVE);
     }
-}
\ No newline at end of file
+
+    TEST_CASE("parseSanFast matches parseSan") {
+        const std::string fens[] = {
+            constants::STARTPOS,
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "8/8/5K2/2N3P1/3N3n/1b2k3/3N4/7r w - - 59 97"};
+
+        int errors = 0;
+
+        const auto check = [&](const Board& board, const Move& move) {
+            const auto san  = uci::moveToSan(board, move);
+            const auto fast = uci::parseSanFast(board, san);
+
+            errors += !fast || *fast != move || uci::parseSan(board, san) != move;
+        };
+
+        for (const auto& fen : fens) {
+            Board board(fen);
+            Movelist moves;
+            movegen::legalmoves(moves, board);
+
+            for (const auto& move : moves) {
+                check(board, move);
+                board.makeMove(move);
+
+                Movelist replies;
+                movegen::legalmoves(replies, board);
+                for (const auto& reply : replies) check(board, reply);
+
+                board.unmakeMove(move);
+            }
+        }
+
+        CHECK(errors == 0);
+
+        // over-specified and sloppy forms parseSan accepts as well
+        Board b("8/8/5K2/2N3P1/3N3n/1b2k3/3N4/7r w - - 59 97");
+        CHECK(uci::parseSanFast(b, "Nd4xb3") == Move::make(Square::underlying::SQ_D4, Square::underlying::SQ_B3));
+        CHECK(uci::parseSanFast(b, "Nd4xb3+") == uci::parseSan(b, "Nd4xb3+"));
+
+        b.setFen("8/1P6/8/8/8/8/8/K6k w - - 0 1");
+        CHECK(uci::parseSanFast(b, "b8") == uci::parseSan(b, "b8"));
+        CHECK(uci::parseSanFast(b, "b8=N") ==
+              Move::make<Move::PROMOTION>(Square::underlying::SQ_B7, Square::underlying::SQ_B8, PieceType::KNIGHT));
+
+        b.setFen("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1");
+        CHECK(uci::parseSanFast(b, "O-O-O") == uci::parseSan(b, "O-O-O"));
+        CHECK(uci::parseSanFast(b, "0-0+") == uci::parseSan(b, "0-0+"));
+    }
+
+    TEST_CASE("parseSanFast rejects without throwing") {
+        Board b("rnbqkbnr/pppp1ppp/8/8/3pP3/8/PPP2PPP/RNBQKBNR b KQkq e3 0 3");
+
+        const char* bad[] = {"", "O", "O-", "Z", "N3", "Nf", "e9", "d3=", "d3=K", "--", "Nf3", "Kd7",
+                             "exf3", "Bxe7", "Qd6", "O-O", "dxe3=Q", "d1"};
+
+        for (const auto* san : bad) {
+            CHECK(!uci::parseSanFast(b, san).has_value());
+        }
+
+        CHECK(uci::parseSanFast(b, "dxe3") == Move::make<Move::ENPASSANT>(Square::underlying::SQ_D4,
+                                                                          Square::underlying::SQ_E3));
+    }
+
+    TEST_CASE("SAN parser throughput") {
+        const char* files[] = {"tests/pgns/basic.pgn", "tests/pgns/multiple.pgn"};
+        const int repeats   = 500;
+
+        std::string games;
+        for (const auto* file : files) {
+            std::ifstream in(file);
+            games += std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()) + "\n\n";
+        }
+
+        std::string corpus;
+        for (int i = 0; i < repeats; i++) corpus += games;
+
+        const auto replay = [&](auto& visitor) {
+            std::istringstream stream(corpus);
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            pgn::StreamParser(stream).readGames(visitor);
+            const auto t2 = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration<double>(t2 - t1).count();
+        };
+
+        ReplayVisitor<false> slow;
+        ReplayVisitor<true> fast;
+
+        const auto slow_s = replay(slow);
+        const auto fast_s = replay(fast);
+
+        CHECK(slow.games == 5 * repeats);
+        CHECK(slow.errors == 0);
+        CHECK(fast.games == slow.games);
+        CHECK(fast.plies == slow.plies);
+        CHECK(fast.errors == 0);
+
+        std::stringstream ss;
+        ss << slow.games << " games, " << slow.plies << " plies: parseSan " << std::fixed << std::setprecision(0)
+           << slow.games / slow_s << " games/s, parseSanFast " << fast.games / fast_s << " games/s";
+        std::cout << ss.str() << std::endl;
+    }
+}
+TEST_SUITE("Move Formatting") {
+    TEST_CASE("Buffer and append overloads match the string functions") {
+        const std::string fens[] = {
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"};
+
+        int errors = 0;
+
+        const auto check = [&](Board& board, const Move& move) {
+            const auto hash = board.hash();
+            char buffer[uci::MAX_MOVE_LENGTH + 1];
+
+            const auto san = uci::moveToSan(board, move);
+            std::string appended = "1. ";
+            uci::moveToSan(board, move, appended);
+            errors += appended != "1. " + san;
+            errors += uci::moveToSan(board, move, buffer) != san.size() || san != buffer;
+            errors += uci::parseSan(board, san) != move;
+
+            const auto lan = uci::moveToLan(board, move);
+            appended.clear();
+            uci::moveToLan(board, move, appended);
+            errors += appended != lan;
+            errors += uci::moveToLan(board, move, buffer) != lan.size() || lan != buffer;
+
+            const auto uci = uci::moveToUci(move);
+            appended.clear();
+            uci::moveToUci(move, appended);
+            errors += appended != uci;
+            errors += uci::moveToUci(move, buffer) != uci.size() || uci != buffer;
+            errors += uci::uciToMove(board, uci) != move;
+
+            errors += board.hash() != hash;
+        };
+
+        for (const auto& fen : fens) {
+            Board board(fen);
+            Movelist moves;
+            movegen::legalmoves(moves, board);
+
+            for (const auto& move : moves) {
+                check(board, move);
+                board.makeMove(move);
+
+                Movelist replies;
+                movegen::legalmoves(replies, board);
+                for (const auto& reply : replies) check(board, reply);
+
+                board.unmakeMove(move);
+            }
+
+            CHECK(board.getFen() == fen);
+        }
+
+        CHECK(errors == 0);
+    }
+
+    TEST_CASE("Castling with check and LAN captures") {
+        Board board("5k2/8/8/8/8/8/8/4K2R w K - 0 1");
+        const Move castle = Move::make<Move::CASTLING>(Square::underlying::SQ_E1, Square::underlying::SQ_H1);
+
+        CHECK(uci::moveToSan(board, castle) == "O-O+");
+        CHECK(uci::moveToUci(castle) == "e1g1");
+
+        board.setFen("rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2");
+        const Move capture = Move::make(Square::underlying::SQ_E4, Square::underlying::SQ_D5);
+
+        CHECK(uci::moveToSan(board, capture) == "exd5");
+        CHECK(uci::moveToLan(board, capture) == "e4xd5");
+
+        board.setFen("3r3k/4P1pp/8/8/8/8/8/K7 w - - 0 1");
+        const Move promotion =
+            Move::make<Move::PROMOTION>(Square::underlying::SQ_E7, Square::underlying::SQ_D8, PieceType::QUEEN);
+
+        char buffer[uci::MAX_MOVE_LENGTH + 1];
+        CHECK(uci::moveToLan(board, promotion, buffer) == uci::MAX_MOVE_LENGTH);
+        CHECK(std::string(buffer) == "e7xd8=Q#");
+    }
+
+    TEST_CASE("Formatting throughput") {
+        Board board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+        const int repeats = 20000;
+
+        Movelist moves;
+        movegen::legalmoves(moves, board);
+
+        const auto time_ms = [](auto&& f) {
+            const auto t1 = std::chrono::high_resolution_clock::now();
+            f();
+            const auto t2 = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration<double, std::milli>(t2 - t1).count();
+        };
+
+        std::size_t string_chars = 0, buffer_chars = 0;
+        char buffer[uci::MAX_MOVE_LENGTH + 1];
+
+        const auto string_ms = time_ms([&] {
+            for (int i = 0; i < repeats; i++) {
+                for (const auto& move : moves) string_chars += uci::moveToSan(board, move).size();
+            }
+        });
+
+        const auto buffer_ms = time_ms([&] {
+            for (int i = 0; i < repeats; i++) {
+                for (const auto& move : moves) buffer_chars += uci::moveToSan(board, move, buffer);
+            }
+        });
+
+        CHECK(string_chars == buffer_chars);
+
+        const auto total = double(repeats) * moves.size();
+
+        std::stringstream ss;
+        ss << "moveToSan " << std::fixed << std::setprecision(0) << total / string_ms * 1000
+           << " moves/s, into a buffer " << total / buffer_ms * 1000 << " moves/s";
+        std::cout << ss.str() << std::endl;
+    }
+}
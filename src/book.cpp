@@ -0,0 +1,174 @@
+#include "book.hpp"
+
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace chess;
+using namespace std;
+
+static uint64_t read_be(const unsigned char* data, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) value = (value << 8) | data[i];
+    return value;
+}
+
+// Polyglot's en passant randoms, entries 772-779 of its table.
+static const uint64_t POLYGLOT_ENPASSANT[8] = {
+    0x70CC73D90BC26E24, 0xE21A6B35DF0C3AD7, 0x003A93D8B2806962, 0x1C99DED33CB890A1,
+    0xCF3145DE0ADD4289, 0xD0E4427A5514FB72, 0x77C621CC9FB3A483, 0x67A34DAC4356550B,
+};
+
+uint64_t polyglot_key(const Board& board) {
+    uint64_t key = board.hash();
+
+    // Polyglot hashes the en passant file only when a pawn of the side to move can capture there,
+    // the board hashes any ep square a FEN gives it.
+    const Square ep = board.enpassantSq();
+    if (ep != Square::underlying::NO_SQ) {
+        const Color us = board.sideToMove();
+        if (!(attacks::pawn(~us, ep) & board.pieces(PieceType::PAWN, us))) key ^= POLYGLOT_ENPASSANT[ep.file()];
+    }
+    return key;
+}
+
+bool verify_polyglot_keys() {
+    // The test positions of the Polyglot book format, as FENs and as the moves that reach them.
+    struct KeyTest {
+        const char* fen;
+        const char* moves;
+        uint64_t key;
+    };
+    static const KeyTest tests[] = {
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "", 0x463b96181691fc9c},
+        {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", "e2e4", 0x823c9b50fd114196},
+        {"rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", "e2e4 d7d5", 0x0756b94461c50fb0},
+        {"rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", "e2e4 d7d5 e4e5", 0x662fafb965db29d4},
+        {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", "e2e4 d7d5 e4e5 f7f5", 0x22a48b5a8e47ff78},
+        {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", "e2e4 d7d5 e4e5 f7f5 e1e2",
+         0x652a607ca3f242c1},
+        {"rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", "e2e4 d7d5 e4e5 f7f5 e1e2 e8f7",
+         0x00fdd303c946bdd9},
+        {"rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", "a2a4 b7b5 h2h4 b5b4 c2c4",
+         0x3c8123ea7b067637},
+        {"rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", "a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3",
+         0x5c3f9b829b279560},
+    };
+
+    for (const auto& test : tests) {
+        Board replayed;
+        istringstream moves(test.moves);
+        string uci_move;
+        while (moves >> uci_move) replayed.makeMove(uci::uciToMove(replayed, uci_move));
+
+        uint64_t from_fen = polyglot_key(Board(test.fen)), from_moves = polyglot_key(replayed);
+        if (from_fen != test.key || from_moves != test.key) {
+            cout << "Wrong Polyglot key for " << test.fen << ": " << hex << from_fen << " from the FEN, "
+                 << from_moves << " from the moves, expected " << test.key << dec << endl;
+            return false;
+        }
+    }
+
+    cout << "Polyglot keys verified on " << size(tests) << " positions" << endl;
+    return true;
+}
+
+Move polyglot_to_move(const Board& board, uint16_t poly_move) {
+    // bits 0-5 target square, 6-11 source square, 12-14 promotion piece (1 = knight ... 4 = queen)
+    const Square to = Square(poly_move & 0x3f);
+    const Square from = Square((poly_move >> 6) & 0x3f);
+    const int promotion = (poly_move >> 12) & 0x7;
+
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+
+    // Castling is stored as king takes rook, which is how the library encodes it as well.
+    for (const auto& move : moves) {
+        if (move.from() != from || move.to() != to) continue;
+        if (move.typeOf() == Move::PROMOTION) {
+            if (promotion && (int)move.promotionType() == promotion) return move;
+        } else if (!promotion) {
+            return move;
+        }
+    }
+    return Move::NO_MOVE;
+}
+
+uint16_t move_to_polyglot(const Move& move) {
+    uint16_t poly_move = move.to().index() | (move.from().index() << 6);
+    if (move.typeOf() == Move::PROMOTION) poly_move |= (int)move.promotionType() << 12;
+    return poly_move;
+}
+
+PolyglotBook::~PolyglotBook() {
+    close();
+}
+
+bool PolyglotBook::open(const string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(PolyglotEntry)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+
+    entries = static_cast<const unsigned char*>(data);
+    mapped_size = st.st_size;
+    count = mapped_size / sizeof(PolyglotEntry);
+    return true;
+}
+
+void PolyglotBook::close() {
+    if (entries) munmap(const_cast<unsigned char*>(entries), mapped_size);
+    entries = nullptr;
+    count = 0;
+    mapped_size = 0;
+}
+
+PolyglotEntry PolyglotBook::entry(size_t index) const {
+    const unsigned char* data = entries + index * sizeof(PolyglotEntry);
+    return {read_be(data, 8), (uint16_t)read_be(data + 8, 2), (uint16_t)read_be(data + 10, 2),
+            (uint32_t)read_be(data + 12, 4)};
+}
+
+Move PolyglotBook::probe(const Board& board) const {
+    if (!entries) return Move::NO_MOVE;
+
+    const uint64_t key = polyglot_key(board);
+
+    // lower bound of the key
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (entry(mid).key < key) low = mid + 1;
+        else high = mid;
+    }
+
+    uint32_t total_weight = 0;
+    size_t end = low;
+    for (; end < count && entry(end).key == key; end++) total_weight += entry(end).weight;
+    if (end == low) return Move::NO_MOVE;
+
+    static thread_local mt19937_64 rng(random_device{}());
+    // Books built with all-zero weights still get a uniform pick.
+    uint64_t pick = rng() % (total_weight ? total_weight : end - low);
+
+    for (size_t i = low; i < end; i++) {
+        uint32_t weight = total_weight ? entry(i).weight : 1;
+        if (pick < weight) return polyglot_to_move(board, entry(i).move);
+        pick -= weight;
+    }
+    return Move::NO_MOVE;
+}
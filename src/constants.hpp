@@ -1,7 +1,10 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <map>
 #include <semaphore>
 #include <thread>
+#include "params.hpp"
 
 const int MAX_SCORE = 100000;
 const int W_WIN_THRE = MAX_SCORE - 50;
@@ -9,10 +12,14 @@ const int B_WIN_THRE = -W_WIN_THRE;
 
 const int BOARD_SIZE = 64;
 
-const int CASTLE = 10;
-
 const int DEFAULT_DEPTH_MM = 6;
-const int DEFAULT_DEPTH_Q = 3;
+const int MAX_DEPTH = 64;
+
+const int BENCH_DEPTH = 5;
+const int BENCH_THREADS = 1;
+const int BENCH_HASH = 16;
+
+const int NODE_CHECK_INTERVAL = 1024; // Nodes a thread counts locally before checking the search limits.
 
 const int PIECE_VAL[6] = {1, 3, 3, 5, 9, 0};
 const int RAND_MOVE_THRE = 10;
@@ -222,4 +229,37 @@ const int PST[6][BOARD_SIZE] = {{// PAWN
     10, 10, 0, -10, 0, -10, 10, 10,
 }};
 
+// Game phase weight per piece type, a full set of pieces adds up to MAX_PHASE.
+const int PHASE_INC[6] = {0, 1, 1, 2, 4, 0};
+const int MAX_PHASE = 24;
+
+// A middlegame and an endgame score packed into one int, the endgame half in the upper 16 bits.
+// Packed scores add and subtract as a whole, so one sum tracks both phases.
+constexpr int make_score(int mg, int eg) { return (int)((unsigned int)eg << 16) + mg; }
+constexpr int mg_value(int score) { return (int16_t)(uint16_t)(unsigned int)score; }
+constexpr int eg_value(int score) { return (int16_t)(uint16_t)((unsigned int)(score + 0x8000) >> 16); }
+
+// PESTO_VALUE + PESTO_POSITION folded per [color][piece][square], white mirrored and positive,
+// black negative, so a position's packed score is just the sum over its pieces.
+constexpr std::array<std::array<std::array<int, BOARD_SIZE>, 6>, 2> make_psqt() {
+    std::array<std::array<std::array<int, BOARD_SIZE>, 6>, 2> psqt = {};
+    for (int piece = 0; piece < 6; piece++) {
+        for (int sq = 0; sq < BOARD_SIZE; sq++) {
+            psqt[0][piece][sq] = make_score(PESTO_POSITION[0][piece][sq ^ 56] + PESTO_VALUE[0][piece],
+                                            PESTO_POSITION[1][piece][sq ^ 56] + PESTO_VALUE[1][piece]);
+            psqt[1][piece][sq] = -make_score(PESTO_POSITION[0][piece][sq] + PESTO_VALUE[0][piece],
+                                             PESTO_POSITION[1][piece][sq] + PESTO_VALUE[1][piece]);
+        }
+    }
+    return psqt;
+}
+
+constexpr auto PSQT = make_psqt();
+
+// Blends a packed score by game phase, MAX_PHASE being the opening and 0 a bare endgame.
+constexpr int taper(int score, int phase) {
+    phase = phase < MAX_PHASE ? phase : MAX_PHASE;
+    return (mg_value(score) * phase + eg_value(score) * (MAX_PHASE - phase)) / MAX_PHASE;
+}
+
 extern std::map<std::pair<int, int>, int> capture_score;
\ No newline at end of file
@@ -1,5 +1,11 @@
 #include "evaluation.hpp"
 #include "constants.hpp"
+#include "pawns.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
 
  std::map<std::pair<int, int>, int> capture_score = {
     {{5, 4}, 50},
@@ -39,8 +45,6 @@
 };
 
 int evaluation(chess::Board& board) {
-	int evaluation = 0;
-
 	if (board.isGameOver().second == chess::GameResult::DRAW) {
 		return 0;
 	}
@@ -49,67 +53,228 @@ int evaluation(chess::Board& board) {
 		return board.sideToMove() == chess::Color::BLACK ? MAX_SCORE:-MAX_SCORE;
 	}
 
-    // Define endgame: 
-    // Botj sides have less than 13 points of materials
-	int white_points = 0, black_points = 0;
-    for (int i = 0; i < BOARD_SIZE; i++) {
-		auto piece = board.at(chess::Square((uint8_t)i));
-		if (piece != chess::Piece::NONE) {
-			if (piece.color() == chess::Color::WHITE) {
-				white_points += PIECE_VAL[piece.type()];
-			} else {
-				black_points += PIECE_VAL[piece.type()];
-			}
-		} 
-	}    
-
-    int offset = (white_points <= 13 && black_points <= 13)? 1:0; // 1 for eg, 0 for mg
-
-	for (int i = 0; i < BOARD_SIZE; i++) {
-		auto piece = board.at(chess::Square((uint8_t)i));
-		if (piece != chess::Piece::NONE) {
-			if (piece.color() == chess::Color::WHITE) {
-				evaluation += PESTO_POSITION[offset][piece.type()][BOARD_SIZE - 1 - (8*(i/8) + 7 - i%8)] + PESTO_VALUE[offset][piece.type()];
-			} else {
-				evaluation -= (PESTO_POSITION[offset][piece.type()][i] + PESTO_VALUE[offset][piece.type()]);
-			}
-		} 
+	if (nnue_network()) {
+		int score = nnue_evaluate(board);
+		return board.sideToMove() == chess::Color::WHITE ? score : -score;
+	}
+
+	int score = 0, phase = 0;
+	for (int color = 0; color < 2; color++) {
+		for (int type = 0; type < 6; type++) {
+			auto pieces = board.pieces(chess::PieceType((chess::PieceType::underlying)type), chess::Color((chess::Color::underlying)color));
+			phase += pieces.count() * PHASE_INC[type];
+			while (pieces) score += PSQT[color][type][pieces.pop()];
+		}
+	}
+
+	uint64_t white_pawns = board.pieces(chess::PieceType::PAWN, chess::Color::WHITE).getBits();
+	uint64_t black_pawns = board.pieces(chess::PieceType::PAWN, chess::Color::BLACK).getBits();
+	score += evaluate_pawns(white_pawns, black_pawns).score;
+	score += pawn_shield(board, chess::Color::WHITE) - pawn_shield(board, chess::Color::BLACK);
+
+	return taper(score, phase);
+}
+
+EvalBoard::EvalBoard(std::string_view fen) : chess::Board(fen) {
+	// The base constructor placed the pieces before the hooks were in place.
+	refresh();
+}
+
+EvalBoard::EvalBoard(const chess::Board& board) : chess::Board(board) {
+	refresh();
+}
+
+void EvalBoard::setFen(std::string_view fen) {
+	// The hooks fire while the position is half set up, so everything is rebuilt once it's complete.
+	nnue_ = false;
+	chess::Board::setFen(fen);
+	refresh();
+}
+
+void EvalBoard::placePiece(chess::Piece piece, chess::Square sq) {
+	chess::Board::placePiece(piece, sq);
+	score_ += PSQT[piece.color()][(int)piece.type()][sq.index()];
+	phase_ += PHASE_INC[(int)piece.type()];
+	if (nnue_) update_accumulator(piece, sq, true);
+}
+
+void EvalBoard::removePiece(chess::Piece piece, chess::Square sq) {
+	chess::Board::removePiece(piece, sq);
+	score_ -= PSQT[piece.color()][(int)piece.type()][sq.index()];
+	phase_ -= PHASE_INC[(int)piece.type()];
+	if (nnue_) update_accumulator(piece, sq, false);
+}
+
+void EvalBoard::refresh() {
+	score_ = phase_ = 0;
+	auto occupied = occ();
+	while (occupied) {
+		auto sq = chess::Square(occupied.pop());
+		auto piece = at(sq);
+		score_ += PSQT[piece.color()][(int)piece.type()][sq.index()];
+		phase_ += PHASE_INC[(int)piece.type()];
+	}
+
+	nnue_ = nnue_network() && pieces(chess::PieceType::KING, chess::Color::WHITE) && pieces(chess::PieceType::KING, chess::Color::BLACK);
+	if (nnue_) {
+		nnue_refresh(acc_, *this, chess::Color::WHITE);
+		nnue_refresh(acc_, *this, chess::Color::BLACK);
+	}
+}
+
+void EvalBoard::update_accumulator(chess::Piece piece, chess::Square sq, bool add) {
+	for (chess::Color side : {chess::Color::WHITE, chess::Color::BLACK}) {
+		// A king landing in another bucket changes every feature of its side, that half is rebuilt.
+		// The board already holds the king here, removals use the bucket of the half as it stands.
+		if (add && piece.type() == chess::PieceType::KING && piece.color() == side &&
+		    nnue_king_bucket(side, sq) != acc_.bucket[side]) {
+			nnue_refresh(acc_, *this, side);
+			continue;
+		}
+		int feature = nnue_feature(side, piece, sq, acc_.bucket[side]);
+		if (add) nnue_add_feature(acc_, side, feature);
+		else nnue_remove_feature(acc_, side, feature);
+	}
+}
+
+std::atomic<uint64_t> eval_cache_hits{0};
+std::atomic<uint64_t> eval_cache_misses{0};
+
+// Each slot is one word, the upper 48 bits of the zobrist key and the 16 bit score.
+// Bumped by clear_eval_caches, every thread clears its own cache when it sees a new generation.
+static std::atomic<uint32_t> eval_cache_generation{0};
+static thread_local std::unique_ptr<uint64_t[]> eval_cache;
+static thread_local uint32_t thread_cache_generation = 0;
+static thread_local uint64_t thread_cache_hits = 0;
+static thread_local uint64_t thread_cache_misses = 0;
+
+// Mate scores don't fit in 16 bits, they are stored as +-EVAL_CACHE_MATE instead.
+const int EVAL_CACHE_MATE = 32000;
+
+// Draws by the 50 move rule and by repetition depend on the game history, not just the position,
+// so they are settled before the cache is consulted. Returns false if neither applies.
+static bool history_result(EvalBoard& board, int& score) {
+	if (board.isHalfMoveDraw()) {
+		bool mate = board.getHalfMoveDrawType().first == chess::GameResultReason::CHECKMATE;
+		score = !mate ? 0 : board.sideToMove() == chess::Color::BLACK ? MAX_SCORE:-MAX_SCORE;
+		return true;
+	}
+
+	score = 0;
+	return board.isRepetition();
+}
+
+// Evaluates from the incremental state alone, without the eval cache. The pawn hash table is
+// skipped as well unless use_pawn_table is set.
+static int incremental_evaluation(EvalBoard& board, bool use_pawn_table) {
+	auto result = board.isGameOver();
+	if (result.second == chess::GameResult::DRAW) return 0;
+	if (result.first == chess::GameResultReason::CHECKMATE)
+		return board.sideToMove() == chess::Color::BLACK ? MAX_SCORE:-MAX_SCORE;
+
+	if (board.nnueActive()) {
+		int score = nnue_evaluate(board.accumulator(), board.sideToMove());
+		return board.sideToMove() == chess::Color::BLACK ? -score : score;
+	}
+
+	uint64_t white_pawns = board.pieces(chess::PieceType::PAWN, chess::Color::WHITE).getBits();
+	uint64_t black_pawns = board.pieces(chess::PieceType::PAWN, chess::Color::BLACK).getBits();
+	int score = board.score();
+	score += use_pawn_table ? probe_pawns(board.pawnKey(), white_pawns, black_pawns).score
+	                        : evaluate_pawns(white_pawns, black_pawns).score;
+	score += pawn_shield(board, chess::Color::WHITE) - pawn_shield(board, chess::Color::BLACK);
+	return taper(score, board.phase());
+}
+
+int evaluation(EvalBoard& board) {
+	int score;
+	if (history_result(board, score)) return score;
+
+	// Loading or unloading a network changes every score, it empties the caches as well.
+	const uint32_t generation = eval_cache_generation.load(std::memory_order_relaxed) + nnue_generation();
+	if (!eval_cache) {
+		eval_cache = std::make_unique<uint64_t[]>(EVAL_CACHE_SIZE);
+		thread_cache_generation = generation;
+	} else if (thread_cache_generation != generation) {
+		std::fill(eval_cache.get(), eval_cache.get() + EVAL_CACHE_SIZE, 0);
+		thread_cache_generation = generation;
 	}
 
-	return evaluation;
+	const uint64_t key = board.hash();
+	uint64_t& slot = eval_cache[key & (EVAL_CACHE_SIZE - 1)];
+
+	if ((slot ^ key) >> 16 == 0 && slot != 0) {
+		thread_cache_hits++;
+		int score = (int16_t)(uint16_t)slot;
+		if (score == EVAL_CACHE_MATE) return MAX_SCORE;
+		if (score == -EVAL_CACHE_MATE) return -MAX_SCORE;
+		return score;
+	}
+	thread_cache_misses++;
+
+	score = incremental_evaluation(board, true);
+
+	int stored = score == MAX_SCORE ? EVAL_CACHE_MATE : score == -MAX_SCORE ? -EVAL_CACHE_MATE : score;
+	slot = (key & ~0xFFFFULL) | (uint16_t)(int16_t)stored;
+	return score;
+}
+
+void clear_eval_caches() {
+	eval_cache_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void flush_eval_stats() {
+	eval_cache_hits.fetch_add(thread_cache_hits, std::memory_order_relaxed);
+	eval_cache_misses.fetch_add(thread_cache_misses, std::memory_order_relaxed);
+	thread_cache_hits = thread_cache_misses = 0;
 }
 
-bool is_capture_move(const chess::Board& board, const chess::Move& move) {
-    const chess::Piece& from_piece = board.at<chess::Piece>(move.from());
-    const chess::Piece& to_piece = board.at<chess::Piece>(move.to());
-    if (from_piece.type() == chess::PieceType::NONE) {
-        return false;
-    }
-    if (to_piece.type() != chess::PieceType::NONE && to_piece.color() != from_piece.color()) {
-        return true;
-    }
-    return false;
+// The incremental evaluation without any cache, so every node checks the incremental state.
+static int uncached_evaluation(EvalBoard& board) {
+	int score;
+	if (history_result(board, score)) return score;
+	return incremental_evaluation(board, false);
 }
 
-bool appear_quiet(chess::Board board) {
-	if (board.inCheck())
-		return false;
-
-	chess::Movelist moves;
-	chess::movegen::legalmoves(moves, board);
-	for (int i = 0; i < moves.size(); i++) {
-		const auto move = moves[i];
-		board.makeMove(move);
-		if (is_capture_move(board, move)) {
-			int attacker_val = PIECE_VAL[(int)((board.at<chess::Piece>(move.from())).type())];
-			int victim_val = PIECE_VAL[(int)((board.at<chess::Piece>(move.to())).type())];
-			if (attacker_val < victim_val) {
+bool verify_evaluation(int games) {
+	std::mt19937 rng(12345);
+	int positions = 0;
+
+	for (int game = 0; game < games; game++) {
+		EvalBoard board;
+
+		for (int ply = 0; ply < 300 && board.isGameOver().first == chess::GameResultReason::NONE; ply++) {
+			chess::Movelist moves;
+			chess::movegen::legalmoves(moves, board);
+
+			// Try every move once, so captures, promotions and castling get unmade as well.
+			for (const auto& move : moves) {
+				board.makeMove(move);
+				chess::Board plain = board;
+				if (uncached_evaluation(board) != evaluation(plain) || board.pawnKey() != chess::Board(board.getFen()).pawnKey()) {
+					std::cout << "Mismatch after " << chess::uci::moveToUci(move) << ": " << board.getFen() << std::endl;
+					return false;
+				}
 				board.unmakeMove(move);
+				positions++;
+			}
+
+			chess::Board plain = board;
+			if (uncached_evaluation(board) != evaluation(plain)) {
+				std::cout << "Mismatch: " << board.getFen() << std::endl;
 				return false;
 			}
+			board.makeMove(moves[rng() % moves.size()]);
 		}
-		board.unmakeMove(move);
 	}
 
+	std::cout << "Evaluation verified on " << positions << " positions" << std::endl;
 	return true;
+}
+
+bool appear_quiet(const chess::Board& board) {
+	// Quiet means not in check, read from the cached checkers. That is what the search has always
+	// used: the capture test this replaced looked at the board after each move, where the from
+	// square is empty, and never fired.
+	return !board.inCheck();
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "gensfen.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "chess.hpp"
+#include "constants.hpp"
+#include "evaluation.hpp"
+#include "search.hpp"
+#include "training.hpp"
+
+using namespace chess;
+using namespace std;
+
+// Plays games until games_left runs out, handing the positions of every finished game to the writer.
+static void play_games(const GensfenOptions& options, uint64_t seed, atomic<int64_t>& games_left,
+                       atomic<uint64_t>& games_done, atomic<uint64_t>& positions, TrainingWriter& writer) {
+    mt19937_64 rng(seed);
+    const int depth = options.nodes ? 0 : options.depth;
+
+    while (games_left.fetch_sub(1) > 0) {
+        EvalBoard board;
+
+        // A random opening, redrawn if it happens to end the game.
+        for (int ply = 0; ply < options.random_plies; ply++) {
+            Movelist moves;
+            movegen::legalmoves(moves, board);
+            if (moves.empty()) {
+                board = EvalBoard();
+                ply = -1;
+                continue;
+            }
+            board.makeMove(moves[rng() % moves.size()]);
+        }
+
+        vector<TrainingEntry> entries;
+        vector<Color> sides;
+        int white_result = 0;
+        int streak = 0;  // Plies in a row beyond the adjudication score, negative when black is winning.
+
+        for (int ply = options.random_plies; ; ply++) {
+            auto [reason, result] = board.isGameOver();
+            if (reason != GameResultReason::NONE) {
+                if (reason == GameResultReason::CHECKMATE) white_result = board.sideToMove() == Color::WHITE ? -1 : 1;
+                break;
+            }
+            if (ply >= options.max_ply) break;
+
+            auto [score, move] = search_single(board, depth, options.nodes);
+
+            if (score >= options.adjudicate) streak = max(streak, 0) + 1;
+            else if (score <= -options.adjudicate) streak = min(streak, 0) - 1;
+            else streak = 0;
+            if (abs(streak) >= options.adjudicate_plies) {
+                white_result = streak > 0 ? 1 : -1;
+                break;
+            }
+
+            // Only quiet positions, where the static evaluation can be expected to match the search.
+            bool quiet = !board.inCheck() && !board.isCapture(move) && move.typeOf() != Move::PROMOTION;
+            if (ply >= options.min_ply && quiet && abs(score) < W_WIN_THRE) {
+                int stm_score = board.sideToMove() == Color::WHITE ? score : -score;
+                entries.push_back({Board::Compact::encode(board), (int16_t)clamp(stm_score, -32000, 32000), 0, 0});
+                sides.push_back(board.sideToMove());
+            }
+
+            board.makeMove(move);
+        }
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            entries[i].result = sides[i] == Color::WHITE ? white_result : -white_result;
+        }
+        positions += entries.size();
+        writer.write(std::move(entries));
+        games_done++;
+    }
+}
+
+uint64_t gensfen(const GensfenOptions& options) {
+    TrainingWriter writer;
+    if (!writer.open(options.output)) {
+        cout << "Could not open " << options.output << endl;
+        return 0;
+    }
+
+    int threads = options.threads ? options.threads : MAX_THREAD;
+    uint64_t seed = options.seed ? options.seed : random_device()();
+    atomic<int64_t> games_left(options.games);
+    atomic<uint64_t> games_done(0);
+    atomic<uint64_t> positions(0);
+
+    cout << "Playing " << options.games << " games on " << threads << " threads, "
+         << (options.nodes ? to_string(options.nodes) + " nodes" : "depth " + to_string(options.depth))
+         << " per move" << endl;
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back(play_games, cref(options), seed + t * 0x9E3779B97F4A7C15ULL, ref(games_left), ref(games_done),
+                             ref(positions), ref(writer));
+    }
+
+    // Progress once a second until every game is played.
+    for (int tick = 1; games_done < options.games; tick++) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        if (tick % 10) continue;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "Games: " << games_done << '/' << options.games << "  Positions: " << positions
+             << "  Positions/second: " << (uint64_t)(positions / seconds) << endl;
+    }
+    for (auto& worker : workers) worker.join();
+    writer.close();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    uint64_t written = writer.written();
+    cout << "Wrote " << written << " positions to " << options.output << " in " << (uint64_t)seconds << " s ("
+         << (uint64_t)(written / max(seconds, 1e-3)) << " positions/second)" << endl;
+    return written;
+}
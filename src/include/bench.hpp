@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Searches the embedded bench positions at a fixed depth and prints total nodes, time and NPS.
+// The node count doubles as a signature of the search, any functional change alters it.
+// Given a network, the positions are searched twice, with the PeSTO tables and then with the
+// network (which stays loaded), so the two speeds can be compared. Returns the nodes of the last run.
+std::uint64_t bench(int depth, int threads, int hash, const std::string& eval_file = "");
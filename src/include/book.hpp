@@ -0,0 +1,52 @@
+#pragma once
+#include "chess.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// One 16 byte record of a Polyglot .bin book, stored big-endian and sorted by key.
+struct PolyglotEntry {
+    std::uint64_t key;
+    std::uint16_t move;
+    std::uint16_t weight;
+    std::uint32_t learn;
+};
+
+// The chess-library's zobrist numbers are the Polyglot ones, so this is Board::hash() with the en
+// passant file taken out when no pawn can capture there (which a FEN can set up).
+std::uint64_t polyglot_key(const chess::Board& board);
+
+// Checks polyglot_key against the test positions of the Polyglot format, set up from FENs and by
+// playing the moves. Returns false (and prints the position) on the first wrong key.
+bool verify_polyglot_keys();
+
+// Converts a Polyglot move to the matching legal move, Move::NO_MOVE if there is none.
+chess::Move polyglot_to_move(const chess::Board& board, std::uint16_t poly_move);
+
+// Encodes a move the way Polyglot books store it.
+std::uint16_t move_to_polyglot(const chess::Move& move);
+
+// Read-only Polyglot book, memory-mapped so opening it costs nothing and probes are a binary search.
+class PolyglotBook {
+public:
+    PolyglotBook() = default;
+    PolyglotBook(const PolyglotBook&) = delete;
+    PolyglotBook& operator=(const PolyglotBook&) = delete;
+    ~PolyglotBook();
+
+    // Maps the book file, returns false (and leaves the book closed) if it can't be read.
+    bool open(const std::string& path);
+    void close();
+    bool loaded() const { return entries != nullptr; }
+
+    // Picks a book move at random, weighted by the entry weights. Returns Move::NO_MOVE when
+    // the position is not in the book.
+    chess::Move probe(const chess::Board& board) const;
+
+private:
+    PolyglotEntry entry(std::size_t index) const;
+
+    const unsigned char* entries = nullptr;
+    std::size_t count = 0;
+    std::size_t mapped_size = 0;
+};
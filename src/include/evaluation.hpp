@@ -1,5 +1,57 @@
 #pragma once
 #include "chess.hpp"
+#include "nnue.hpp"
+#include <atomic>
+#include <cstdint>
 
+// Board that keeps the packed PeSTO score and the game phase up to date through the place/remove
+// hooks, so evaluating it doesn't have to look at the pieces at all. Scores are white-relative.
+// While a network is loaded, the NNUE accumulator is kept up to date by the same hooks.
+class EvalBoard : public chess::Board {
+public:
+    explicit EvalBoard(std::string_view fen = chess::constants::STARTPOS);
+    explicit EvalBoard(const chess::Board& board);
+
+    void setFen(std::string_view fen) override;
+
+    // Packed (see make_score) PeSTO material + position sum.
+    int score() const { return score_; }
+    // Sum of PHASE_INC over the pieces on the board.
+    int phase() const { return phase_; }
+    // True if the accumulator is being maintained, i.e. a network was loaded when the board was set up.
+    bool nnueActive() const { return nnue_; }
+    const NnueAccumulator& accumulator() const { return acc_; }
+
+protected:
+    void placePiece(chess::Piece piece, chess::Square sq) override;
+    void removePiece(chess::Piece piece, chess::Square sq) override;
+
+private:
+    void refresh();
+    void update_accumulator(chess::Piece piece, chess::Square sq, bool add);
+
+    int score_ = 0;
+    int phase_ = 0;
+    bool nnue_ = false;
+    NnueAccumulator acc_;
+};
+
+const int EVAL_CACHE_SIZE = 65536; // Slots per thread, a power of two.
+
+extern std::atomic<std::uint64_t> eval_cache_hits;   // Summed over all threads.
+extern std::atomic<std::uint64_t> eval_cache_misses;
+
+// Uses the loaded network if there is one, the PeSTO tables otherwise.
 int evaluation(chess::Board& board);
-bool appear_quiet(chess::Board board);
+// Same result as evaluation(Board&), but incremental and cached per thread by zobrist key.
+int evaluation(EvalBoard& board);
+// Empties the eval cache of every thread, each clears its own on its next evaluation.
+void clear_eval_caches();
+// Folds the calling thread's eval cache counters into eval_cache_hits and eval_cache_misses.
+void flush_eval_stats();
+bool appear_quiet(const chess::Board& board);
+
+// Plays random games and checks the incremental evaluation against a full scan after every
+// move and unmove, bypassing the eval cache and the pawn hash table. Returns false (and prints
+// the position) on the first mismatch.
+bool verify_evaluation(int games);
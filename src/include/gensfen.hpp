@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+struct GensfenOptions {
+    std::string output = "data.bin";  // Appended to if it exists.
+    std::uint64_t games = 1000;
+    int depth = 3;                    // Search depth per move...
+    std::uint64_t nodes = 0;          // ...or, if set, deepen until this many nodes are searched.
+    int threads = 0;                  // One game per thread, 0 for every core.
+    int random_plies = 8;             // Random moves opening every game.
+    int min_ply = 16;                 // Earlier positions are not recorded.
+    int max_ply = 400;                // Longer games are scored as draws.
+    int adjudicate = 2000;            // A game is over once the score stays beyond this many centipawns
+    int adjudicate_plies = 8;         // for this many plies in a row.
+    std::uint64_t seed = 0;           // 0 for a random seed.
+};
+
+// Plays self-play games from randomized openings, one per thread, and appends their quiet positions
+// to a training file, labelled with the search score and the game result. Returns the number of
+// positions written.
+std::uint64_t gensfen(const GensfenOptions& options);
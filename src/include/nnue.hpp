@@ -0,0 +1,84 @@
+#pragma once
+#include "chess.hpp"
+#include <array>
+#include <cstdint>
+#include <string>
+
+// HalfKA-style network. Each side sees the 768 (piece, square) features of the board from its own
+// point of view, in one of NNUE_KING_BUCKETS copies picked by where its own king stands. The two
+// accumulators feed, side to move first, a clipped int8 layer and then a single output.
+const int NNUE_KING_BUCKETS = 4;
+const int NNUE_FEATURES = NNUE_KING_BUCKETS * 768;
+const int NNUE_HIDDEN = 256;   // Accumulator size per side.
+const int NNUE_L2 = 32;
+
+// Quantization: accumulators are scaled by NNUE_QA and clipped to [0, NNUE_QA], the int8 weights
+// are scaled by NNUE_QB, and one unit of network output is NNUE_SCALE centipawns.
+const int NNUE_QA = 127;
+const int NNUE_QB = 64;
+const int NNUE_SCALE = 400;
+const int NNUE_MAX_EVAL = 30000;  // Network scores are clamped well inside the mate range.
+
+const std::uint32_t NNUE_MAGIC = 0x4E4E4653;  // "SFNN"
+const std::uint32_t NNUE_VERSION = 1;
+
+// King bucket by square, from the side's own point of view (rank 1 is its back rank).
+constexpr std::array<int, 64> NNUE_BUCKETS = {
+    0, 0, 0, 0, 1, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+};
+
+inline int nnue_king_bucket(chess::Color side, chess::Square king) {
+    return NNUE_BUCKETS[side == chess::Color::WHITE ? king.index() : king.index() ^ 56];
+}
+
+// Input index of a piece for one side, whose own pieces come first and whose board is flipped
+// for black.
+inline int nnue_feature(chess::Color side, chess::Piece piece, chess::Square sq, int bucket) {
+    int relative_color = piece.color() == side ? 0 : 1;
+    int relative_sq = side == chess::Color::WHITE ? sq.index() : sq.index() ^ 56;
+    return bucket * 768 + (relative_color * 6 + (int)piece.type()) * 64 + relative_sq;
+}
+
+// The file is this struct in order, little-endian, after a header of five uint32s: NNUE_MAGIC,
+// NNUE_VERSION, NNUE_FEATURES, NNUE_HIDDEN and NNUE_L2.
+struct NnueNetwork {
+    alignas(64) std::int16_t ft_weights[NNUE_FEATURES * NNUE_HIDDEN];  // [feature][neuron]
+    alignas(64) std::int16_t ft_bias[NNUE_HIDDEN];
+    alignas(64) std::int8_t l1_weights[NNUE_L2 * 2 * NNUE_HIDDEN];     // [output][input]
+    alignas(64) std::int32_t l1_bias[NNUE_L2];
+    alignas(64) std::int8_t out_weights[NNUE_L2];
+    std::int32_t out_bias;
+};
+
+// First layer outputs of one position, [side][neuron], and the king bucket each half was built for.
+struct NnueAccumulator {
+    alignas(32) std::int16_t values[2][NNUE_HIDDEN];
+    int bucket[2];
+};
+
+// Loads a network for the whole engine, returns false (keeping the old one) if the file is unusable.
+bool nnue_load(const std::string& path);
+void nnue_unload();
+// Changes with every nnue_load and nnue_unload, so scores cached under another evaluator can be dropped.
+std::uint32_t nnue_generation();
+// The loaded network, nullptr while the PeSTO evaluation is in use.
+const NnueNetwork* nnue_network();
+// Name of the kernels picked for this CPU: "avx2", "sse4.1" or "scalar".
+const char* nnue_simd();
+
+// Rebuilds one side of the accumulator from the pieces on the board.
+void nnue_refresh(NnueAccumulator& acc, const chess::Board& board, chess::Color side);
+void nnue_add_feature(NnueAccumulator& acc, chess::Color side, int feature);
+void nnue_remove_feature(NnueAccumulator& acc, chess::Color side, int feature);
+
+// Centipawns from the side to move's point of view.
+int nnue_evaluate(const NnueAccumulator& acc, chess::Color side_to_move);
+// Same, building the accumulator from scratch.
+int nnue_evaluate(const chess::Board& board);
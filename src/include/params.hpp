@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Every tunable search parameter: name, default, min, max, and the SPSA perturbation size. Release
+// builds compile them in as constants, builds with -DTUNE (make tune) read them from variables that
+// are set as UCI options, so an SPSA driver can play perturbed engines against each other.
+#define SEARCH_PARAMS(X) \
+    X(CASTLE,          10, 0, 60, 4)   /* Move ordering score of castling moves. */ \
+    X(DEFAULT_DEPTH_Q,  3, 0,  8, 1)   /* Quiescence plies, -qd overrides it. */
+
+#ifdef TUNE
+#define X(name, value, min, max, step) extern int name;
+#else
+#define X(name, value, min, max, step) constexpr int name = value;
+#endif
+SEARCH_PARAMS(X)
+#undef X
+
+struct SearchParam {
+    const char* name;
+    int* value;         // nullptr when the parameter is compiled in.
+    int default_value;
+    int min;
+    int max;
+    int step;
+};
+
+const std::vector<SearchParam>& search_params();
+
+// Sets a parameter in tuning builds, clamped to its range. Returns false if there is no such
+// parameter (or it's a constant) or the value isn't a number.
+bool set_param(const std::string& name, const std::string& value);
+
+// One "name,value,min,max,step" line per parameter, what the SPSA driver reads.
+void print_params();
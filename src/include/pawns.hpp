@@ -0,0 +1,32 @@
+#pragma once
+#include "chess.hpp"
+#include <atomic>
+#include <cstdint>
+
+// Everything about a pawn structure that doesn't depend on the other pieces.
+struct PawnEntry {
+    std::uint64_t key;
+    std::uint64_t passed[2];  // Passed pawns per color.
+    int score;                // Packed (see make_score), white-relative.
+};
+
+const int PAWN_TABLE_SIZE = 16384; // Entries per thread, a power of two.
+
+extern std::atomic<std::uint64_t> pawn_probes; // Pawn table lookups, summed over all threads.
+extern std::atomic<std::uint64_t> pawn_hits;
+
+// Scores passed, isolated, doubled and backward pawns from scratch.
+PawnEntry evaluate_pawns(std::uint64_t white_pawns, std::uint64_t black_pawns);
+
+// Looks the pawn structure up in the calling thread's pawn table, evaluating it on a miss.
+const PawnEntry& probe_pawns(std::uint64_t key, std::uint64_t white_pawns, std::uint64_t black_pawns);
+
+// Packed bonus for the pawns sheltering the given color's king while it is on its first two ranks.
+// This depends on the king square, so it is not part of the cached entry.
+int pawn_shield(const chess::Board& board, chess::Color color);
+
+// Folds the calling thread's pawn table counters into pawn_probes and pawn_hits.
+void flush_pawn_stats();
+
+// Empties the pawn table of every thread, each clears its own on its next probe.
+void clear_pawn_tables();
@@ -0,0 +1,10 @@
+#pragma once
+#include "chess.hpp"
+#include <cstdint>
+
+// Counts the leaf nodes of the legal move tree, with the root moves split over the thread pool.
+// A non-zero hash (in MB) enables a shared table of subtree counts keyed on zobrist and depth.
+std::uint64_t perft(chess::Board& board, int depth, int threads, int hash);
+
+// Like perft, but also prints the leaf count below every root move.
+std::uint64_t divide(chess::Board& board, int depth, int threads, int hash);
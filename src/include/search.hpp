@@ -1,9 +1,13 @@
 #pragma once
 #include "chess.hpp"
+#include "evaluation.hpp"
 #include <thread>
 #include <future>
 #include <queue>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
 
 class LennyPOOL {
 private:
@@ -29,6 +33,38 @@ public:
     // Destructor
     ~LennyPOOL();
 };
-std::pair<int, std::string> quiescence_search(int q_depth, int alpha, int beta, chess::Color color, chess::Board board);
-std::pair<int, std::string> minimax(int mm_depth, int alpha, int beta, chess::Color color, chess::Board board);
-chess::Move findBestMove(chess::Board& board, int depth, int max_threads);
\ No newline at end of file
+
+template<class F>
+void LennyPOOL::run(F&& f) {
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        tasks.emplace(std::forward<F>(f));
+    }
+    condition.notify_one();
+}
+
+// Limits of a single search, as given by the UCI "go" command. A zero value means "not set".
+struct SearchLimits {
+    int depth = 0;                          // Search exactly this many plies.
+    std::uint64_t nodes = 0;                // Stop after roughly this many nodes.
+    int movetime = 0;                       // Stop after this many milliseconds.
+    int mate = 0;                           // Look for a mate in this many moves.
+    bool infinite = false;                  // Keep searching until stop_search is raised.
+    std::vector<chess::Move> searchmoves;   // Only consider these moves at the root.
+};
+
+extern std::atomic<bool> stop_search;           // Raised by "stop" or by a hit limit, aborts the search.
+extern std::atomic<std::uint64_t> nodes_searched; // Nodes of the current search, summed over all threads.
+
+std::pair<int, std::string> quiescence_search(int q_depth, int alpha, int beta, chess::Color color, EvalBoard board);
+std::pair<int, std::string> minimax(int mm_depth, int alpha, int beta, chess::Color color, EvalBoard board);
+chess::Move findBestMove(chess::Board& board, const SearchLimits& limits, int max_threads);
+chess::Move findBestMove(chess::Board& board, int depth, int max_threads);
+// Empties the pawn tables and eval caches the search threads keep between moves, for a new game.
+void clear_search_caches();
+
+// Searches on the calling thread alone, to the given depth, or deepening until about `nodes` nodes
+// are used up when a node budget is given. Unlike findBestMove it leaves the pool and the shared
+// limits alone, so several can run at once, e.g. one per self-play game. Returns the white-relative
+// score and the best move.
+std::pair<int, chess::Move> search_single(EvalBoard& board, int depth, std::uint64_t nodes);
@@ -0,0 +1,81 @@
+#pragma once
+#include "chess.hpp"
+#include <cstdint>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One labelled position of a training data file, 28 bytes.
+struct TrainingEntry {
+    chess::PackedBoard board;  // Board::Compact encoding.
+    std::int16_t score;        // Search score in centipawns, for the side to move.
+    std::int8_t result;        // Game result for the side to move: 1 win, 0 draw, -1 loss.
+    std::uint8_t padding;
+};
+
+static_assert(sizeof(TrainingEntry) == 28, "training files depend on the entry layout");
+
+// A training data file is a sequence of chunks, each a TrainingChunkHeader followed by `count`
+// entries, so that files can simply be appended to and concatenated.
+struct TrainingChunkHeader {
+    std::uint32_t magic;
+    std::uint32_t count;
+};
+
+const std::uint32_t TRAINING_MAGIC = 0x44544653;  // "SFTD"
+const std::uint32_t TRAINING_CHUNK_ENTRIES = 65536;
+
+// Reads the entries of a training file in order, chunk by chunk.
+class TrainingReader {
+public:
+    TrainingReader() = default;
+    TrainingReader(const TrainingReader&) = delete;
+    TrainingReader& operator=(const TrainingReader&) = delete;
+    ~TrainingReader();
+
+    bool open(const std::string& path);
+    void close();
+
+    // Appends up to max_entries entries to out, returns how many were read. Zero means the end
+    // of the file or a damaged chunk.
+    std::size_t read(std::vector<TrainingEntry>& out, std::size_t max_entries);
+
+private:
+    std::FILE* file = nullptr;
+    std::uint32_t left_in_chunk = 0;
+};
+
+// Appends entries to a training file from any number of threads. Entries are queued and written in
+// full chunks by a thread of its own, so the producers never wait on the disk.
+class TrainingWriter {
+public:
+    TrainingWriter() = default;
+    TrainingWriter(const TrainingWriter&) = delete;
+    TrainingWriter& operator=(const TrainingWriter&) = delete;
+    ~TrainingWriter();
+
+    // Opens the file for appending and starts the writer thread.
+    bool open(const std::string& path);
+    // Writes what is still queued (the last chunk may be short) and closes the file.
+    void close();
+
+    void write(std::vector<TrainingEntry> entries);
+    // Entries handed to the disk so far.
+    std::uint64_t written() const;
+
+private:
+    void run();
+    void write_chunk(const TrainingEntry* entries, std::uint32_t count);
+
+    std::FILE* file = nullptr;
+    std::thread writer;
+    mutable std::mutex mutex_;
+    std::condition_variable ready;
+    std::deque<std::vector<TrainingEntry>> queue;
+    bool closing = false;
+    std::uint64_t written_ = 0;
+};
@@ -4,6 +4,12 @@
 #include "evaluation.hpp"
 #include "search.hpp"
 #include "uci.hpp"
+#include "bench.hpp"
+#include "perft.hpp"
+#include "nnue.hpp"
+#include "gensfen.hpp"
+#include "params.hpp"
+#include "book.hpp"
 
 #include <chrono>
 
@@ -14,23 +20,122 @@
 using namespace chess;
 using namespace std;
 
-int quiescence_depth = DEFAULT_DEPTH_Q;
-int mm_depth = DEFAULT_DEPTH_MM;
-float time_limit = 0; // Not being used.
-bool debug_mode = false; 
-int evals[1000];
-
 void usage_error() {
 	std::cout << "Usage: ./silkrow <-flag1> <option1> <-flag2> <option2> ... <-fen> {fen_string}" << endl;
 	return;
 }
 
+void bench_usage_error() {
+	std::cout << "Usage: ./silkfish bench [depth] [threads] [hash] [evalfile]" << endl;
+	std::cout << "       ./silkfish perft|divide depth [threads] [hash] [-fen {fen_string}]" << endl;
+}
+
 int main (int argc, char *argv[]) {
 	if (argc == 1) {      // UCI mode if no argument passed in.
 		handle_uci_command();
 		return 0;
 	}
 
+	string command = argv[1];
+	if (command == "evalcheck") {  // ./silkfish evalcheck [games] [evalfile]
+		int games = 20;
+		try {
+			if (argc > 2) games = stoi(argv[2]);
+		} catch (const std::exception&) {
+			usage_error();
+			return 1;
+		}
+		if (argc > 3 && !nnue_load(argv[3])) {
+			std::cout << "Could not load network " << argv[3] << endl;
+			return 1;
+		}
+		return verify_evaluation(games) ? 0 : 1;
+	}
+
+	if (command == "bookcheck") {  // ./silkfish bookcheck
+		return verify_polyglot_keys() ? 0 : 1;
+	}
+
+	if (command == "params") {  // ./silkfish params, the tunable search parameters for the SPSA driver
+		print_params();
+		return 0;
+	}
+
+	if (command == "gensfen") {
+		// ./silkfish gensfen [-o file] [-games N] [-depth N | -nodes N] [-threads N] [-random N] [-evalfile file]
+		InputParser input(argc, argv);
+		GensfenOptions options;
+		try {
+			if (!input.getCmdOption("-o").empty()) options.output = input.getCmdOption("-o");
+			if (!input.getCmdOption("-games").empty()) options.games = stoull(input.getCmdOption("-games"));
+			if (!input.getCmdOption("-depth").empty()) options.depth = stoi(input.getCmdOption("-depth"));
+			if (!input.getCmdOption("-nodes").empty()) options.nodes = stoull(input.getCmdOption("-nodes"));
+			if (!input.getCmdOption("-threads").empty()) options.threads = stoi(input.getCmdOption("-threads"));
+			if (!input.getCmdOption("-random").empty()) options.random_plies = stoi(input.getCmdOption("-random"));
+		} catch (const std::exception&) {
+			usage_error();
+			return 1;
+		}
+		const string& eval_file = input.getCmdOption("-evalfile");
+		if (!eval_file.empty() && !nnue_load(eval_file)) {
+			std::cout << "Could not load network " << eval_file << endl;
+			return 1;
+		}
+		gensfen(options);
+		return 0;
+	}
+
+	if (command == "bench" || command == "perft" || command == "divide") {
+		// ./silkfish bench [depth] [threads] [hash] [evalfile]
+		// ./silkfish perft|divide depth [threads] [hash] [-fen {fen_string}]
+		int args[3] = {BENCH_DEPTH, BENCH_THREADS, BENCH_HASH};
+		if (command != "bench") {
+			args[1] = MAX_THREAD;
+			args[2] = 0;
+		}
+		int i = 2;
+		for (; i < argc && i < 5 && string(argv[i]) != "-fen"; i++) {
+			try {
+				size_t pos;
+				args[i - 2] = stoi(argv[i], &pos);
+				if (pos != string(argv[i]).length()) {
+					bench_usage_error();
+					return 1;
+				}
+			} catch (const std::exception&) {
+				bench_usage_error();
+				return 1;
+			}
+		}
+
+		if (command == "bench") {
+			// only the network can follow the numbers, and a pool without threads never finishes
+			if (i + 1 < argc || (i < argc && string(argv[i]) == "-fen") || args[1] < 1) {
+				bench_usage_error();
+				return 1;
+			}
+			bench(args[0], args[1], args[2], i < argc ? argv[i] : "");
+			return 0;
+		}
+
+		// anything after the numbers has to be a -fen with its fields
+		bool valid = args[0] >= 1 && args[1] >= 1 && args[2] >= 0;
+		if (!valid || (i < argc && (string(argv[i]) != "-fen" || i + 1 == argc))) {
+			bench_usage_error();
+			return 1;
+		}
+
+		string perft_fen = "";
+		for (int j = i + 1; j < argc; ++j) {
+			perft_fen += argv[j];
+			if (j < argc - 1) perft_fen += " ";
+		}
+		Board board = perft_fen.empty() ? Board() : Board(perft_fen);
+		if (command == "perft") perft(board, args[0], args[1], args[2]);
+		else divide(board, args[0], args[1], args[2]);
+		return 0;
+	}
+
 	string fen_string = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"; 
 	bool demo_mode = false;
 	bool mute = false;
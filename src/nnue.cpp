@@ -0,0 +1,246 @@
+#include "nnue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86
+#endif
+
+using namespace chess;
+using namespace std;
+
+static unique_ptr<NnueNetwork> network;
+static atomic<uint32_t> network_generation{0};  // Bumped whenever the evaluator changes.
+
+// The kernels every evaluation goes through, picked once for the CPU we run on.
+struct NnueKernels {
+    const char* name;
+    void (*add)(int16_t* acc, const int16_t* weights);
+    void (*sub)(int16_t* acc, const int16_t* weights);
+    int32_t (*forward)(const int16_t* us, const int16_t* them, const NnueNetwork& net);
+};
+
+static void add_scalar(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i++) acc[i] += weights[i];
+}
+
+static void sub_scalar(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i++) acc[i] -= weights[i];
+}
+
+static int32_t forward_scalar(const int16_t* us, const int16_t* them, const NnueNetwork& net) {
+    uint8_t input[2 * NNUE_HIDDEN];
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+        input[i] = clamp<int>(us[i], 0, NNUE_QA);
+        input[NNUE_HIDDEN + i] = clamp<int>(them[i], 0, NNUE_QA);
+    }
+
+    int32_t output = net.out_bias;
+    for (int o = 0; o < NNUE_L2; o++) {
+        const int8_t* row = net.l1_weights + o * 2 * NNUE_HIDDEN;
+        int32_t sum = net.l1_bias[o];
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i++) sum += input[i] * row[i];
+        output += clamp<int32_t>((sum + NNUE_QB / 2) / NNUE_QB, 0, NNUE_QA) * net.out_weights[o];
+    }
+    return output;
+}
+
+#ifdef NNUE_X86
+
+__attribute__((target("avx2")))
+static void add_avx2(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i w = _mm256_loadu_si256((const __m256i*)(weights + i));
+        _mm256_storeu_si256((__m256i*)(acc + i), _mm256_add_epi16(a, w));
+    }
+}
+
+__attribute__((target("avx2")))
+static void sub_avx2(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i w = _mm256_loadu_si256((const __m256i*)(weights + i));
+        _mm256_storeu_si256((__m256i*)(acc + i), _mm256_sub_epi16(a, w));
+    }
+}
+
+// Clips 16 bit accumulator values to [0, NNUE_QA] and packs them into bytes.
+__attribute__((target("avx2")))
+static void clip_avx2(const int16_t* acc, uint8_t* out) {
+    const __m256i qa = _mm256_set1_epi16(NNUE_QA);
+    for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+        __m256i a = _mm256_min_epi16(_mm256_loadu_si256((const __m256i*)(acc + i)), qa);
+        __m256i b = _mm256_min_epi16(_mm256_loadu_si256((const __m256i*)(acc + i + 16)), qa);
+        // packus works per 128 bit lane, the permute puts the quarters back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)(out + i), packed);
+    }
+}
+
+__attribute__((target("avx2")))
+static int32_t forward_avx2(const int16_t* us, const int16_t* them, const NnueNetwork& net) {
+    alignas(32) uint8_t input[2 * NNUE_HIDDEN];
+    clip_avx2(us, input);
+    clip_avx2(them, input + NNUE_HIDDEN);
+
+    const __m256i ones = _mm256_set1_epi16(1);
+    int32_t output = net.out_bias;
+    for (int o = 0; o < NNUE_L2; o++) {
+        const int8_t* row = net.l1_weights + o * 2 * NNUE_HIDDEN;
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i += 32) {
+            __m256i x = _mm256_load_si256((const __m256i*)(input + i));
+            __m256i w = _mm256_loadu_si256((const __m256i*)(row + i));
+            // u8 * i8 pairs fit in 16 bits since inputs are at most 127
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        int32_t value = _mm_cvtsi128_si32(half) + net.l1_bias[o];
+        output += clamp<int32_t>((value + NNUE_QB / 2) / NNUE_QB, 0, NNUE_QA) * net.out_weights[o];
+    }
+    return output;
+}
+
+__attribute__((target("sse4.1")))
+static void add_sse41(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_add_epi16(a, w));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void sub_sse41(int16_t* acc, const int16_t* weights) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_sub_epi16(a, w));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static int32_t forward_sse41(const int16_t* us, const int16_t* them, const NnueNetwork& net) {
+    alignas(16) uint8_t input[2 * NNUE_HIDDEN];
+    const __m128i qa = _mm_set1_epi16(NNUE_QA);
+    for (int side = 0; side < 2; side++) {
+        const int16_t* acc = side == 0 ? us : them;
+        for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+            __m128i a = _mm_min_epi16(_mm_loadu_si128((const __m128i*)(acc + i)), qa);
+            __m128i b = _mm_min_epi16(_mm_loadu_si128((const __m128i*)(acc + i + 8)), qa);
+            _mm_store_si128((__m128i*)(input + side * NNUE_HIDDEN + i), _mm_packus_epi16(a, b));
+        }
+    }
+
+    const __m128i ones = _mm_set1_epi16(1);
+    int32_t output = net.out_bias;
+    for (int o = 0; o < NNUE_L2; o++) {
+        const int8_t* row = net.l1_weights + o * 2 * NNUE_HIDDEN;
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i += 16) {
+            __m128i x = _mm_load_si128((const __m128i*)(input + i));
+            __m128i w = _mm_loadu_si128((const __m128i*)(row + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        int32_t value = _mm_cvtsi128_si32(sum) + net.l1_bias[o];
+        output += clamp<int32_t>((value + NNUE_QB / 2) / NNUE_QB, 0, NNUE_QA) * net.out_weights[o];
+    }
+    return output;
+}
+
+#endif
+
+static NnueKernels select_kernels() {
+#ifdef NNUE_X86
+    if (__builtin_cpu_supports("avx2")) return {"avx2", add_avx2, sub_avx2, forward_avx2};
+    if (__builtin_cpu_supports("sse4.1")) return {"sse4.1", add_sse41, sub_sse41, forward_sse41};
+#endif
+    return {"scalar", add_scalar, sub_scalar, forward_scalar};
+}
+
+static const NnueKernels kernels = select_kernels();
+
+bool nnue_load(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+
+    uint32_t header[5];
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || header[0] != NNUE_MAGIC || header[1] != NNUE_VERSION || header[2] != NNUE_FEATURES ||
+        header[3] != NNUE_HIDDEN || header[4] != NNUE_L2) {
+        return false;
+    }
+
+    auto net = make_unique<NnueNetwork>();
+    in.read(reinterpret_cast<char*>(net->ft_weights), sizeof(net->ft_weights));
+    in.read(reinterpret_cast<char*>(net->ft_bias), sizeof(net->ft_bias));
+    in.read(reinterpret_cast<char*>(net->l1_weights), sizeof(net->l1_weights));
+    in.read(reinterpret_cast<char*>(net->l1_bias), sizeof(net->l1_bias));
+    in.read(reinterpret_cast<char*>(net->out_weights), sizeof(net->out_weights));
+    in.read(reinterpret_cast<char*>(&net->out_bias), sizeof(net->out_bias));
+    // a truncated file, or one with anything after the last field, is not ours
+    if (!in || in.peek() != EOF) return false;
+
+    network = std::move(net);
+    network_generation.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+
+void nnue_unload() {
+    network.reset();
+    network_generation.fetch_add(1, memory_order_relaxed);
+}
+
+uint32_t nnue_generation() {
+    return network_generation.load(memory_order_relaxed);
+}
+
+const NnueNetwork* nnue_network() {
+    return network.get();
+}
+
+const char* nnue_simd() {
+    return kernels.name;
+}
+
+void nnue_refresh(NnueAccumulator& acc, const Board& board, Color side) {
+    int bucket = nnue_king_bucket(side, board.kingSq(side));
+    acc.bucket[side] = bucket;
+    copy(network->ft_bias, network->ft_bias + NNUE_HIDDEN, acc.values[side]);
+
+    auto occupied = board.occ();
+    while (occupied) {
+        Square sq = Square(occupied.pop());
+        nnue_add_feature(acc, side, nnue_feature(side, board.at(sq), sq, bucket));
+    }
+}
+
+void nnue_add_feature(NnueAccumulator& acc, Color side, int feature) {
+    kernels.add(acc.values[side], network->ft_weights + feature * NNUE_HIDDEN);
+}
+
+void nnue_remove_feature(NnueAccumulator& acc, Color side, int feature) {
+    kernels.sub(acc.values[side], network->ft_weights + feature * NNUE_HIDDEN);
+}
+
+int nnue_evaluate(const NnueAccumulator& acc, Color side_to_move) {
+    int32_t output = kernels.forward(acc.values[side_to_move], acc.values[~side_to_move], *network);
+    int score = (int64_t)output * NNUE_SCALE / (NNUE_QA * NNUE_QB);
+    return clamp(score, -NNUE_MAX_EVAL, NNUE_MAX_EVAL);
+}
+
+int nnue_evaluate(const Board& board) {
+    NnueAccumulator acc;
+    nnue_refresh(acc, board, Color::WHITE);
+    nnue_refresh(acc, board, Color::BLACK);
+    return nnue_evaluate(acc, board.sideToMove());
+}
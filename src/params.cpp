@@ -0,0 +1,44 @@
+#include "params.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+#ifdef TUNE
+#define X(name, value, min, max, step) int name = value;
+SEARCH_PARAMS(X)
+#undef X
+#endif
+
+const vector<SearchParam>& search_params() {
+#ifdef TUNE
+#define X(name, value, min, max, step) {#name, &name, value, min, max, step},
+#else
+#define X(name, value, min, max, step) {#name, nullptr, value, min, max, step},
+#endif
+    static const vector<SearchParam> params = {SEARCH_PARAMS(X)};
+#undef X
+    return params;
+}
+
+bool set_param(const string& name, const string& value) {
+    for (const auto& param : search_params()) {
+        if (name != param.name || !param.value) continue;
+        try {
+            *param.value = clamp(stoi(value), param.min, param.max);
+        } catch (const exception&) {
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+void print_params() {
+    for (const auto& param : search_params()) {
+        cout << param.name << ',' << (param.value ? *param.value : param.default_value) << ',' << param.min << ','
+             << param.max << ',' << param.step << endl;
+    }
+}
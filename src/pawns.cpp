@@ -0,0 +1,152 @@
+#include "pawns.hpp"
+#include "constants.hpp"
+
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+
+atomic<uint64_t> pawn_probes{0};
+atomic<uint64_t> pawn_hits{0};
+
+// Bumped by clear_pawn_tables, every thread clears its own table when it sees a new generation.
+static atomic<uint32_t> pawn_generation{0};
+static thread_local unique_ptr<PawnEntry[]> pawn_table;
+static thread_local uint32_t pawn_table_generation = 0;
+static thread_local uint64_t thread_probes = 0;
+static thread_local uint64_t thread_hits = 0;
+
+const int PASSED_RANK[8] = {
+    make_score(0, 0), make_score(5, 10), make_score(5, 15), make_score(10, 25),
+    make_score(20, 45), make_score(35, 75), make_score(60, 120), make_score(0, 0)};
+const int ISOLATED = make_score(-10, -15);
+const int DOUBLED = make_score(-10, -25);
+const int BACKWARD = make_score(-8, -12);
+const int SHIELD = make_score(12, 0);
+
+constexpr uint64_t FILE_A_BB = 0x0101010101010101ULL;
+
+struct PawnMasks {
+    uint64_t file[64];            // The square's file.
+    uint64_t adjacent[64];        // The files next to the square's file.
+    uint64_t forward[2][64];      // Squares ahead on the same file.
+    uint64_t passed[2][64];       // Squares ahead on the same and adjacent files.
+    uint64_t supporters[2][64];   // Squares on adjacent files, level with or behind the square.
+    uint64_t shield[2][64];       // The three files around a king, one and two ranks ahead.
+};
+
+constexpr PawnMasks make_pawn_masks() {
+    PawnMasks masks = {};
+    for (int sq = 0; sq < 64; sq++) {
+        int file = sq % 8, rank = sq / 8;
+        masks.file[sq] = FILE_A_BB << file;
+        if (file > 0) masks.adjacent[sq] |= FILE_A_BB << (file - 1);
+        if (file < 7) masks.adjacent[sq] |= FILE_A_BB << (file + 1);
+
+        for (int r = 0; r < 8; r++) {
+            uint64_t rank_bb = 0xFFULL << (8 * r);
+            uint64_t span = (masks.file[sq] | masks.adjacent[sq]) & rank_bb;
+            if (r > rank) {
+                masks.forward[0][sq] |= masks.file[sq] & rank_bb;
+                masks.passed[0][sq] |= span;
+                if (r <= rank + 2) masks.shield[0][sq] |= span;
+            }
+            if (r < rank) {
+                masks.forward[1][sq] |= masks.file[sq] & rank_bb;
+                masks.passed[1][sq] |= span;
+                if (r >= rank - 2) masks.shield[1][sq] |= span;
+            }
+            if (r <= rank) masks.supporters[0][sq] |= masks.adjacent[sq] & rank_bb;
+            if (r >= rank) masks.supporters[1][sq] |= masks.adjacent[sq] & rank_bb;
+        }
+    }
+    return masks;
+}
+
+constexpr PawnMasks MASKS = make_pawn_masks();
+
+static uint64_t pawn_attacks(uint64_t pawns, int color) {
+    uint64_t west = pawns & ~FILE_A_BB, east = pawns & ~(FILE_A_BB << 7);
+    return color == 0 ? (west << 7) | (east << 9) : (west >> 9) | (east >> 7);
+}
+
+PawnEntry evaluate_pawns(uint64_t white_pawns, uint64_t black_pawns) {
+    PawnEntry entry = {};
+    const uint64_t pawns[2] = {white_pawns, black_pawns};
+
+    for (int color = 0; color < 2; color++) {
+        const uint64_t us = pawns[color], them = pawns[1 - color];
+        const uint64_t their_attacks = pawn_attacks(them, 1 - color);
+        const int sign = color == 0 ? 1 : -1;
+        int score = 0;
+
+        uint64_t bb = us;
+        while (bb) {
+            const int sq = __builtin_ctzll(bb);
+            bb &= bb - 1;
+            const int relative_rank = color == 0 ? sq / 8 : 7 - sq / 8;
+
+            if (!(them & MASKS.passed[color][sq]) && !(us & MASKS.forward[color][sq])) {
+                entry.passed[color] |= 1ULL << sq;
+                score += PASSED_RANK[relative_rank];
+            }
+
+            if (!(us & MASKS.adjacent[sq])) {
+                score += ISOLATED;
+            } else if (!(us & MASKS.supporters[color][sq])) {
+                // no pawn can ever defend it, and an enemy pawn controls the square in front
+                const int stop = color == 0 ? sq + 8 : sq - 8;
+                if (stop >= 0 && stop < 64 && (their_attacks & (1ULL << stop))) score += BACKWARD;
+            }
+
+            // count the rear pawn of every doubled pair once
+            if (us & MASKS.forward[color][sq]) score += DOUBLED;
+        }
+
+        entry.score += sign * score;
+    }
+
+    return entry;
+}
+
+const PawnEntry& probe_pawns(uint64_t key, uint64_t white_pawns, uint64_t black_pawns) {
+    const uint32_t generation = pawn_generation.load(memory_order_relaxed);
+    if (!pawn_table) {
+        pawn_table = make_unique<PawnEntry[]>(PAWN_TABLE_SIZE);
+        pawn_table_generation = generation;
+    } else if (pawn_table_generation != generation) {
+        fill(pawn_table.get(), pawn_table.get() + PAWN_TABLE_SIZE, PawnEntry{});
+        pawn_table_generation = generation;
+    }
+
+    PawnEntry& entry = pawn_table[key & (PAWN_TABLE_SIZE - 1)];
+    thread_probes++;
+
+    // An empty slot has key 0 and no score, which is also right for a board without pawns.
+    if (entry.key == key) {
+        thread_hits++;
+        return entry;
+    }
+
+    entry = evaluate_pawns(white_pawns, black_pawns);
+    entry.key = key;
+    return entry;
+}
+
+int pawn_shield(const chess::Board& board, chess::Color color) {
+    const uint64_t pawns = board.pieces(chess::PieceType::PAWN, color).getBits();
+    const int king = board.kingSq(color).index();
+    const int relative_rank = color == chess::Color::WHITE ? king / 8 : 7 - king / 8;
+    if (relative_rank > 1) return 0;
+    return __builtin_popcountll(pawns & MASKS.shield[color][king]) * SHIELD;
+}
+
+void flush_pawn_stats() {
+    pawn_probes.fetch_add(thread_probes, memory_order_relaxed);
+    pawn_hits.fetch_add(thread_hits, memory_order_relaxed);
+    thread_probes = thread_hits = 0;
+}
+
+void clear_pawn_tables() {
+    pawn_generation.fetch_add(1, memory_order_relaxed);
+}
@@ -0,0 +1,116 @@
+#include "perft.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "search.hpp"
+
+using namespace chess;
+using namespace std;
+
+// Lockless entry, the check word is the key xor the count so a torn write never validates.
+struct PerftEntry {
+    atomic<uint64_t> check{0};
+    atomic<uint64_t> nodes{0};
+};
+
+class PerftTable {
+public:
+    explicit PerftTable(int hash_mb) {
+        size_t count = (size_t)hash_mb * 1024 * 1024 / sizeof(PerftEntry);
+        size = 1;
+        while (size * 2 <= count) size *= 2;
+        entries = make_unique<PerftEntry[]>(size);
+    }
+
+    bool probe(uint64_t key, uint64_t& nodes) const {
+        const PerftEntry& entry = entries[key & (size - 1)];
+        uint64_t n = entry.nodes.load(memory_order_relaxed);
+        if ((entry.check.load(memory_order_relaxed) ^ n) != key) return false;
+        nodes = n;
+        return true;
+    }
+
+    void store(uint64_t key, uint64_t nodes) {
+        PerftEntry& entry = entries[key & (size - 1)];
+        entry.nodes.store(nodes, memory_order_relaxed);
+        entry.check.store(key ^ nodes, memory_order_relaxed);
+    }
+
+private:
+    unique_ptr<PerftEntry[]> entries;
+    size_t size;
+};
+
+static uint64_t perft_key(const Board& board, int depth) {
+    return board.hash() ^ ((uint64_t)depth * 0x9E3779B97F4A7C15ULL);
+}
+
+static uint64_t perft_recursive(Board& board, int depth, PerftTable* table) {
+    // the last ply only needs the number of moves, not the moves
+    if (depth <= 1) return movegen::countLegalMoves(board);
+
+    // a hit doesn't need the moves, so the table is probed before generating them
+    uint64_t key = perft_key(board, depth);
+    uint64_t nodes = 0;
+    if (table && table->probe(key, nodes)) return nodes;
+
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+
+    for (const auto& move : moves) {
+        board.makeMove(move);
+        nodes += perft_recursive(board, depth - 1, table);
+        board.unmakeMove(move);
+    }
+
+    if (table) table->store(key, nodes);
+    return nodes;
+}
+
+static uint64_t run_perft(Board& board, int depth, int threads, int hash, bool print_moves) {
+    auto start = chrono::steady_clock::now();
+
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+
+    unique_ptr<PerftTable> table = hash > 0 ? make_unique<PerftTable>(hash) : nullptr;
+    vector<uint64_t> counts(moves.size(), depth <= 1 ? 1 : 0);
+
+    if (depth > 1) {
+        LennyPOOL lenny_pool(threads);
+        for (int i = 0; i < moves.size(); ++i) {
+            lenny_pool.run([&, i]() {
+                Board board_copy = board;
+                board_copy.makeMove(moves[i]);
+                counts[i] = perft_recursive(board_copy, depth - 1, table.get());
+            });
+        }
+        lenny_pool.wait_all();
+    }
+
+    uint64_t total = depth <= 0 ? 1 : 0;
+    for (int i = 0; i < moves.size() && depth > 0; ++i) {
+        if (print_moves) cout << uci::moveToUci(moves[i]) << ": " << counts[i] << endl;
+        total += counts[i];
+    }
+
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+    if (print_moves) cout << endl;
+    cout << "Nodes: " << total << endl;
+    cout << "Time (ms): " << elapsed / 1000 << endl;
+    cout << "Mnps: " << (double)total / (elapsed + 1) << endl;
+
+    return total;
+}
+
+uint64_t perft(Board& board, int depth, int threads, int hash) {
+    return run_perft(board, depth, threads, hash, false);
+}
+
+uint64_t divide(Board& board, int depth, int threads, int hash) {
+    return run_perft(board, depth, threads, hash, true);
+}
@@ -1,8 +1,10 @@
 #include <chrono>
+#include <memory>
 #include "chess.hpp"
 #include "search.hpp"
 #include "evaluation.hpp"
 #include "constants.hpp"
+#include "pawns.hpp"
 
 using namespace chess;
 using namespace std;
@@ -14,6 +16,44 @@ std::mutex queue_mutex;
 std::condition_variable condition;
 std::atomic<bool> stop;
 std::atomic<int> active_tasks{0};
+
+// The engine settings declared in constants.hpp, set from the command line and UCI options.
+int quiescence_depth = DEFAULT_DEPTH_Q;
+int mm_depth = DEFAULT_DEPTH_MM;
+float time_limit = 0; // Not being used.
+bool debug_mode = false;
+int evals[1000];
+
+std::atomic<bool> stop_search{false};
+std::atomic<std::uint64_t> nodes_searched{0};
+
+static SearchLimits active_limits;
+static std::chrono::steady_clock::time_point search_start;
+static thread_local std::uint64_t thread_nodes = 0;
+static thread_local std::uint64_t thread_flushed = 0;  // Nodes this thread has flushed, ever.
+static thread_local std::uint64_t thread_node_limit = 0;  // search_single's budget, in thread_flushed terms.
+static thread_local bool thread_stop = false;             // Like stop_search, for this thread alone.
+
+static std::int64_t elapsed_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - search_start).count();
+}
+
+// Folds this thread's node count into the shared total and checks the node and time limits.
+static void flush_nodes() {
+    std::uint64_t total = nodes_searched.fetch_add(thread_nodes, std::memory_order_relaxed) + thread_nodes;
+    thread_flushed += thread_nodes;
+    thread_nodes = 0;
+    if (thread_node_limit && thread_flushed >= thread_node_limit) thread_stop = true;
+
+    if (active_limits.nodes && total >= active_limits.nodes) stop_search = true;
+    if (active_limits.movetime && elapsed_ms() >= active_limits.movetime) stop_search = true;
+}
+
+// Counts a node locally, only touching the shared counter every NODE_CHECK_INTERVAL nodes.
+static inline void count_node() {
+    if (++thread_nodes >= NODE_CHECK_INTERVAL) flush_nodes();
+}
+
 LennyPOOL::LennyPOOL(int max_threads) : max_threads(max_threads), stop(false) {
     for (int i = 0; i < max_threads; ++i) {
         threads.emplace_back([this, i] {
@@ -41,15 +81,6 @@ LennyPOOL::LennyPOOL(int max_threads) : max_threads(max_threads), stop(false) {
     }
 }
 
-template<class F>
-void LennyPOOL::run(F&& f) {
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        tasks.emplace(std::forward<F>(f));
-    }
-    condition.notify_one();
-}
-
 void LennyPOOL::wait_all() {
     std::unique_lock<std::mutex> lock(queue_mutex);
     while (true) {
@@ -97,17 +128,33 @@ void sort_moves(chess::Movelist& moves, const chess::Board& board) {
 }
 
 
-std::pair<int, std::string> quiescence_search (int q_depth, int alpha, int beta, Color color, Board board) {
+// The game result at a node from its pseudo-legal moves, GameResult::NONE while the game goes on.
+// Same as board.isGameOver(), but it stops at the first legal move instead of generating them all.
+static GameResult game_result(const Board& board, const Movelist& moves) {
+	if (board.isHalfMoveDraw()) return board.getHalfMoveDrawType().second;
+	if (board.isInsufficientMaterial() || board.isRepetition()) return GameResult::DRAW;
+
+	for (const auto& move : moves) {
+		if (board.isLegal(move)) return GameResult::NONE;
+	}
+	return board.inCheck() ? GameResult::LOSE : GameResult::DRAW;
+}
+
+std::pair<int, std::string> quiescence_search (int q_depth, int alpha, int beta, Color color, EvalBoard board) {
+	count_node();
+	if (stop_search.load(std::memory_order_relaxed) || thread_stop) return {0, ""};
+
 	if (q_depth == 0 || appear_quiet(board)) return {evaluation(board), ""};
 
 	Movelist moves;
-	movegen::legalmoves(moves, board);
+	movegen::pseudolegalmoves(moves, board);
 
-	if (board.isGameOver().second == GameResult::DRAW) {
+	GameResult result = game_result(board, moves);
+	if (result == GameResult::DRAW) {
 		return {0, ""};
 	}
 
-	if (board.isGameOver().first == GameResultReason::CHECKMATE) {
+	if (result == GameResult::LOSE) {
 		return {board.sideToMove() == Color::BLACK ? MAX_SCORE:-MAX_SCORE, ""};
 	}
 
@@ -117,8 +164,9 @@ std::pair<int, std::string> quiescence_search (int q_depth, int alpha, int beta,
 		int max_eval = -MAX_SCORE;
 		for (int i = 0; i < moves.size(); i++) {
 			const auto move = moves[i];
+			if (!board.isLegal(move)) continue;
 			board.makeMove(move);
-			auto [eval, prev_move_str] = quiescence_search(q_depth, alpha, beta, 1 - color, board);
+			auto [eval, prev_move_str] = quiescence_search(q_depth - 1, alpha, beta, 1 - color, board);
 			board.unmakeMove(move);
 
 			if (eval > max_eval) {
@@ -137,8 +185,9 @@ std::pair<int, std::string> quiescence_search (int q_depth, int alpha, int beta,
 		int min_eval = MAX_SCORE;
 		for (int i = 0; i < moves.size(); i++) {
 			const auto move = moves[i];
+			if (!board.isLegal(move)) continue;
 			board.makeMove(move);
-			auto [eval, prev_move_str] = quiescence_search(q_depth, alpha, beta, 1 - color, board);
+			auto [eval, prev_move_str] = quiescence_search(q_depth - 1, alpha, beta, 1 - color, board);
 			board.unmakeMove(move);
 
 			if (eval < min_eval) {
@@ -156,15 +205,19 @@ std::pair<int, std::string> quiescence_search (int q_depth, int alpha, int beta,
 	}
 }
 
-std::pair<int, std::string> minimax (int mm_depth, int alpha, int beta, Color color, Board board) {
+std::pair<int, std::string> minimax (int mm_depth, int alpha, int beta, Color color, EvalBoard board) {
+    count_node();
+    if (stop_search.load(std::memory_order_relaxed) || thread_stop) return {0, ""};
+
     chess::Movelist moves;
-    chess::movegen::legalmoves(moves, board);
+    chess::movegen::pseudolegalmoves(moves, board);
 
-    if (board.isGameOver().second == GameResult::DRAW) {
+    GameResult result = game_result(board, moves);
+    if (result == GameResult::DRAW) {
 		return {0, ""};
 	}
 
-	if (board.isGameOver().first == GameResultReason::CHECKMATE) {
+	if (result == GameResult::LOSE) {
 		return {board.sideToMove() == Color::BLACK ? MAX_SCORE:-MAX_SCORE, ""};
 	}
 
@@ -181,6 +234,7 @@ std::pair<int, std::string> minimax (int mm_depth, int alpha, int beta, Color co
 				int max_eval = -MAX_SCORE;
 				for (int i = 0; i < moves.size(); i++) {
 					const auto move = moves[i];
+					if (!board.isLegal(move)) continue;
 					board.makeMove(move);
 					auto [eval, prev_move_str] = quiescence_search(quiescence_depth, alpha, beta, 1 - color, board);
 					board.unmakeMove(move);
@@ -200,6 +254,7 @@ std::pair<int, std::string> minimax (int mm_depth, int alpha, int beta, Color co
 				int min_eval = MAX_SCORE;
 				for (int i = 0; i < moves.size(); i++) {
 					const auto move = moves[i];
+					if (!board.isLegal(move)) continue;
 					board.makeMove(move);
 					auto [eval, prev_move_str] = quiescence_search(quiescence_depth, alpha, beta, 1 - color, board);
 					board.unmakeMove(move);
@@ -222,6 +277,7 @@ std::pair<int, std::string> minimax (int mm_depth, int alpha, int beta, Color co
     int best_score = color == chess::Color::WHITE ? -MAX_SCORE : MAX_SCORE;
 
     for (const auto& move : moves) {
+        if (!board.isLegal(move)) continue;
         board.makeMove(move);
         auto [score, prev_move_str] = minimax(mm_depth - 1, alpha, beta, chess::Color(1 - int(color)), board);
         board.unmakeMove(move);
@@ -250,31 +306,31 @@ std::pair<int, std::string> minimax (int mm_depth, int alpha, int beta, Color co
     return {best_score, best_move_str};
 }
 
-chess::Move findBestMove(chess::Board& board, int depth, int max_threads) {
-    chess::Movelist moves;
-    chess::movegen::legalmoves(moves, board);
-    if (moves.empty()) {
-        std::cout << "No legal moves available." << std::endl;
-        return chess::Move();
-    }
-
-    sort_moves(moves, board);
-    std::vector<int> evals(moves.size());
+// Searches every root move to the given depth, splitting them over the pool. Sets evals[i] and
+// done[i] for each root move whose search completed before stop_search was raised.
+static void search_root(EvalBoard& board, const chess::Movelist& moves, int depth, LennyPOOL& lenny_pool,
+                        std::vector<int>& evals, std::vector<char>& done) {
     std::atomic<int> alpha(-MAX_SCORE);
     std::atomic<int> beta(MAX_SCORE);
-    LennyPOOL lenny_pool(max_threads);
-
     chess::Color current_turn = board.sideToMove();
-    auto start_time = std::chrono::high_resolution_clock::now();
+
+    std::fill(done.begin(), done.end(), 0);
 
     for (size_t i = 0; i < moves.size(); ++i) {
         lenny_pool.run([&, i]() {
-            chess::Board board_copy = board;
+            EvalBoard board_copy = board;
             board_copy.makeMove(moves[i]);
             auto[eval, pv_move] = minimax(depth - 1, alpha.load(), beta.load(), 
                                chess::Color(1 - int(current_turn)), board_copy);
+            flush_nodes();
+            flush_pawn_stats();
+            flush_eval_stats();
+
+            // An aborted subtree returns a meaningless score, keep it out of the window.
+            if (stop_search.load(std::memory_order_relaxed)) return;
 
             evals[i] = eval;
+            done[i] = 1;
             // cout << i << " " << uci::moveToSan(board, moves[i]) << " " << pv_move << endl;
             if (current_turn == chess::Color::WHITE) {
                 int current_alpha = alpha.load();
@@ -290,16 +346,187 @@ chess::Move findBestMove(chess::Board& board, int depth, int max_threads) {
         });
     }
     lenny_pool.wait_all();
-    size_t best_index = 0;
-    int best_eval = current_turn == chess::Color::WHITE ? -MAX_SCORE : MAX_SCORE;
+}
 
-    for (size_t i = 0; i < moves.size(); ++i) {
-        if ((current_turn == chess::Color::WHITE && evals[i] > best_eval) ||
-            (current_turn == chess::Color::BLACK && evals[i] < best_eval)) {
-            best_eval = evals[i];
-            best_index = i;
+// Prints a UCI info line for a finished iteration, the score is from the side to move's view.
+static void send_info(int depth, int eval, chess::Color turn) {
+    int score = turn == chess::Color::WHITE ? eval : -eval;
+    std::int64_t time = elapsed_ms();
+    std::uint64_t nodes = nodes_searched.load();
+
+    std::cout << "info depth " << depth;
+    if (score > W_WIN_THRE || score < B_WIN_THRE) {
+        int plies = MAX_SCORE - std::abs(score) + 1;
+        std::cout << " score mate " << (score > 0 ? (plies + 1) / 2 : -(plies + 1) / 2);
+    } else {
+        std::cout << " score cp " << score;
+    }
+    std::cout << " nodes " << nodes << " nps " << nodes * 1000 / (time + 1) << " time " << time << std::endl;
+}
+
+// The pool searches run on. Its workers outlive a search, so their pawn tables and eval caches
+// stay warm from one move to the next; it is only rebuilt when the thread count changes.
+static LennyPOOL& search_pool(int threads) {
+    static std::unique_ptr<LennyPOOL> pool;
+    static int pool_threads = 0;
+
+    if (!pool || pool_threads != threads) {
+        pool.reset();
+        pool = std::make_unique<LennyPOOL>(threads);
+        pool_threads = threads;
+    }
+    return *pool;
+}
+
+void clear_search_caches() {
+    clear_pawn_tables();
+    clear_eval_caches();
+}
+
+chess::Move findBestMove(chess::Board& board, const SearchLimits& limits, int max_threads) {
+    stop_search = false;
+    nodes_searched = 0;
+    thread_nodes = 0;
+    active_limits = limits;
+    search_start = std::chrono::steady_clock::now();
+    std::uint64_t cache_hits = eval_cache_hits, cache_misses = eval_cache_misses;
+
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, board);
+
+    if (!limits.searchmoves.empty()) {
+        chess::Movelist restricted;
+        for (const auto& move : moves) {
+            if (std::find(limits.searchmoves.begin(), limits.searchmoves.end(), move) != limits.searchmoves.end())
+                restricted.add(move);
+        }
+        if (!restricted.empty()) moves = restricted;
+    }
+
+    if (moves.empty()) {
+        std::cout << "No legal moves available." << std::endl;
+        return chess::Move();
+    }
+
+    sort_moves(moves, board);
+
+    // Without a time or node budget a single fixed-depth iteration is enough, otherwise
+    // deepen iteratively so there is always a finished iteration to fall back on.
+    bool open_ended = limits.infinite || limits.movetime || limits.nodes;
+    int target_depth = limits.depth ? limits.depth : limits.mate ? 2 * limits.mate - 1 : mm_depth;
+    if (open_ended && !limits.depth && !limits.mate) target_depth = MAX_DEPTH;
+    int first_depth = open_ended ? 1 : target_depth;
+
+    std::vector<int> evals(moves.size());
+    std::vector<char> done(moves.size());
+    LennyPOOL& lenny_pool = search_pool(max_threads);
+
+    chess::Color current_turn = board.sideToMove();
+    int sign = current_turn == chess::Color::WHITE ? 1 : -1;
+    int best_index = -1;
+    int best_eval = -sign * MAX_SCORE;
+
+    // The search works on a board that keeps its evaluation terms up to date.
+    EvalBoard root = EvalBoard(board);
+
+    for (int depth = first_depth; depth <= target_depth; depth++) {
+        search_root(root, moves, depth, lenny_pool, evals, done);
+
+        // An interrupted iteration is only trusted when there is nothing better to go on.
+        bool complete = std::find(done.begin(), done.end(), 0) == done.end();
+        if (!complete && best_index != -1) break;
+
+        int iter_index = -1;
+        int iter_eval = -sign * MAX_SCORE;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            if (done[i] && (iter_index == -1 || sign * evals[i] > sign * iter_eval)) {
+                iter_eval = evals[i];
+                iter_index = i;
+            }
+        }
+        if (iter_index != -1) {
+            best_index = iter_index;
+            best_eval = iter_eval;
         }
+        if (!complete) break;
+
+        send_info(depth, best_eval, current_turn);
+
+        if (limits.mate && sign * best_eval > W_WIN_THRE) break;
+        if (stop_search) break;
+    }
+
+    // "go infinite" must not return a move before the GUI says "stop".
+    while (limits.infinite && !stop_search) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (best_index == -1) best_index = 0;
+    if (debug_mode) {
+        std::cout << "info string eval cache hits " << eval_cache_hits - cache_hits
+                  << " misses " << eval_cache_misses - cache_misses << std::endl;
     }
     std::cout << "Best move index: " << best_index << " with eval: " << best_eval << std::endl;
     return moves[best_index];
-}
\ No newline at end of file
+}
+
+chess::Move findBestMove(chess::Board& board, int depth, int max_threads) {
+    SearchLimits limits;
+    limits.depth = depth;
+    return findBestMove(board, limits, max_threads);
+}
+
+std::pair<int, chess::Move> search_single(EvalBoard& board, int depth, std::uint64_t nodes) {
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, board);
+    if (moves.empty()) return {evaluation(board), chess::Move::NO_MOVE};
+
+    sort_moves(moves, board);
+
+    chess::Color current_turn = board.sideToMove();
+    int sign = current_turn == chess::Color::WHITE ? 1 : -1;
+    int best_eval = 0;
+    bool searched = false;
+
+    thread_stop = false;
+    thread_node_limit = nodes ? thread_flushed + thread_nodes + nodes : 0;
+
+    // A node budget is met by deepening until it is used up, a depth is searched directly.
+    int target_depth = depth ? depth : MAX_DEPTH;
+    for (int d = nodes ? 1 : target_depth; d <= target_depth; d++) {
+        int alpha = -MAX_SCORE, beta = MAX_SCORE;
+        int iter_index = -1;
+        int iter_eval = -sign * MAX_SCORE;
+
+        for (int i = 0; i < moves.size(); i++) {
+            board.makeMove(moves[i]);
+            int eval = minimax(d - 1, alpha, beta, ~current_turn, board).first;
+            board.unmakeMove(moves[i]);
+            if (thread_stop) break;
+
+            if (iter_index == -1 || sign * eval > sign * iter_eval) {
+                iter_eval = eval;
+                iter_index = i;
+            }
+            if (current_turn == chess::Color::WHITE) alpha = std::max(alpha, iter_eval);
+            else beta = std::min(beta, iter_eval);
+        }
+
+        // An iteration cut short by the budget only counts if there is nothing else to go on.
+        if (thread_stop && searched) break;
+        if (iter_index != -1) {
+            // the best move goes first, so the next iteration starts with the tightest window
+            std::rotate(moves.begin(), moves.begin() + iter_index, moves.begin() + iter_index + 1);
+            best_eval = iter_eval;
+            searched = true;
+        }
+        if (thread_stop || sign * best_eval > W_WIN_THRE) break;
+    }
+
+    thread_stop = false;
+    thread_node_limit = 0;
+    flush_nodes();
+    flush_pawn_stats();
+    flush_eval_stats();
+    return {best_eval, moves[0]};
+}
@@ -0,0 +1,128 @@
+#include "training.hpp"
+
+using namespace std;
+
+TrainingReader::~TrainingReader() {
+    close();
+}
+
+bool TrainingReader::open(const string& path) {
+    close();
+    file = fopen(path.c_str(), "rb");
+    return file != nullptr;
+}
+
+void TrainingReader::close() {
+    if (file) fclose(file);
+    file = nullptr;
+    left_in_chunk = 0;
+}
+
+size_t TrainingReader::read(vector<TrainingEntry>& out, size_t max_entries) {
+    size_t total = 0;
+    while (file && total < max_entries) {
+        if (left_in_chunk == 0) {
+            TrainingChunkHeader header;
+            if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != TRAINING_MAGIC) break;
+            left_in_chunk = header.count;
+            continue;
+        }
+
+        size_t wanted = min<size_t>(left_in_chunk, max_entries - total);
+        size_t old_size = out.size();
+        out.resize(old_size + wanted);
+        size_t got = fread(out.data() + old_size, sizeof(TrainingEntry), wanted, file);
+        out.resize(old_size + got);
+        total += got;
+        left_in_chunk -= got;
+        if (got < wanted) break;
+    }
+    return total;
+}
+
+TrainingWriter::~TrainingWriter() {
+    close();
+}
+
+bool TrainingWriter::open(const string& path) {
+    close();
+    file = fopen(path.c_str(), "ab");
+    if (!file) return false;
+    setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    closing = false;
+    writer = thread(&TrainingWriter::run, this);
+    return true;
+}
+
+void TrainingWriter::close() {
+    if (!file) return;
+    {
+        lock_guard<mutex> lock(mutex_);
+        closing = true;
+    }
+    ready.notify_one();
+    writer.join();
+    fclose(file);
+    file = nullptr;
+}
+
+void TrainingWriter::write(vector<TrainingEntry> entries) {
+    if (entries.empty()) return;
+    {
+        lock_guard<mutex> lock(mutex_);
+        queue.push_back(std::move(entries));
+    }
+    ready.notify_one();
+}
+
+uint64_t TrainingWriter::written() const {
+    lock_guard<mutex> lock(mutex_);
+    return written_;
+}
+
+void TrainingWriter::write_chunk(const TrainingEntry* entries, uint32_t count) {
+    TrainingChunkHeader header{TRAINING_MAGIC, count};
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(entries, sizeof(TrainingEntry), count, file);
+}
+
+void TrainingWriter::run() {
+    vector<TrainingEntry> chunk;
+    chunk.reserve(TRAINING_CHUNK_ENTRIES);
+
+    while (true) {
+        deque<vector<TrainingEntry>> pending;
+        bool last;
+        {
+            unique_lock<mutex> lock(mutex_);
+            ready.wait(lock, [this] { return closing || !queue.empty(); });
+            pending.swap(queue);
+            last = closing;
+        }
+
+        // Whole chunks only, except for what is left over at the very end.
+        uint64_t flushed = 0;
+        for (const auto& entries : pending) {
+            for (const auto& entry : entries) {
+                chunk.push_back(entry);
+                if (chunk.size() == TRAINING_CHUNK_ENTRIES) {
+                    write_chunk(chunk.data(), chunk.size());
+                    flushed += chunk.size();
+                    chunk.clear();
+                }
+            }
+        }
+        if (last && !chunk.empty()) {
+            write_chunk(chunk.data(), chunk.size());
+            flushed += chunk.size();
+            chunk.clear();
+        }
+
+        {
+            lock_guard<mutex> lock(mutex_);
+            written_ += flushed;
+        }
+        if (last) break;
+    }
+    fflush(file);
+}
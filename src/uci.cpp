@@ -5,6 +5,11 @@
 #include "search.hpp"
 #include "evaluation.hpp"
 #include "constants.hpp"
+#include "bench.hpp"
+#include "perft.hpp"
+#include "book.hpp"
+#include "nnue.hpp"
+#include "params.hpp"
 
 
 using namespace std;
@@ -12,10 +17,25 @@ using namespace chess;
 ///////////////// UCI implementation //////////////////
 
 int move_overhead = 0; // Default value
+bool own_book = false;
+PolyglotBook book;
+string eval_file;  // Network in use, empty for the PeSTO evaluation
+int search_threads = MAX_THREAD;
 
 void send_uci_info() {
     std::cout << "id name silkrow" << endl;
     std::cout << "id author Erkai Yu" << endl;
+    std::cout << "option name Move Overhead type spin default 0 min 0 max 5000" << endl;
+    std::cout << "option name OwnBook type check default false" << endl;
+    std::cout << "option name BookFile type string default <empty>" << endl;
+    std::cout << "option name EvalFile type string default <empty>" << endl;
+    std::cout << "option name Threads type spin default " << MAX_THREAD << " min 1 max " << MAX_THREAD << endl;
+    // Tuning builds (make tune) expose the search parameters for the SPSA driver.
+    for (const auto& param : search_params()) {
+        if (!param.value) continue;
+        std::cout << "option name " << param.name << " type spin default " << param.default_value << " min "
+                  << param.min << " max " << param.max << endl;
+    }
     std::cout << "uciok" << endl;
 }
 
@@ -32,73 +52,208 @@ void set_option(const std::string& name, const std::string& value) {
     if (name == "Move Overhead") {
         move_overhead = stoi(value);  // Convert value to integer and set move_overhead
         std::cout << "info string Set Move Overhead to " << move_overhead << " ms" << endl;
+    } else if (name == "OwnBook") {
+        own_book = value == "true";
+        std::cout << "info string Set OwnBook to " << (own_book ? "true" : "false") << endl;
+    } else if (name == "BookFile") {
+        if (value.empty() || value == "<empty>") {
+            book.close();
+        } else if (book.open(value)) {
+            std::cout << "info string Loaded book " << value << endl;
+        } else {
+            std::cout << "info string Could not open book " << value << endl;
+        }
+    } else if (name == "EvalFile") {
+        if (value.empty() || value == "<empty>") {
+            nnue_unload();
+            eval_file.clear();
+            std::cout << "info string Using the PeSTO evaluation" << endl;
+        } else if (nnue_load(value)) {
+            eval_file = value;
+            std::cout << "info string Loaded network " << value << " (" << nnue_simd() << ")" << endl;
+        } else {
+            std::cout << "info string Could not load network " << value << endl;
+        }
+    } else if (name == "Threads") {
+        try {
+            search_threads = clamp(stoi(value), 1, MAX_THREAD);
+            std::cout << "info string Set Threads to " << search_threads << endl;
+        } catch (const exception&) {
+            std::cout << "info string Invalid Threads value " << value << endl;
+        }
+    } else if (set_param(name, value)) {
+        // the quiescence depth is seeded from its parameter at startup
+        if (name == "DEFAULT_DEPTH_Q") quiescence_depth = DEFAULT_DEPTH_Q;
     } else {
         // For unsupported options, ignore or log a message
         std::cout << "info string Unsupported option: " << name << endl;
     }
 }
 
+// Blocks until a running background search has sent its bestmove.
+static void wait_for_search(thread& search_thread) {
+    if (search_thread.joinable()) search_thread.join();
+}
+
 void handle_uci_command() {
     string command;
 	Board board;
+    thread search_thread;
+    string position_base;           // "startpos" or the FEN of the last "position" command
+    vector<string> position_moves;  // Moves played on top of position_base
     while (getline(cin, command)) {
         if (command == "uci") {
             send_uci_info();
+        } else if (command == "ucinewgame") {
+            wait_for_search(search_thread);
+            clear_search_caches();
+            position_base.clear();
+            position_moves.clear();
         } else if (command == "isready") {
             send_ready_ok();
         } else if (command.rfind("position", 0) == 0) {
+            wait_for_search(search_thread);
             // Handle "position" command
             size_t startpos_start = command.find("startpos");
             size_t fen_start = command.find("fen");
+            size_t moves_start = command.find("moves");
+
+            string base = "";
             if (startpos_start != string::npos) {
+                base = "startpos";
+            } else if (fen_start != string::npos) {
+                base = command.substr(fen_start + 4, moves_start == string::npos ? string::npos : moves_start - fen_start - 5);
+            }
+
+            vector<string> moves;
+            if (moves_start != string::npos) {
+                istringstream move_stream(command.substr(moves_start + 6));
+                string move_str;
+                while (move_stream >> move_str) moves.push_back(move_str);
+            }
+
+            // A game usually resends its whole move list with one or two new moves appended,
+            // keep the board (and its repetition history) and play only the new moves then.
+            size_t applied = 0;
+            bool extends = !base.empty() && base == position_base && moves.size() >= position_moves.size() &&
+                           equal(position_moves.begin(), position_moves.end(), moves.begin());
+            if (extends) {
+                applied = position_moves.size();
+            } else if (base == "startpos") {
                 // If "startpos" is given, set up the board with the initial position
                 board = Board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
-            } else if (fen_start != string::npos) {
+            } else if (!base.empty()) {
                 // Handle FEN string if present
-                string fen_string = command.substr(fen_start + 4);
-                board = Board(fen_string);
+                board = Board(base);
             }
 
             // Handle moves after "position" command
-            size_t moves_start = command.find("moves");
-            if (moves_start != string::npos) {
-                string moves_string = command.substr(moves_start + 6);
-                istringstream move_stream(moves_string);
-                string move_str;
-                while (move_stream >> move_str) {
-                    Move move = uci::uciToMove(board, move_str);
-                    board.makeMove(move);
-                }
+            for (size_t i = applied; i < moves.size(); i++) {
+                Move move = uci::uciToMove(board, moves[i]);
+                board.makeMove(move);
             }
+
+            position_base = base;
+            position_moves = std::move(moves);
         } else if (command.rfind("go", 0) == 0) {
-			size_t btime_pos = command.find("btime");
-            size_t wtime_pos = command.find("wtime");
+            wait_for_search(search_thread);
 
-			int time_left;
+            SearchLimits limits;
+            int time_left = 0;
+            bool in_searchmoves = false;
 
-			if (board.sideToMove() == Color::WHITE && wtime_pos != string::npos) {
-                time_left = stoi(command.substr(wtime_pos + 6));
-            } else if (board.sideToMove() == Color::BLACK && btime_pos != string::npos) {
-                time_left = stoi(command.substr(btime_pos + 6));
+            istringstream go_stream(command.substr(2));
+            string token;
+            while (go_stream >> token) {
+                if (token == "wtime" || token == "btime") {
+                    int time = 0;
+                    if (go_stream >> time && (token == "wtime") == (board.sideToMove() == Color::WHITE)) time_left = time;
+                    in_searchmoves = false;
+                } else if (token == "depth") {
+                    go_stream >> limits.depth;
+                    in_searchmoves = false;
+                } else if (token == "nodes") {
+                    go_stream >> limits.nodes;
+                    in_searchmoves = false;
+                } else if (token == "movetime") {
+                    go_stream >> limits.movetime;
+                    in_searchmoves = false;
+                } else if (token == "mate") {
+                    go_stream >> limits.mate;
+                    in_searchmoves = false;
+                } else if (token == "infinite") {
+                    limits.infinite = true;
+                    in_searchmoves = false;
+                } else if (token == "searchmoves") {
+                    in_searchmoves = true;
+                } else if (in_searchmoves) {
+                    Move move = uci::uciToMove(board, token);
+                    if (move != Move::NO_MOVE) limits.searchmoves.push_back(move);
+                } else if (token == "winc" || token == "binc" || token == "movestogo") {
+                    go_stream >> token;
+                }
             }
 
-            if (time_left > 10*60*1000) mm_depth = 8; 
-			else if (time_left > 4*60*1000) mm_depth = 7;
-			else if (time_left > 1*60*1000) mm_depth = 6;
-			else mm_depth = 5;
-
-            // Run search algorithm
-            Movelist moves;
-            movegen::legalmoves(moves, board);
-			LennyPOOL lenny_pool(MAX_THREAD);
-			Move picked_move = findBestMove(board, mm_depth, MAX_THREAD);
-            send_best_move(picked_move);
+            // Clock-based games keep the depth ladder, explicit limits take precedence.
+            if (time_left && !limits.depth && !limits.nodes && !limits.movetime && !limits.mate && !limits.infinite) {
+                if (time_left > 10*60*1000) limits.depth = 8; 
+                else if (time_left > 4*60*1000) limits.depth = 7;
+                else if (time_left > 1*60*1000) limits.depth = 6;
+                else limits.depth = 5;
+            }
+
+            // A book hit is played right away, without a search.
+            if (own_book && !limits.infinite && limits.searchmoves.empty()) {
+                Move book_move = book.probe(board);
+                if (book_move != Move::NO_MOVE) {
+                    send_best_move(book_move);
+                    continue;
+                }
+            }
+
+            // Search in the background so "stop" and "isready" are still answered.
+            search_thread = thread([board, limits, threads = search_threads]() mutable {
+                Move picked_move = findBestMove(board, limits, threads);
+                send_best_move(picked_move);
+            });
+        } else if (command.rfind("bench", 0) == 0) {
+            wait_for_search(search_thread);
+
+            int depth = BENCH_DEPTH, threads = BENCH_THREADS, hash = BENCH_HASH;
+            istringstream bench_stream(command.substr(5));
+            int value;
+            if (bench_stream >> value) depth = value;
+            if (bench_stream >> value) threads = clamp(value, 1, MAX_THREAD);
+            if (bench_stream >> value) hash = value;
+            bench(depth, threads, hash, eval_file);
+        } else if (command.rfind("perft", 0) == 0 || command.rfind("divide", 0) == 0) {
+            // perft|divide depth [hash], on the current position with all threads
+            wait_for_search(search_thread);
+
+            int depth = 1, hash = 0;
+            istringstream perft_stream(command.substr(command.find(' ') == string::npos ? command.size() : command.find(' ')));
+            int value;
+            if (perft_stream >> value) depth = value;
+            if (perft_stream >> value) hash = value;
+            if (depth < 1 || hash < 0) {
+                std::cout << "info string Usage: perft|divide depth [hash], depth >= 1 and hash >= 0" << endl;
+                continue;
+            }
+            if (command[0] == 'p') perft(board, depth, MAX_THREAD, hash);
+            else divide(board, depth, MAX_THREAD, hash);
         } else if (command == "stop") {
             // Stop the search and return the best move found so far
+            stop_search = true;
+            wait_for_search(search_thread);
         } else if (command == "quit") {
+            stop_search = true;
+            wait_for_search(search_thread);
             break;
         } else if (command.rfind("setoption", 0) == 0) {
-            // Handle "setoption" command for setting engine options
+            // Handle "setoption" command for setting engine options. They swap the network, the book
+            // and search parameters a running search reads, so stop it first.
+            stop_search = true;
+            wait_for_search(search_thread);
             size_t name_start = command.find("name");
             size_t value_start = command.find("value");
             if (name_start != string::npos && value_start != string::npos) {
@@ -112,6 +267,7 @@ void handle_uci_command() {
             debug_mode = false;
         }
     }
+    wait_for_search(search_thread);
 }
 
 ////////////// End of UCI imlementation /////////////
\ No newline at end of file
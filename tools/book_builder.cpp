@@ -0,0 +1,280 @@
+// silkfish-book: builds a Polyglot opening book from PGN files.
+//
+// Usage: ./silkfish-book -o book.bin [-ply N] [-min N] [-threads N] [-mem MB] file1.pgn [file2.pgn ...]
+//
+// Every file is memory-mapped and cut into one range per thread, each starting at a "[Event" tag,
+// and pgn::readGamesParallel parses the ranges concurrently, one visitor per thread. The statistics
+// live in a fixed-size open-addressing table per thread, so memory stays bounded no matter how big
+// the input is: when a table fills up, its rarest entries are dropped.
+
+#include "chess.hpp"
+#include "book.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chess;
+using namespace std;
+
+struct BookOptions {
+    string output = "book.bin";
+    int max_ply = 20;           // Only record the first max_ply plies of a game.
+    uint32_t min_games = 3;     // Drop (position, move) pairs played fewer times.
+    int threads = max(1u, thread::hardware_concurrency());
+    size_t mem_mb = 1024;       // Memory shared by all the per-thread tables.
+};
+
+// Statistics of one (position, move) pair, from the point of view of the side that played the move.
+struct BookStat {
+    uint64_t key;
+    uint16_t move;
+    uint16_t used;
+    uint32_t games;
+    uint32_t wins;
+    uint32_t draws;
+};
+
+// Open-addressing (linear probing) table of BookStats with a fixed capacity.
+class BookMap {
+public:
+    explicit BookMap(size_t bytes) {
+        capacity = 1;
+        while (capacity * 2 * sizeof(BookStat) <= bytes) capacity *= 2;
+        slots.assign(capacity, BookStat{});
+    }
+
+    void add(uint64_t key, uint16_t move, uint32_t games, uint32_t wins, uint32_t draws) {
+        // keep the table at most 3/4 full so probe sequences stay short
+        if (filled * 4 >= capacity * 3) prune();
+
+        BookStat& stat = find(key, move);
+        if (!stat.used) {
+            stat = BookStat{key, move, 1, 0, 0, 0};
+            filled++;
+        }
+        stat.games += games;
+        stat.wins += wins;
+        stat.draws += draws;
+    }
+
+    template<class F>
+    void for_each(F&& f) const {
+        for (const auto& stat : slots) {
+            if (stat.used) f(stat);
+        }
+    }
+
+private:
+    BookStat& find(uint64_t key, uint16_t move) {
+        size_t index = (key ^ (move * 0x9E3779B97F4A7C15ULL)) & (capacity - 1);
+        while (slots[index].used && (slots[index].key != key || slots[index].move != move)) {
+            index = (index + 1) & (capacity - 1);
+        }
+        return slots[index];
+    }
+
+    // Drops the rarest entries and rehashes the rest, the threshold rises until enough room is freed.
+    void prune() {
+        vector<BookStat> old;
+        old.swap(slots);
+        uint32_t threshold = 1;
+
+        while (true) {
+            size_t kept = count_if(old.begin(), old.end(),
+                                   [&](const BookStat& s) { return s.used && s.games > threshold; });
+            if (kept * 2 <= capacity) break;
+            threshold *= 2;
+        }
+
+        slots.assign(capacity, BookStat{});
+        filled = 0;
+        for (const auto& stat : old) {
+            if (!stat.used || stat.games <= threshold) continue;
+            find(stat.key, stat.move) = stat;
+            filled++;
+        }
+    }
+
+    vector<BookStat> slots;
+    size_t capacity;
+    size_t filled = 0;
+};
+
+class BookVisitor : public pgn::Visitor {
+public:
+    BookVisitor(BookMap& map, const BookOptions& options) : map(map), options(options) {}
+
+    void startPgn() override {
+        board.setFen(constants::STARTPOS);
+        ply = 0;
+        white_score = -1;
+    }
+
+    void header(string_view key, string_view value) override {
+        if (key == "Result") {
+            if (value == "1-0") white_score = 2;
+            else if (value == "0-1") white_score = 0;
+            else if (value == "1/2-1/2") white_score = 1;
+        } else if (key == "FEN") {
+            board.setFen(value);
+        } else if (key == "Variant" && value != "Standard" && value != "From Position") {
+            skipPgn(true);
+        }
+    }
+
+    void startMoves() override {
+        // Unfinished games say nothing about the moves played in them.
+        if (white_score < 0) skipPgn(true);
+    }
+
+    void move(string_view san, string_view) override {
+        if (san.empty()) return;
+        if (ply >= options.max_ply) {
+            skipPgn(true);
+            return;
+        }
+
+        auto parsed = uci::parseSanFast(board, san);
+        if (!parsed) {
+            skipPgn(true);
+            return;
+        }
+        Move move = *parsed;
+
+        int score = board.sideToMove() == Color::WHITE ? white_score : 2 - white_score;
+        map.add(polyglot_key(board), move_to_polyglot(move), 1, score == 2, score == 1);
+
+        board.makeMove(move);
+        ply++;
+    }
+
+    void endPgn() override {
+        games++;
+    }
+
+    uint64_t games = 0;
+
+private:
+    BookMap& map;
+    const BookOptions& options;
+    Board board;
+    int ply = 0;
+    int white_score = -1;
+};
+
+static void usage_error() {
+    cout << "Usage: ./silkfish-book -o book.bin [-ply N] [-min N] [-threads N] [-mem MB] file1.pgn [file2.pgn ...]"
+         << endl;
+}
+
+int main(int argc, char* argv[]) {
+    BookOptions options;
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if (arg == "-o" && has_value) options.output = argv[++i];
+            else if (arg == "-ply" && has_value) options.max_ply = stoi(argv[++i]);
+            else if (arg == "-min" && has_value) options.min_games = stoi(argv[++i]);
+            else if (arg == "-threads" && has_value) options.threads = max(1, stoi(argv[++i]));
+            else if (arg == "-mem" && has_value) options.mem_mb = stoul(argv[++i]);
+            else if (arg[0] == '-') {
+                usage_error();
+                return 1;
+            } else files.push_back(arg);
+        } catch (const exception&) {
+            usage_error();
+            return 1;
+        }
+    }
+
+    if (files.empty()) {
+        usage_error();
+        return 1;
+    }
+
+    size_t table_bytes = options.mem_mb * 1024 * 1024 / options.threads;
+    vector<unique_ptr<BookMap>> maps;
+    vector<BookVisitor> visitors;
+    visitors.reserve(options.threads);
+
+    for (int t = 0; t < options.threads; t++) {
+        maps.push_back(make_unique<BookMap>(table_bytes));
+        visitors.emplace_back(*maps[t], options);
+    }
+
+    for (const auto& path : files) {
+        pgn::MappedFile file(path);
+        if (!file.isOpen()) {
+            cout << "Could not open " << path << endl;
+            return 1;
+        }
+        pgn::readGamesParallel(file.view(), visitors);
+    }
+
+    // Gather the per-thread tables, freeing each once copied, and sum the counts of every
+    // (position, move) over all of them before min_games is applied. Folding the tables into
+    // one another could prune an entry before the other threads' counts for it were added.
+    vector<BookStat> stats;
+    for (auto& map : maps) {
+        map->for_each([&](const BookStat& s) { stats.push_back(s); });
+        map.reset();
+    }
+
+    sort(stats.begin(), stats.end(), [](const BookStat& a, const BookStat& b) {
+        return a.key != b.key ? a.key < b.key : a.move < b.move;
+    });
+
+    vector<PolyglotEntry> entries;
+    for (size_t i = 0; i < stats.size();) {
+        BookStat total = stats[i];
+        for (i++; i < stats.size() && stats[i].key == total.key && stats[i].move == total.move; i++) {
+            total.games += stats[i].games;
+            total.wins += stats[i].wins;
+            total.draws += stats[i].draws;
+        }
+
+        if (total.games < options.min_games) continue;
+        // the usual Polyglot weighting, two points per win and one per draw
+        uint64_t weight = 2 * (uint64_t)total.wins + total.draws;
+        if (weight == 0) continue;
+        entries.push_back({total.key, total.move, (uint16_t)min<uint64_t>(weight, 0xFFFF), 0});
+    }
+
+    sort(entries.begin(), entries.end(), [](const PolyglotEntry& a, const PolyglotEntry& b) {
+        if (a.key != b.key) return a.key < b.key;
+        return a.weight != b.weight ? a.weight > b.weight : a.move < b.move;
+    });
+
+    ofstream out(options.output, ios::binary);
+    if (!out) {
+        cout << "Could not write " << options.output << endl;
+        return 1;
+    }
+
+    for (const auto& entry : entries) {
+        unsigned char data[16];
+        for (int i = 0; i < 8; i++) data[i] = entry.key >> (56 - 8 * i);
+        data[8] = entry.move >> 8;
+        data[9] = entry.move & 0xFF;
+        data[10] = entry.weight >> 8;
+        data[11] = entry.weight & 0xFF;
+        memset(data + 12, 0, 4);
+        out.write(reinterpret_cast<const char*>(data), sizeof(data));
+    }
+
+    uint64_t total_games = 0;
+    for (const auto& visitor : visitors) total_games += visitor.games;
+
+    cout << "Games: " << total_games << endl;
+    cout << "Entries written: " << entries.size() << endl;
+    return 0;
+}
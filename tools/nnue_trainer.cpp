@@ -0,0 +1,450 @@
+// silkfish-trainer: trains the engine's NNUE on packed training positions.
+//
+// Usage: ./silkfish-trainer -o net.nnue [-init net.nnue] [-epochs N] [-batch N] [-lr X] [-gamma X] [-lambda X]
+//                           [-scale X] [-threads N] [-buffer N] data1.bin [data2.bin ...]
+//
+// The network of nnue.hpp is trained in float with Adam on minibatches, every thread computing the
+// gradient of its share of a batch. The input layer is sparse: only the rows of the features seen in
+// a batch are summed and updated. After every epoch the weights are quantized and written in the
+// engine's format, then loaded back to report how far the quantized evaluation is from the float one.
+//
+// The target of a position mixes its search score and game result, both as win probabilities:
+// lambda * sigmoid(score / scale) + (1 - lambda) * result. The loss is the squared difference
+// with sigmoid(eval / scale).
+
+#include "chess.hpp"
+#include "nnue.hpp"
+#include "training.hpp"
+
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chess;
+using namespace std;
+
+struct TrainerOptions {
+    string output = "net.nnue";
+    string init;                // Quantized network to start from instead of random weights.
+    int epochs = 10;
+    size_t batch = 16384;
+    float lr = 0.001f;
+    float gamma = 0.9f;         // Learning rate multiplier applied after every epoch.
+    float lambda = 0.75f;       // Weight of the search score in the target, the rest is the result.
+    float scale = 400;          // Centipawns per sigmoid unit.
+    int threads = max(1u, thread::hardware_concurrency());
+    size_t buffer = 1 << 22;    // Positions read (and shuffled) at a time.
+};
+
+// Every parameter lives in one float array, the input layer weights first, [feature][neuron].
+const size_t FT_W = 0;
+const size_t FT_B = FT_W + (size_t)NNUE_FEATURES * NNUE_HIDDEN;
+const size_t L1_W = FT_B + NNUE_HIDDEN;
+const size_t L1_B = L1_W + NNUE_L2 * 2 * NNUE_HIDDEN;
+const size_t OUT_W = L1_B + NNUE_L2;
+const size_t OUT_B = OUT_W + NNUE_L2;
+const size_t PARAMS = OUT_B + 1;
+
+// Weight limits that keep the quantized network in range: up to 32 pieces and the bias may add up
+// in an int16 accumulator, and the int8 layers hold at most 127 / NNUE_QB.
+const float FT_LIMIT = 32000.0f / NNUE_QA / 33;
+const float INT8_LIMIT = 127.0f / NNUE_QB;
+
+const float BETA1 = 0.9f, BETA2 = 0.999f, EPSILON = 1e-8f;
+
+// A decoded position: the active features of each side, side to move first, and its target.
+struct Sample {
+    int features[2][32];
+    int count;
+    float target;
+};
+
+static float sigmoid(float x) {
+    return 1.0f / (1.0f + exp(-x));
+}
+
+static Sample decode(const TrainingEntry& entry, const TrainerOptions& options) {
+    Board board = Board::Compact::decode(entry.board);
+    Color sides[2] = {board.sideToMove(), ~board.sideToMove()};
+    int buckets[2] = {nnue_king_bucket(sides[0], board.kingSq(sides[0])), nnue_king_bucket(sides[1], board.kingSq(sides[1]))};
+
+    Sample sample;
+    sample.count = 0;
+    auto occupied = board.occ();
+    while (occupied && sample.count < 32) {
+        Square sq = Square(occupied.pop());
+        Piece piece = board.at(sq);
+        for (int i = 0; i < 2; i++) sample.features[i][sample.count] = nnue_feature(sides[i], piece, sq, buckets[i]);
+        sample.count++;
+    }
+
+    float result = (entry.result + 1) / 2.0f;
+    sample.target = options.lambda * sigmoid(entry.score / options.scale) + (1 - options.lambda) * result;
+    return sample;
+}
+
+// Float version of the engine's forward pass, in pawns / NNUE_SCALE units like the quantized one.
+// Keeps the intermediate values the backward pass needs.
+struct Activations {
+    float acc[2][NNUE_HIDDEN];
+    float x[2 * NNUE_HIDDEN];
+    float h[NNUE_L2];
+    float a[NNUE_L2];
+    float out;
+};
+
+static void forward(const float* p, const Sample& s, Activations& act) {
+    for (int side = 0; side < 2; side++) {
+        float* acc = act.acc[side];
+        memcpy(acc, p + FT_B, sizeof(float) * NNUE_HIDDEN);
+        for (int k = 0; k < s.count; k++) {
+            const float* row = p + FT_W + (size_t)s.features[side][k] * NNUE_HIDDEN;
+            for (int i = 0; i < NNUE_HIDDEN; i++) acc[i] += row[i];
+        }
+        for (int i = 0; i < NNUE_HIDDEN; i++) act.x[side * NNUE_HIDDEN + i] = clamp(acc[i], 0.0f, 1.0f);
+    }
+
+    act.out = p[OUT_B];
+    for (int j = 0; j < NNUE_L2; j++) {
+        const float* row = p + L1_W + j * 2 * NNUE_HIDDEN;
+        float sum = p[L1_B + j];
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i++) sum += row[i] * act.x[i];
+        act.h[j] = sum;
+        act.a[j] = clamp(sum, 0.0f, 1.0f);
+        act.out += p[OUT_W + j] * act.a[j];
+    }
+}
+
+// Per-thread gradient, and which input layer rows it touched.
+struct Gradient {
+    vector<float> g = vector<float>(PARAMS, 0.0f);
+    vector<uint8_t> touched = vector<uint8_t>(NNUE_FEATURES, 0);
+    double loss = 0;
+};
+
+static void backward(const float* p, const Sample& s, const Activations& act, float scale, Gradient& grad) {
+    float* g = grad.g.data();
+    float pred = sigmoid(act.out * NNUE_SCALE / scale);
+    float error = pred - s.target;
+    grad.loss += error * error;
+
+    float g_out = 2 * error * pred * (1 - pred) * NNUE_SCALE / scale;
+    g[OUT_B] += g_out;
+
+    float dx[2 * NNUE_HIDDEN] = {};
+    for (int j = 0; j < NNUE_L2; j++) {
+        g[OUT_W + j] += g_out * act.a[j];
+        if (act.h[j] <= 0 || act.h[j] >= 1) continue;
+
+        float dh = g_out * p[OUT_W + j];
+        const float* row = p + L1_W + j * 2 * NNUE_HIDDEN;
+        float* g_row = g + L1_W + j * 2 * NNUE_HIDDEN;
+        g[L1_B + j] += dh;
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+            g_row[i] += dh * act.x[i];
+            dx[i] += dh * row[i];
+        }
+    }
+
+    for (int side = 0; side < 2; side++) {
+        float dacc[NNUE_HIDDEN];
+        for (int i = 0; i < NNUE_HIDDEN; i++) {
+            float v = act.acc[side][i];
+            dacc[i] = v > 0 && v < 1 ? dx[side * NNUE_HIDDEN + i] : 0.0f;
+            g[FT_B + i] += dacc[i];
+        }
+        for (int k = 0; k < s.count; k++) {
+            int feature = s.features[side][k];
+            float* g_row = g + FT_W + (size_t)feature * NNUE_HIDDEN;
+            for (int i = 0; i < NNUE_HIDDEN; i++) g_row[i] += dacc[i];
+            grad.touched[feature] = 1;
+        }
+    }
+}
+
+static float param_limit(size_t index) {
+    return index >= L1_W ? INT8_LIMIT : FT_LIMIT;
+}
+
+static bool save_network(const vector<float>& p, const string& path) {
+    auto net = make_unique<NnueNetwork>();
+    auto quantize = [](float v, float scale, float lo, float hi) { return clamp(round(v * scale), lo, hi); };
+
+    for (size_t i = 0; i < (size_t)NNUE_FEATURES * NNUE_HIDDEN; i++)
+        net->ft_weights[i] = quantize(p[FT_W + i], NNUE_QA, -32767, 32767);
+    for (int i = 0; i < NNUE_HIDDEN; i++) net->ft_bias[i] = quantize(p[FT_B + i], NNUE_QA, -32767, 32767);
+    for (int i = 0; i < NNUE_L2 * 2 * NNUE_HIDDEN; i++) net->l1_weights[i] = quantize(p[L1_W + i], NNUE_QB, -127, 127);
+    for (int i = 0; i < NNUE_L2; i++) {
+        net->l1_bias[i] = quantize(p[L1_B + i], NNUE_QA * NNUE_QB, -1e9, 1e9);
+        net->out_weights[i] = quantize(p[OUT_W + i], NNUE_QB, -127, 127);
+    }
+    net->out_bias = quantize(p[OUT_B], NNUE_QA * NNUE_QB, -1e9, 1e9);
+
+    ofstream out(path, ios::binary);
+    uint32_t header[5] = {NNUE_MAGIC, NNUE_VERSION, NNUE_FEATURES, NNUE_HIDDEN, NNUE_L2};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(net->ft_weights), sizeof(net->ft_weights));
+    out.write(reinterpret_cast<const char*>(net->ft_bias), sizeof(net->ft_bias));
+    out.write(reinterpret_cast<const char*>(net->l1_weights), sizeof(net->l1_weights));
+    out.write(reinterpret_cast<const char*>(net->l1_bias), sizeof(net->l1_bias));
+    out.write(reinterpret_cast<const char*>(net->out_weights), sizeof(net->out_weights));
+    out.write(reinterpret_cast<const char*>(&net->out_bias), sizeof(net->out_bias));
+    return (bool)out;
+}
+
+// Starts from a quantized network, the inverse of save_network.
+static bool load_network(vector<float>& p, const string& path) {
+    if (!nnue_load(path)) return false;
+    const NnueNetwork& net = *nnue_network();
+
+    for (size_t i = 0; i < (size_t)NNUE_FEATURES * NNUE_HIDDEN; i++) p[FT_W + i] = net.ft_weights[i] / (float)NNUE_QA;
+    for (int i = 0; i < NNUE_HIDDEN; i++) p[FT_B + i] = net.ft_bias[i] / (float)NNUE_QA;
+    for (int i = 0; i < NNUE_L2 * 2 * NNUE_HIDDEN; i++) p[L1_W + i] = net.l1_weights[i] / (float)NNUE_QB;
+    for (int i = 0; i < NNUE_L2; i++) {
+        p[L1_B + i] = net.l1_bias[i] / (float)(NNUE_QA * NNUE_QB);
+        p[OUT_W + i] = net.out_weights[i] / (float)NNUE_QB;
+    }
+    p[OUT_B] = net.out_bias / (float)(NNUE_QA * NNUE_QB);
+    nnue_unload();
+    return true;
+}
+
+static void random_init(vector<float>& p) {
+    mt19937 rng(12345);
+    // uniform, scaled by the typical number of active inputs of each layer
+    auto fill = [&](size_t begin, size_t end, float bound) {
+        uniform_real_distribution<float> dist(-bound, bound);
+        for (size_t i = begin; i < end; i++) p[i] = dist(rng);
+    };
+    fill(FT_W, FT_B, 1 / sqrt(32.0f));
+    fill(L1_W, L1_B, 1 / sqrt(2.0f * NNUE_HIDDEN));
+    fill(OUT_W, OUT_B, 1 / sqrt((float)NNUE_L2));
+}
+
+// Reads the data files one after the other, a buffer of positions at a time.
+class DataStream {
+public:
+    explicit DataStream(const vector<string>& files) : files(files) {}
+
+    // The next buffer of positions, empty at the end of the epoch (the next call starts a new one).
+    vector<TrainingEntry> next(size_t max_entries) {
+        vector<TrainingEntry> entries;
+        entries.reserve(max_entries);
+        while (entries.size() < max_entries && index < files.size()) {
+            if (!opened && !reader.open(files[index])) {
+                cout << "Could not open " << files[index] << endl;
+                index++;
+                continue;
+            }
+            opened = true;
+            if (reader.read(entries, max_entries - entries.size()) == 0) {
+                reader.close();
+                opened = false;
+                index++;
+            }
+        }
+        if (entries.empty()) index = 0;
+        return entries;
+    }
+
+private:
+    vector<string> files;
+    TrainingReader reader;
+    size_t index = 0;
+    bool opened = false;
+};
+
+static void usage_error() {
+    cout << "Usage: ./silkfish-trainer -o net.nnue [-init net.nnue] [-epochs N] [-batch N] [-lr X] [-gamma X] [-lambda X]"
+         << " [-scale X] [-threads N] [-buffer N] data1.bin [data2.bin ...]" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    TrainerOptions options;
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if (arg == "-o" && has_value) options.output = argv[++i];
+            else if (arg == "-init" && has_value) options.init = argv[++i];
+            else if (arg == "-epochs" && has_value) options.epochs = stoi(argv[++i]);
+            else if (arg == "-batch" && has_value) options.batch = max(1ul, stoul(argv[++i]));
+            else if (arg == "-lr" && has_value) options.lr = stof(argv[++i]);
+            else if (arg == "-gamma" && has_value) options.gamma = stof(argv[++i]);
+            else if (arg == "-lambda" && has_value) options.lambda = stof(argv[++i]);
+            else if (arg == "-scale" && has_value) options.scale = stof(argv[++i]);
+            else if (arg == "-threads" && has_value) options.threads = max(1, stoi(argv[++i]));
+            else if (arg == "-buffer" && has_value) options.buffer = max(1ul, stoul(argv[++i]));
+            else if (arg[0] == '-') {
+                usage_error();
+                return 1;
+            } else files.push_back(arg);
+        } catch (const exception&) {
+            usage_error();
+            return 1;
+        }
+    }
+
+    if (files.empty()) {
+        usage_error();
+        return 1;
+    }
+
+    vector<float> params(PARAMS, 0.0f), m(PARAMS, 0.0f), v(PARAMS, 0.0f);
+    if (!options.init.empty()) {
+        if (!load_network(params, options.init)) {
+            cout << "Could not load network " << options.init << endl;
+            return 1;
+        }
+    } else {
+        random_init(params);
+    }
+
+    const int threads = options.threads;
+    vector<Gradient> gradients(threads);
+
+    // Shared training state, only changed by the step barrier's completion function.
+    DataStream stream(files);
+    vector<TrainingEntry> buffer = stream.next(options.buffer);
+    if (buffer.empty()) {
+        cout << "No training positions found" << endl;
+        return 1;
+    }
+    future<vector<TrainingEntry>> prefetch = async(launch::async, [&]() { return stream.next(options.buffer); });
+
+    mt19937_64 rng(1);
+    shuffle(buffer.begin(), buffer.end(), rng);
+    size_t batch_start = 0, batch_end = min(options.batch, buffer.size());
+    int epoch = 0;
+    uint64_t step = 0, epoch_positions = 0;
+    float lr = options.lr;
+    double epoch_loss = 0;
+    bool done = false;
+    auto epoch_start = chrono::steady_clock::now();
+
+    // Fake-quantization check: how far the engine's integer evaluation is from the float one.
+    auto report_quantization = [&]() {
+        if (!nnue_load(options.output)) return;
+        double error = 0;
+        size_t checked = min<size_t>(buffer.size(), 10000);
+        for (size_t i = 0; i < checked; i++) {
+            Board board = Board::Compact::decode(buffer[i].board);
+            Activations act;
+            forward(params.data(), decode(buffer[i], options), act);
+            error += abs(nnue_evaluate(board) - act.out * NNUE_SCALE);
+        }
+        nnue_unload();
+        cout << "Quantization error: " << error / max<size_t>(checked, 1) << " cp on average" << endl;
+    };
+
+    // Runs on one thread once all threads are done with a step: moves on to the next batch.
+    auto next_step = [&]() noexcept {
+        for (auto& gradient : gradients) {
+            epoch_loss += gradient.loss;
+            gradient.loss = 0;
+        }
+        epoch_positions += batch_end - batch_start;
+        step++;
+
+        if (step % 100 == 0) {
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - epoch_start).count();
+            cout << "epoch " << epoch + 1 << " positions " << epoch_positions << " loss " << epoch_loss / epoch_positions
+                 << " pos/s " << (uint64_t)(epoch_positions / max(seconds, 1e-3)) << endl;
+        }
+
+        batch_start = batch_end;
+        if (batch_start >= buffer.size()) {
+            buffer = prefetch.get();
+            if (buffer.empty()) {
+                cout << "Epoch " << epoch + 1 << " done, " << epoch_positions << " positions, loss "
+                     << epoch_loss / max<uint64_t>(epoch_positions, 1) << endl;
+                if (save_network(params, options.output)) {
+                    cout << "Saved " << options.output << endl;
+                } else {
+                    cout << "Could not write " << options.output << endl;
+                }
+
+                epoch++;
+                lr *= options.gamma;
+                epoch_loss = 0;
+                epoch_positions = 0;
+                epoch_start = chrono::steady_clock::now();
+                buffer = stream.next(options.buffer);
+                report_quantization();
+                if (epoch == options.epochs) done = true;
+            }
+            if (!done) prefetch = async(launch::async, [&]() { return stream.next(options.buffer); });
+            shuffle(buffer.begin(), buffer.end(), rng);
+            batch_start = 0;
+        }
+        batch_end = min(batch_start + options.batch, buffer.size());
+    };
+
+    barrier gradients_ready(threads);
+    barrier step_done(threads, next_step);
+
+    auto worker = [&](int t) {
+        Gradient& own = gradients[t];
+        while (!done) {
+            // Each thread computes the gradient of its share of the batch...
+            size_t n = batch_end - batch_start;
+            size_t begin = batch_start + n * t / threads, end = batch_start + n * (t + 1) / threads;
+            for (size_t i = begin; i < end; i++) {
+                Sample sample = decode(buffer[i], options);
+                Activations act;
+                forward(params.data(), sample, act);
+                backward(params.data(), sample, act, options.scale, own);
+            }
+            gradients_ready.arrive_and_wait();
+
+            // ...then sums and applies its share of the parameters, input rows nobody saw are skipped.
+            const float step_lr = lr * sqrt(1 - pow(BETA2, step + 1)) / (1 - pow(BETA1, step + 1));
+            const float inv_n = 1.0f / n;
+            auto update = [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    float g = 0;
+                    for (auto& gradient : gradients) {
+                        g += gradient.g[i];
+                        gradient.g[i] = 0;
+                    }
+                    g *= inv_n;
+                    m[i] = BETA1 * m[i] + (1 - BETA1) * g;
+                    v[i] = BETA2 * v[i] + (1 - BETA2) * g * g;
+                    float limit = param_limit(i);
+                    params[i] = clamp(params[i] - step_lr * m[i] / (sqrt(v[i]) + EPSILON), -limit, limit);
+                }
+            };
+
+            for (int feature = t; feature < NNUE_FEATURES; feature += threads) {
+                bool seen = false;
+                for (auto& gradient : gradients) {
+                    seen |= gradient.touched[feature];
+                    gradient.touched[feature] = 0;
+                }
+                if (seen) update(FT_W + (size_t)feature * NNUE_HIDDEN, FT_W + (size_t)(feature + 1) * NNUE_HIDDEN);
+            }
+            update(FT_B + (PARAMS - FT_B) * t / threads, FT_B + (PARAMS - FT_B) * (t + 1) / threads);
+
+            step_done.arrive_and_wait();
+        }
+    };
+
+    cout << "Training on " << files.size() << " file(s) with " << threads << " threads" << endl;
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++) workers.emplace_back(worker, t);
+    worker(0);
+    for (auto& w : workers) w.join();
+
+    return 0;
+}
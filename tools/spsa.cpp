@@ -0,0 +1,357 @@
+// silkfish-spsa: tunes the search parameters of params.hpp with SPSA self-play.
+//
+// Usage: ./silkfish-spsa [-engine ./silkfish-tune] [-iterations N] [-threads N] [-depth N] [-random N] [-o file]
+//
+// The engine has to be a tuning build (make tune), whose parameters are UCI options; it lists them
+// with "./silkfish-tune params". Every iteration perturbs all parameters at once by +-c_k, plays a
+// pair of games (colors swapped, same random opening) between the two perturbed engines and moves
+// the parameters toward the side that scored better. Every thread runs its own pair of engines, so
+// iterations are played concurrently against a shared set of parameters.
+
+#include "chess.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace chess;
+using namespace std;
+
+struct SpsaOptions {
+    string engine = "./silkfish-tune";
+    string output = "params.txt";
+    int iterations = 1000;
+    int threads = max(1u, thread::hardware_concurrency());
+    int depth = 4;              // Every move is a "go depth" search, which keeps games short and reproducible.
+    int random_plies = 8;       // Random opening plies, so the game pairs don't repeat.
+    int max_plies = 300;        // Longer games are drawn.
+};
+
+// The usual SPSA gains (as fishtest sets them): the perturbation shrinks from step * N^gamma to step,
+// and the learning rate is r_end = a_end / step^2 at the last iteration.
+const double SPSA_ALPHA = 0.602;
+const double SPSA_GAMMA = 0.101;
+const double SPSA_R_END = 0.002;
+
+struct TuneParam {
+    string name;
+    double value;
+    int min;
+    int max;
+    int step;
+};
+
+// An engine process spoken to over its stdin and stdout.
+class UciEngine {
+public:
+    ~UciEngine() { stop(); }
+
+    bool start(const string& path) {
+        int to_engine[2], from_engine[2];
+        if (pipe2(to_engine, O_CLOEXEC) || pipe2(from_engine, O_CLOEXEC)) return false;
+
+        pid = fork();
+        if (pid == 0) {
+            dup2(to_engine[0], STDIN_FILENO);
+            dup2(from_engine[1], STDOUT_FILENO);
+            execl(path.c_str(), path.c_str(), (char*)nullptr);
+            _exit(127);
+        }
+        close(to_engine[0]);
+        close(from_engine[1]);
+        if (pid < 0) {
+            close(to_engine[1]);
+            close(from_engine[0]);
+            return false;
+        }
+
+        dead = false;
+        in = fdopen(to_engine[1], "w");
+        out = fdopen(from_engine[0], "r");
+        send("uci");
+        if (!wait_for("uciok")) return false;
+        send("setoption name Threads value 1");
+        return ready();
+    }
+
+    void stop() {
+        if (in) {
+            send("quit");
+            fclose(in);
+            in = nullptr;
+        }
+        if (out) {
+            fclose(out);
+            out = nullptr;
+        }
+        if (pid > 0) {
+            waitpid(pid, nullptr, 0);
+            pid = -1;
+        }
+    }
+
+    bool alive() const { return out != nullptr && !dead; }
+
+    void send(const string& line) {
+        if (!in) return;
+        fputs(line.c_str(), in);
+        fputc('\n', in);
+        fflush(in);
+    }
+
+    bool read_line(string& line) {
+        line.clear();
+        if (!out) return false;
+        int c;
+        while ((c = fgetc(out)) != EOF && c != '\n') line += (char)c;
+        if (c == EOF && line.empty()) {
+            dead = true;
+            return false;
+        }
+        return true;
+    }
+
+    bool wait_for(const string& token) {
+        string line;
+        while (read_line(line)) {
+            if (line.rfind(token, 0) == 0) return true;
+        }
+        return false;
+    }
+
+    bool ready() {
+        send("isready");
+        return wait_for("readyok");
+    }
+
+    // Returns the move in UCI notation, empty if the engine died.
+    string go(const string& position, int depth) {
+        send(position);
+        send("go depth " + to_string(depth));
+        string line;
+        while (read_line(line)) {
+            if (line.rfind("bestmove", 0) != 0) continue;
+            istringstream stream(line);
+            string token, move;
+            stream >> token >> move;
+            return move;
+        }
+        return "";
+    }
+
+private:
+    pid_t pid = -1;
+    FILE* in = nullptr;
+    FILE* out = nullptr;
+    bool dead = false;
+};
+
+// Plays random legal moves from the start position, returns them in UCI notation.
+static vector<string> random_opening(int plies, mt19937_64& rng) {
+    while (true) {
+        Board board;
+        vector<string> moves;
+        for (int ply = 0; ply < plies; ply++) {
+            Movelist legal;
+            movegen::legalmoves(legal, board);
+            if (legal.empty()) break;
+            Move move = legal[rng() % legal.size()];
+            moves.push_back(uci::moveToUci(move));
+            board.makeMove(move);
+        }
+        if (board.isGameOver().second == GameResult::NONE) return moves;
+    }
+}
+
+// Plays one game from the opening, returns 1, 0 or -1 for a white win, draw or black win. An engine
+// that dies or plays an illegal move loses.
+static int play_game(UciEngine& white, UciEngine& black, const vector<string>& opening, const SpsaOptions& options) {
+    Board board;
+    vector<string> moves = opening;
+    for (const auto& uci_move : opening) board.makeMove(uci::uciToMove(board, uci_move));
+
+    white.send("ucinewgame");
+    black.send("ucinewgame");
+
+    for (int ply = 0; ply < options.max_plies; ply++) {
+        auto [reason, result] = board.isGameOver();
+        if (result != GameResult::NONE) {
+            if (result == GameResult::DRAW) return 0;
+            // the side to move is the one that got mated
+            return board.sideToMove() == Color::WHITE ? -1 : 1;
+        }
+
+        bool white_to_move = board.sideToMove() == Color::WHITE;
+        UciEngine& engine = white_to_move ? white : black;
+        string position = "position startpos";
+        if (!moves.empty()) position += " moves";
+        for (const auto& played : moves) position += " " + played;
+        string uci_move = engine.go(position, options.depth);
+
+        Movelist legal;
+        movegen::legalmoves(legal, board);
+        Move move = uci_move.empty() ? Move(Move::NO_MOVE) : uci::uciToMove(board, uci_move);
+        if (move == Move::NO_MOVE || find(legal.begin(), legal.end(), move) == legal.end()) {
+            cout << "Illegal move \"" << uci_move << "\" in " << board.getFen() << endl;
+            return white_to_move ? -1 : 1;
+        }
+
+        board.makeMove(move);
+        moves.push_back(uci_move);
+    }
+    return 0;
+}
+
+static bool read_params(const string& engine, vector<TuneParam>& params) {
+    FILE* pipe = popen((engine + " params").c_str(), "r");
+    if (!pipe) return false;
+
+    char buffer[256];
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+        string line = buffer;
+        replace(line.begin(), line.end(), ',', ' ');
+        istringstream stream(line);
+        TuneParam param;
+        int value;
+        if (stream >> param.name >> value >> param.min >> param.max >> param.step) {
+            param.value = value;
+            params.push_back(param);
+        }
+    }
+    return pclose(pipe) == 0 && !params.empty();
+}
+
+static void write_params(const string& path, const vector<TuneParam>& params) {
+    ofstream out(path);
+    for (const auto& param : params) out << param.name << ',' << lround(param.value) << endl;
+}
+
+static void usage_error() {
+    cout << "Usage: ./silkfish-spsa [-engine ./silkfish-tune] [-iterations N] [-threads N] [-depth N] [-random N] "
+            "[-o file]"
+         << endl;
+}
+
+int main(int argc, char* argv[]) {
+    SpsaOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if (arg == "-engine" && has_value) options.engine = argv[++i];
+            else if (arg == "-o" && has_value) options.output = argv[++i];
+            else if (arg == "-iterations" && has_value) options.iterations = max(1, stoi(argv[++i]));
+            else if (arg == "-threads" && has_value) options.threads = max(1, stoi(argv[++i]));
+            else if (arg == "-depth" && has_value) options.depth = max(1, stoi(argv[++i]));
+            else if (arg == "-random" && has_value) options.random_plies = max(0, stoi(argv[++i]));
+            else {
+                usage_error();
+                return 1;
+            }
+        } catch (const exception&) {
+            usage_error();
+            return 1;
+        }
+    }
+
+    vector<TuneParam> params;
+    if (!read_params(options.engine, params)) {
+        cout << "No tunable parameters from " << options.engine << " (is it a \"make tune\" build?)" << endl;
+        return 1;
+    }
+
+    // a dying engine must not take the driver down with it
+    signal(SIGPIPE, SIG_IGN);
+
+    const double big_a = 0.1 * options.iterations;
+    mutex params_mutex;
+    atomic<int> next_iteration{0};
+    atomic<int> wins{0}, draws{0}, losses{0};
+    vector<thread> workers;
+
+    for (int t = 0; t < options.threads; t++) {
+        workers.emplace_back([&, t]() {
+            mt19937_64 rng(random_device{}() ^ (uint64_t)t << 32);
+            UciEngine engines[2];
+
+            int k;
+            while ((k = next_iteration++) < options.iterations) {
+                for (auto& engine : engines) {
+                    if (engine.alive()) continue;
+                    engine.stop();
+                    if (!engine.start(options.engine)) {
+                        cout << "Could not start " << options.engine << endl;
+                        return;
+                    }
+                }
+
+                // engines[0] plays theta + c_k * delta, engines[1] theta - c_k * delta
+                vector<double> c_k(params.size()), delta(params.size());
+                vector<double> theta(params.size());
+                {
+                    lock_guard<mutex> lock(params_mutex);
+                    for (size_t i = 0; i < params.size(); i++) theta[i] = params[i].value;
+                }
+                for (size_t i = 0; i < params.size(); i++) {
+                    const TuneParam& param = params[i];
+                    c_k[i] = param.step * pow(options.iterations, SPSA_GAMMA) / pow(k + 1, SPSA_GAMMA);
+                    delta[i] = rng() & 1 ? 1 : -1;
+                    for (int side = 0; side < 2; side++) {
+                        double value = theta[i] + (side == 0 ? 1 : -1) * c_k[i] * delta[i];
+                        long rounded = clamp<long>(lround(value), param.min, param.max);
+                        engines[side].send("setoption name " + param.name + " value " + to_string(rounded));
+                    }
+                }
+                for (auto& engine : engines) engine.ready();
+
+                vector<string> opening = random_opening(options.random_plies, rng);
+                // score of engines[0], from -2 to 2 over the pair
+                int score = play_game(engines[0], engines[1], opening, options) -
+                            play_game(engines[1], engines[0], opening, options);
+                if (score > 0) wins++;
+                else if (score < 0) losses++;
+                else draws++;
+
+                lock_guard<mutex> lock(params_mutex);
+                for (size_t i = 0; i < params.size(); i++) {
+                    TuneParam& param = params[i];
+                    double c_end = param.step;
+                    double a_end = SPSA_R_END * c_end * c_end;
+                    double a = a_end * pow(big_a + options.iterations, SPSA_ALPHA);
+                    double a_k = a / pow(big_a + k + 1, SPSA_ALPHA);
+                    param.value = clamp<double>(param.value + a_k * score / (c_k[i] * delta[i]), param.min, param.max);
+                }
+
+                int done = wins + draws + losses;
+                if (done % 10 == 0 || done == options.iterations) {
+                    cout << "Iteration " << done << "/" << options.iterations << " (pairs +" << wins << " =" << draws
+                         << " -" << losses << ")";
+                    for (const auto& param : params) cout << " " << param.name << "=" << fixed << setprecision(2)
+                                                               << param.value;
+                    cout << endl;
+                    write_params(options.output, params);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    write_params(options.output, params);
+    cout << "Parameters written to " << options.output << endl;
+    return 0;
+}
@@ -0,0 +1,409 @@
+// silkfish-tuner: Texel tuning of the PeSTO tables in src/constants.hpp.
+//
+// Usage: ./silkfish-tuner -o tuned.hpp [-epochs N] [-lr X] [-k X] [-qdepth N] [-threads N] data1.epd [data2.bin ...]
+//
+// Every position is first resolved to the quiet leaf of a captures-only search with the engine's
+// evaluation, then reduced to what the tables see of it: the (piece, square) entries it adds or
+// subtracts, its game phase, and the mg/eg sum of the terms that are not tuned (pawn structure and
+// king shield). That is about 60 bytes a position, so millions fit in memory, and since the
+// evaluation is linear in the table entries an epoch is a single pass over that array.
+//
+// The loss is the mean squared difference between the game result and sigmoid(K * eval). K is
+// fitted to the untuned tables first unless given, then the tables are trained with full-batch Adam.
+// Text files hold one position per line, a FEN followed by the result as 1-0, 0-1, 1/2-1/2 or
+// [1.0], [0.5], [0.0]. Files ending in .bin are training files from gensfen.
+
+#include "chess.hpp"
+#include "constants.hpp"
+#include "evaluation.hpp"
+#include "pawns.hpp"
+#include "training.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chess;
+using namespace std;
+
+struct TunerOptions {
+    string output = "tuned.hpp";
+    int epochs = 300;
+    double lr = 1.0;       // Adam step size, in centipawns.
+    double k = 0;          // Sigmoid scale, 0 to fit it.
+    int qdepth = 6;        // Plies of captures when resolving a position to a quiet one.
+    int threads = max(1u, thread::hardware_concurrency());
+};
+
+// A table entry is PESTO_VALUE + PESTO_POSITION of one (piece, square), in the tables' own square
+// order (a8 first). There is one for the middlegame and one for the endgame.
+const int ENTRIES = 6 * 64;
+const uint16_t BLACK_BIT = 0x8000;  // Set on entries a black piece subtracts.
+
+struct TunerPosition {
+    uint32_t begin;      // First of its entries in the shared entry array.
+    uint8_t count;
+    uint8_t phase;       // Capped at MAX_PHASE.
+    uint8_t result;      // 0 loss, 1 draw, 2 win, for white.
+    int16_t fixed_mg;    // Terms that are not tuned, white-relative.
+    int16_t fixed_eg;
+};
+
+struct Dataset {
+    vector<TunerPosition> positions;
+    vector<uint16_t> entries;
+};
+
+struct RawPosition {
+    PackedBoard board;
+    uint8_t result;
+};
+
+// Alpha-beta over captures with the engine's evaluation, collecting the line that leads to the
+// quiet position the score comes from.
+static int resolve(EvalBoard& board, int alpha, int beta, int depth, vector<Move>& line) {
+    line.clear();
+    int stand_pat = evaluation(board) * (board.sideToMove() == Color::WHITE ? 1 : -1);
+    if (stand_pat >= beta || depth == 0) return stand_pat;
+    alpha = max(alpha, stand_pat);
+
+    Movelist captures;
+    movegen::legalmoves<movegen::MoveGenType::CAPTURE>(captures, board);
+    vector<Move> child;
+    for (const auto& move : captures) {
+        board.makeMove(move);
+        int score = -resolve(board, -beta, -alpha, depth - 1, child);
+        board.unmakeMove(move);
+
+        if (score > alpha) {
+            alpha = score;
+            line.assign(1, move);
+            line.insert(line.end(), child.begin(), child.end());
+            if (alpha >= beta) break;
+        }
+    }
+    return alpha;
+}
+
+// Reduces a position to its table entries, phase and untuned terms.
+static void add_position(Dataset& data, const Board& board, uint8_t result) {
+    TunerPosition position{(uint32_t)data.entries.size(), 0, 0, result, 0, 0};
+    int phase = 0;
+
+    auto occupied = board.occ();
+    while (occupied) {
+        Square sq = Square(occupied.pop());
+        Piece piece = board.at(sq);
+        bool white = piece.color() == Color::WHITE;
+        // the tables are written from white's side with a8 first, like make_psqt reads them
+        int table_sq = white ? sq.index() ^ 56 : sq.index();
+        data.entries.push_back((int)piece.type() * 64 + table_sq + (white ? 0 : BLACK_BIT));
+        phase += PHASE_INC[(int)piece.type()];
+        position.count++;
+    }
+    position.phase = min(phase, MAX_PHASE);
+
+    uint64_t white_pawns = board.pieces(PieceType::PAWN, Color::WHITE).getBits();
+    uint64_t black_pawns = board.pieces(PieceType::PAWN, Color::BLACK).getBits();
+    int fixed = evaluate_pawns(white_pawns, black_pawns).score;
+    fixed += pawn_shield(board, Color::WHITE) - pawn_shield(board, Color::BLACK);
+    position.fixed_mg = mg_value(fixed);
+    position.fixed_eg = eg_value(fixed);
+
+    data.positions.push_back(position);
+}
+
+static bool parse_result(const string& line, uint8_t& result) {
+    const pair<const char*, uint8_t> markers[] = {
+        {"1/2-1/2", 1}, {"1-0", 2}, {"0-1", 0}, {"[0.5]", 1}, {"[1.0]", 2}, {"[0.0]", 0}, {"[1]", 2}, {"[0]", 0},
+    };
+    for (const auto& [marker, value] : markers) {
+        if (line.find(marker) != string::npos) {
+            result = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void load_text(const string& path, vector<RawPosition>& raw) {
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        uint8_t result;
+        if (!parse_result(line, result)) continue;
+
+        // the first four fields, the move counters only if they are there
+        istringstream fields(line);
+        string field, fen;
+        for (int i = 0; i < 6 && fields >> field; i++) {
+            if (i >= 4 && !all_of(field.begin(), field.end(), ::isdigit)) break;
+            fen += (i ? " " : "") + field;
+        }
+
+        try {
+            raw.push_back({Board::Compact::encode(Board(fen)), result});
+        } catch (const exception&) {
+            continue;
+        }
+    }
+}
+
+static void load_training(const string& path, vector<RawPosition>& raw) {
+    TrainingReader reader;
+    if (!reader.open(path)) return;
+    vector<TrainingEntry> entries;
+    while (reader.read(entries, TRAINING_CHUNK_ENTRIES)) {
+        for (const auto& entry : entries) {
+            // the entry's result is for the side to move
+            bool white = Board::Compact::decode(entry.board).sideToMove() == Color::WHITE;
+            raw.push_back({entry.board, (uint8_t)((white ? entry.result : -entry.result) + 1)});
+        }
+        entries.clear();
+    }
+}
+
+// Resolves every position on all threads and packs the results into one dataset.
+static Dataset build_dataset(const vector<RawPosition>& raw, const TunerOptions& options) {
+    vector<Dataset> parts(options.threads);
+    vector<thread> workers;
+    for (int t = 0; t < options.threads; t++) {
+        workers.emplace_back([&, t]() {
+            size_t begin = raw.size() * t / options.threads, end = raw.size() * (t + 1) / options.threads;
+            vector<Move> line;
+            for (size_t i = begin; i < end; i++) {
+                EvalBoard board(Board::Compact::decode(raw[i].board));
+                // positions in check have no quiet leaf
+                if (board.inCheck()) continue;
+                resolve(board, -MAX_SCORE, MAX_SCORE, options.qdepth, line);
+                for (const auto& move : line) board.makeMove(move);
+                add_position(parts[t], board, raw[i].result);
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    Dataset data;
+    for (auto& part : parts) {
+        uint32_t offset = data.entries.size();
+        for (auto position : part.positions) {
+            position.begin += offset;
+            data.positions.push_back(position);
+        }
+        data.entries.insert(data.entries.end(), part.entries.begin(), part.entries.end());
+    }
+    return data;
+}
+
+// The tuned values, [0] middlegame and [1] endgame.
+using Tables = array<array<double, ENTRIES>, 2>;
+
+static double sigmoid(double x) {
+    return 1 / (1 + exp(-x));
+}
+
+// One pass over the dataset: returns the loss, and adds its gradient to `gradient` if given.
+static double pass(const Dataset& data, const Tables& tables, double k, int threads, Tables* gradient) {
+    vector<double> losses(threads, 0);
+    vector<Tables> gradients(gradient ? threads : 0);
+    vector<thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            size_t begin = data.positions.size() * t / threads, end = data.positions.size() * (t + 1) / threads;
+            Tables* own = gradient ? &gradients[t] : nullptr;
+            if (own) for (auto& half : *own) half.fill(0);
+            double loss = 0;
+
+            for (size_t i = begin; i < end; i++) {
+                const TunerPosition& p = data.positions[i];
+                const uint16_t* entries = data.entries.data() + p.begin;
+
+                double mg = p.fixed_mg, eg = p.fixed_eg;
+                for (int j = 0; j < p.count; j++) {
+                    int index = entries[j] & ~BLACK_BIT;
+                    double sign = entries[j] & BLACK_BIT ? -1 : 1;
+                    mg += sign * tables[0][index];
+                    eg += sign * tables[1][index];
+                }
+                double eval = (mg * p.phase + eg * (MAX_PHASE - p.phase)) / MAX_PHASE;
+                double s = sigmoid(k * eval);
+                double error = s - p.result / 2.0;
+                loss += error * error;
+
+                if (!own) continue;
+                double g = 2 * error * s * (1 - s) * k;
+                double g_mg = g * p.phase / MAX_PHASE, g_eg = g * (MAX_PHASE - p.phase) / MAX_PHASE;
+                for (int j = 0; j < p.count; j++) {
+                    int index = entries[j] & ~BLACK_BIT;
+                    double sign = entries[j] & BLACK_BIT ? -1 : 1;
+                    (*own)[0][index] += sign * g_mg;
+                    (*own)[1][index] += sign * g_eg;
+                }
+            }
+            losses[t] = loss;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    double loss = 0;
+    for (double l : losses) loss += l;
+    if (gradient) {
+        for (const auto& own : gradients)
+            for (int half = 0; half < 2; half++)
+                for (int i = 0; i < ENTRIES; i++) (*gradient)[half][i] += own[half][i] / data.positions.size();
+    }
+    return loss / max<size_t>(data.positions.size(), 1);
+}
+
+// The K that best fits the untuned tables, by golden section search.
+static double fit_k(const Dataset& data, const Tables& tables, int threads) {
+    double lo = 0.0001, hi = 0.05;
+    const double ratio = (sqrt(5.0) - 1) / 2;
+    for (int i = 0; i < 40; i++) {
+        double a = hi - ratio * (hi - lo), b = lo + ratio * (hi - lo);
+        if (pass(data, tables, a, threads, nullptr) < pass(data, tables, b, threads, nullptr)) hi = b;
+        else lo = a;
+    }
+    return (lo + hi) / 2;
+}
+
+// Writes the tables as replacements for PESTO_VALUE and PESTO_POSITION. A piece's value is its
+// average over the squares it can stand on (kings keep 0), the position table the rest.
+static void write_tables(const Tables& tables, const string& path) {
+    const char* names[6] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+    int values[2][6];
+    int positions[2][6][64];
+
+    for (int half = 0; half < 2; half++) {
+        for (int piece = 0; piece < 6; piece++) {
+            // pawns never stand on the first or last rank
+            int first = piece == 0 ? 8 : 0, last = piece == 0 ? 56 : 64;
+            double sum = 0;
+            for (int sq = first; sq < last; sq++) sum += tables[half][piece * 64 + sq];
+            values[half][piece] = piece == 5 ? 0 : (int)lround(sum / (last - first));
+            for (int sq = 0; sq < 64; sq++) {
+                bool used = sq >= first && sq < last;
+                positions[half][piece][sq] = used ? (int)lround(tables[half][piece * 64 + sq]) - values[half][piece] : 0;
+            }
+        }
+    }
+
+    ofstream out(path);
+    out << "const int PESTO_VALUE[2][6] = {";
+    for (int half = 0; half < 2; half++) {
+        out << (half ? ", {" : "{");
+        for (int piece = 0; piece < 6; piece++) out << (piece ? ", " : "") << values[half][piece];
+        out << "}";
+    }
+    out << "};\n\nconst int PESTO_POSITION[2][6][BOARD_SIZE] = {\n";
+    for (int half = 0; half < 2; half++) {
+        out << "    {\n";
+        for (int piece = 0; piece < 6; piece++) {
+            out << "        // " << (half ? "eg_" : "mg_") << names[piece] << "\n        {\n";
+            for (int rank = 0; rank < 8; rank++) {
+                out << "        ";
+                for (int file = 0; file < 8; file++) out << setw(4) << positions[half][piece][rank * 8 + file] << ",";
+                out << "\n";
+            }
+            out << "        }" << (piece < 5 ? "," : "") << "\n";
+        }
+        out << "    }" << (half ? "" : ",") << "\n";
+    }
+    out << "};\n";
+}
+
+static void usage_error() {
+    cout << "Usage: ./silkfish-tuner -o tuned.hpp [-epochs N] [-lr X] [-k X] [-qdepth N] [-threads N] data1.epd [data2.bin ...]"
+         << endl;
+}
+
+int main(int argc, char* argv[]) {
+    TunerOptions options;
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if (arg == "-o" && has_value) options.output = argv[++i];
+            else if (arg == "-epochs" && has_value) options.epochs = stoi(argv[++i]);
+            else if (arg == "-lr" && has_value) options.lr = stod(argv[++i]);
+            else if (arg == "-k" && has_value) options.k = stod(argv[++i]);
+            else if (arg == "-qdepth" && has_value) options.qdepth = stoi(argv[++i]);
+            else if (arg == "-threads" && has_value) options.threads = max(1, stoi(argv[++i]));
+            else if (arg[0] == '-') {
+                usage_error();
+                return 1;
+            } else files.push_back(arg);
+        } catch (const exception&) {
+            usage_error();
+            return 1;
+        }
+    }
+
+    if (files.empty()) {
+        usage_error();
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<RawPosition> raw;
+    for (const auto& path : files) {
+        if (path.size() > 4 && path.compare(path.size() - 4, 4, ".bin") == 0) load_training(path, raw);
+        else load_text(path, raw);
+    }
+    Dataset data = build_dataset(raw, options);
+    raw = vector<RawPosition>();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Loaded " << data.positions.size() << " quiet positions in " << seconds << " s, "
+         << (data.positions.size() * sizeof(TunerPosition) + data.entries.size() * sizeof(uint16_t)) / (1 << 20) << " MB"
+         << endl;
+    if (data.positions.empty()) return 1;
+
+    // Start from the current tables.
+    Tables tables;
+    for (int half = 0; half < 2; half++)
+        for (int piece = 0; piece < 6; piece++)
+            for (int sq = 0; sq < 64; sq++)
+                tables[half][piece * 64 + sq] = PESTO_VALUE[half][piece] + PESTO_POSITION[half][piece][sq];
+
+    double k = options.k ? options.k : fit_k(data, tables, options.threads);
+    cout << "K = " << k << ", initial loss " << pass(data, tables, k, options.threads, nullptr) << endl;
+
+    Tables m{}, v{};
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    for (int epoch = 1; epoch <= options.epochs; epoch++) {
+        auto epoch_start = chrono::steady_clock::now();
+        Tables gradient{};
+        double loss = pass(data, tables, k, options.threads, &gradient);
+
+        double step = options.lr * sqrt(1 - pow(beta2, epoch)) / (1 - pow(beta1, epoch));
+        for (int half = 0; half < 2; half++) {
+            for (int i = 0; i < ENTRIES; i++) {
+                double g = gradient[half][i];
+                m[half][i] = beta1 * m[half][i] + (1 - beta1) * g;
+                v[half][i] = beta2 * v[half][i] + (1 - beta2) * g * g;
+                tables[half][i] -= step * m[half][i] / (sqrt(v[half][i]) + epsilon);
+            }
+        }
+
+        if (epoch % 10 == 0 || epoch == options.epochs) {
+            double epoch_seconds = chrono::duration<double>(chrono::steady_clock::now() - epoch_start).count();
+            cout << "epoch " << epoch << " loss " << loss << " (" << epoch_seconds << " s)" << endl;
+        }
+        if (epoch % 50 == 0 || epoch == options.epochs) write_tables(tables, options.output);
+    }
+
+    cout << "Final loss " << pass(data, tables, k, options.threads, nullptr) << ", tables written to " << options.output
+         << endl;
+    return 0;
+}